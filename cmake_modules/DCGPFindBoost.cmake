@@ -1,5 +1,5 @@
 set(_DCGP_REQUIRED_BOOST_LIBS)
-list(APPEND _DCGP_REQUIRED_BOOST_LIBS timer chrono serialization system unit_test_framework)
+list(APPEND _DCGP_REQUIRED_BOOST_LIBS timer chrono serialization system filesystem unit_test_framework)
 if(_DCGP_FIND_BOOST_PYTHON)
     # NOTE: since Boost 1.67, the naming of the Boost.Python library has changed to include the
     # major and minor python version as a suffix. See the release notes:
@@ -39,7 +39,8 @@ Constructs a set of common kernel functions from their common name. The kernel
 functions can be then retrieved via the call operator.
 
 Args:
-    kernels (``list`` of ``string``): a list of strings indicating names of kernels to use. The following are available: "sum", "diff", "mul", "div", "sig", "sin", "log", "exp"
+    kernels (``list`` of ``string``): a list of strings indicating names of kernels to use. The following are available: "sum", "diff", "mul", "div", "sig", "sin", "log", "exp", as well as any kernel added with ``register_kernel_)"
+           + type + R"(``
 
 Examples:
 
@@ -109,6 +110,107 @@ Args:
     )";
 }
 
+std::string register_kernel_doc(const std::string &type)
+{
+    return R"(register_kernel_)"
+           + type + R"((kernel, differentiable = "", min_arity = 1)
+
+Registers a kernel under its name, so that it can be constructed by name as the built-in ones (e.g. by
+``kernel_set_)"
+           + type + R"(`` or by the symbolic regression problem). The kernels registered this way are unregistered when the
+interpreter exits, or before by ``unregister_kernel_)"
+           + type + R"(``.
+
+.. note::
+
+   A kernel constructed from Python callables calls into the interpreter and is not thread-safe. Expressions using
+   it must not be evaluated by threads not holding the GIL, e.g. by parallel losses (``parallel`` > 0), by the
+   symbolic regression problem with ``parallel_batches`` > 0 or by a threaded batch fitness evaluator or island.
+
+Args:
+    kernel (``dcgpy.kernel_)"
+           + type + R"(``): the kernel to register
+    differentiable (``str``): the name of the kernel to be used in its place where derivatives are computed (empty means the kernel itself)
+    min_arity (``int``): the minimum number of inputs the kernel accepts
+
+Raises:
+    ValueError: if a kernel with the same name is already registered
+
+Examples:
+
+>>> from dcgpy import *
+>>> def my_cube(x):
+...     return x[0]**3
+>>> def print_my_cube(x):
+...     return "(" + x[0] + ")^3"
+>>> register_kernel_)"
+           + type + R"((kernel_)" + type + R"((my_cube, print_my_cube, "cube"))
+>>> kernels = kernel_set_)"
+           + type + R"((["sum", "cube"])
+    )";
+}
+
+std::string unregister_kernel_doc(const std::string &type)
+{
+    return R"(unregister_kernel_)"
+           + type + R"((name)
+
+Unregisters a kernel, so that it can no longer be constructed by name (and that a different kernel can be registered
+under the same name). Kernel sets and expressions already constructed with it are not affected.
+
+Args:
+    name (``str``): the name of the kernel to unregister
+
+Raises:
+    ValueError: if no kernel called *name* is registered
+
+Examples:
+
+>>> from dcgpy import *
+>>> def my_cube(x):
+...     return x[0]**3
+>>> def print_my_cube(x):
+...     return "(" + x[0] + ")^3"
+>>> register_kernel_)"
+           + type + R"((kernel_)" + type + R"((my_cube, print_my_cube, "my_cube"))
+>>> unregister_kernel_)"
+           + type + R"(("my_cube")
+    )";
+}
+
+std::string registered_kernels_doc(const std::string &type)
+{
+    return R"(registered_kernels_)"
+           + type + R"(()
+
+Returns:
+    ``list`` of ``str``: the names of the kernels that can be constructed by name, in alphabetical order
+    )";
+}
+
+std::string expression_symbolic_dag_doc()
+{
+    return R"(symbolic_dag(symbols)
+
+Symbolic representation of the expression with shared subexpressions. Rather than inlining each node wherever it is
+used (as the call operator does), each active node is printed once, applied to the names of its inputs. The size of
+the result is linear in the number of active nodes.
+
+Args:
+    symbols (``list`` of ``str``): the symbols to use for the inputs
+
+Returns:
+    ``list`` of ``str``: one binding per active node (named ``t`` followed by its id), then one per output
+
+Examples:
+
+>>> from dcgpy import *
+>>> ex = expression_double(2, 1, 1, 3, 4, 2, kernel_set_double(["sum", "mul"])(), 0, 32)
+>>> ex.symbolic_dag(["x", "y"]) # doctest: +SKIP
+['t3 = (x*y)', 't4 = (t3+t3)', 'y0 = t4']
+    )";
+}
+
 std::string expression_loss_doc()
 {
     return R"(loss(points, labels, loss_type)
@@ -164,6 +266,9 @@ Mutates multiple genes within their allowed bounds.
 Args:
     idxs (``List[int]``): indexes of the genes to me mutated
 
+Returns:
+    ``bool``: False if all mutations were neutral (i.e. the phenotype did not change), True otherwise
+
 Raises:
     ValueError: if the index of a gene is out of bounds
     )";
@@ -1058,7 +1163,7 @@ case, aside the Mean Squared Error, the model complexity will be considered as a
 
 std::string symbolic_regression_init_doc()
 {
-    return R"(__init__(points, labels, rows, columns, levels_back, arity, kernels, n_eph, multi_objective, parallel_batches=0)
+    return R"(__init__(points, labels, rows, columns, levels_back, arity, kernels, n_eph, multi_objective, parallel_batches=0, incremental=False)
 
 Constructs a symbolic_regression optimization problem compatible with the pagmo UDP interface.
 
@@ -1072,7 +1177,11 @@ Args:
     kernels (``List[dcgpy.kernel_]``): kernel functions
     n_eph (``int``): Number of ephemeral constants. 
     multi_objective (``bool``): when True the problem will be considered as multiobjective (loss and model complexity).
-    parallel_batches (``int``): allows to split the data into batches for parallel evaluation.
+    parallel_batches (``int``): when non zero, the loss is evaluated in parallel. Any data size is allowed and the result
+      does not depend on the number of threads.
+    incremental (``bool``): when True (and *parallel_batches* is zero), the loss is evaluated reusing the values of the
+      nodes of the chromosome evaluated last. The result is the same, but the values of each input, ephemeral constant
+      and active node over the whole data are kept in memory.
 
 Raises:
     unspecified: any exception thrown by failures at the intersection between C++ and Python (e.g.,
@@ -1184,6 +1293,55 @@ See also the docs of the relevant C++ method :cpp:func:`dcgp::es4cgp::get_log()`
 )";
 }
 
+std::string es4cgp_set_checkpoint_doc()
+{
+    return R"(set_checkpoint(filename, interval)
+Makes ``evolve()`` (and ``resume()``) save the state of the evolution to a binary file every ``interval``
+generations, overwriting the previous checkpoint, so that a preempted run can be continued with
+:func:`~dcgpy.es4cgp.resume()`.
+
+Args:
+    filename (``str``): the checkpoint file.
+    interval (``int``): number of generations between checkpoints. Zero disables checkpointing.
+
+Raises:
+    ValueError: if *interval* is not zero and *filename* is empty.
+
+Examples:
+    >>> import dcgpy
+    >>> import pygmo as pg
+    >>> uda = dcgpy.es4cgp(gen = 10000)
+    >>> uda.set_checkpoint("run.bin", 100)
+    >>> pop = pg.algorithm(uda).evolve(pop) # doctest: +SKIP
+    >>> # ... after a preemption, in a new process ...
+    >>> pop = uda.resume(pop) # doctest: +SKIP
+
+See also the docs of the relevant C++ method :cpp:func:`dcgp::es4cgp::set_checkpoint()`.
+)";
+}
+
+std::string es4cgp_resume_doc()
+{
+    return R"(resume(pop)
+Continues the evolution saved in the checkpoint file (see :func:`~dcgpy.es4cgp.set_checkpoint()`) from the
+generation following the checkpoint. If the algorithm has the parameters of the checkpointed one and *pop* the same
+problem, the result is identical to that of the uninterrupted evolution.
+
+Args:
+    pop (:class:`~pygmo.population`): a population whose problem is the checkpointed one. Its individuals are
+      replaced by the checkpointed ones.
+
+Returns:
+    :class:`~pygmo.population`: the evolved population.
+
+Raises:
+    ValueError: if no checkpoint file is set or it cannot be opened, or if the checkpoint was not written by
+      this algorithm or does not match *pop*.
+
+See also the docs of the relevant C++ method :cpp:func:`dcgp::es4cgp::resume()`.
+)";
+}
+
 std::string es4cgp_doc()
 {
     return R"(__init__(gen = 1, mut_n = 1, ftol = 1e-4, learn_constants = False, seed = random)
@@ -10,6 +10,9 @@ std::string kernel_init_doc(const std::string &);
 std::string kernel_set_init_doc(const std::string &);
 std::string kernel_set_push_back_str_doc();
 std::string kernel_set_push_back_ker_doc(const std::string &);
+std::string register_kernel_doc(const std::string &);
+std::string unregister_kernel_doc(const std::string &);
+std::string registered_kernels_doc(const std::string &);
 
 // expression
 std::string expression_init_doc(const std::string &);
@@ -17,6 +20,7 @@ std::string expression_set_doc();
 std::string expression_set_f_gene_doc();
 std::string expression_mutate_doc();
 std::string expression_loss_doc();
+std::string expression_symbolic_dag_doc();
 
 // expression_weighted
 std::string expression_weighted_set_weight_doc();
@@ -42,6 +46,8 @@ std::string symbolic_regression_init_doc();
 std::string generic_uda_get_seed_doc();
 std::string es4cgp_doc();
 std::string es4cgp_get_log_doc();
+std::string es4cgp_set_checkpoint_doc();
+std::string es4cgp_resume_doc();
 
 // The symbolic Regressio Gym problems
 // Classic
@@ -5,12 +5,14 @@
 #define PY_ARRAY_UNIQUE_SYMBOL dcgpy_ARRAY_API
 #include "numpy.hpp"
 
+#include <algorithm>
 #include <boost/python.hpp>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include <dcgp/kernel.hpp>
+#include <dcgp/kernel_registry.hpp>
 #include <dcgp/kernel_set.hpp>
 
 #include "common_utils.hpp"
@@ -102,18 +104,70 @@ void expose_kernel_set(std::string type)
         .def("__getitem__", &wrap_operator<T>);
 }
 
+// The names of the kernels registered from Python. Their functions hold Python objects, which must be released
+// before the interpreter is finalized (the registry is only destroyed afterwards).
+template <typename T>
+std::vector<std::string> &python_kernels()
+{
+    static std::vector<std::string> names;
+    return names;
+}
+
+template <typename T>
+void unregister_python_kernels()
+{
+    for (const auto &name : python_kernels<T>()) {
+        kernel_registry<T>::instance().remove(name);
+    }
+    python_kernels<T>().clear();
+}
+
+template <typename T>
+void expose_kernel_registry(const std::string &type)
+{
+    bp::def(
+        ("register_kernel_" + type).c_str(),
+        +[](const kernel<T> &k, const std::string &differentiable, unsigned min_arity) {
+            kernel_registry<T>::instance().add(k, differentiable, min_arity);
+            python_kernels<T>().push_back(k.get_name());
+        },
+        register_kernel_doc(type).c_str(),
+        (bp::arg("kernel"), bp::arg("differentiable") = std::string(""), bp::arg("min_arity") = 1u));
+    bp::def(
+        ("unregister_kernel_" + type).c_str(),
+        +[](const std::string &name) {
+            kernel_registry<T>::instance().remove(name);
+            auto &names = python_kernels<T>();
+            names.erase(std::remove(names.begin(), names.end(), name), names.end());
+        },
+        unregister_kernel_doc(type).c_str(), (bp::arg("name")));
+    bp::def(
+        ("registered_kernels_" + type).c_str(), +[]() { return v_to_l(kernel_registry<T>::instance().names()); },
+        registered_kernels_doc(type).c_str());
+}
+
 void expose_kernels()
 {
     // double
     expose_kernel<double>("double");
     expose_kernel_set<double>("double");
+    expose_kernel_registry<double>("double");
 
     // gdual_d
     expose_kernel<gdual_d>("gdual_double");
     expose_kernel_set<gdual_d>("gdual_double");
+    expose_kernel_registry<gdual_d>("gdual_double");
 
     // gdual_v
     expose_kernel<gdual_v>("gdual_vdouble");
     expose_kernel_set<gdual_v>("gdual_vdouble");
+    expose_kernel_registry<gdual_v>("gdual_vdouble");
+
+    // The kernels registered from Python are unregistered at exit, while the interpreter is still alive
+    bp::import("atexit").attr("register")(bp::make_function(+[]() {
+        unregister_python_kernels<double>();
+        unregister_python_kernels<gdual_d>();
+        unregister_python_kernels<gdual_v>();
+    }));
 }
 } // namespace dcgpy
\ No newline at end of file
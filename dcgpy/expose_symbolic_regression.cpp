@@ -49,17 +49,18 @@ void expose_symbolic_regression()
              bp::make_constructor(
                  +[](const bp::object &points, const bp::object &labels, unsigned rows, unsigned cols,
                      unsigned levels_back, unsigned arity, const bp::object &kernels, unsigned n_eph,
-                     bool multi_objective, unsigned parallel_batches) {
+                     bool multi_objective, unsigned parallel_batches, bool incremental) {
                      auto kernels_v = l_to_v<kernel<double>>(kernels);
                      auto vvd_points = to_vv<double>(points);
                      auto vvd_labels = to_vv<double>(labels);
                      return ::new dcgp::symbolic_regression(vvd_points, vvd_labels, rows, cols, levels_back, arity,
-                                                            kernels_v, n_eph, multi_objective, parallel_batches);
+                                                            kernels_v, n_eph, multi_objective, parallel_batches,
+                                                            incremental);
                  },
                  bp::default_call_policies(),
                  (bp::arg("points"), bp::arg("labels"), bp::arg("rows"), bp::arg("cols"), bp::arg("levels_back"),
                   bp::arg("arity"), bp::arg("kernels"), bp::arg("n_eph"), bp::arg("multi_objective"),
-                  bp::arg("parallel_batches") = 0u)),
+                  bp::arg("parallel_batches") = 0u, bp::arg("incremental") = false)),
              symbolic_regression_init_doc().c_str())
         .def(
             "pretty", +[](const dcgp::symbolic_regression &instance,
@@ -67,6 +68,10 @@ void expose_symbolic_regression()
         .def(
             "prettier", +[](const dcgp::symbolic_regression &instance, const bp::object &x) {
                 return instance.prettier(to_v<double>(x));
+            })
+        .def(
+            "pretty_dag", +[](const dcgp::symbolic_regression &instance, const bp::object &x) {
+                return instance.pretty_dag(to_v<double>(x));
             });
     // We expose the UDAs
     // ES-4CGP (Evolutionary Strategy for Caertesian Genetic Programming)
@@ -77,6 +82,9 @@ void expose_symbolic_regression()
         (bp::arg("gen") = 1u, bp::arg("mut_n") = 1u, bp::arg("ftol") = 1e-4, bp::arg("learn_constants") = true,
          bp::arg("seed"))));
     es4cgp_.def("get_seed", &es4cgp::get_seed, generic_uda_get_seed_doc().c_str());
+    es4cgp_.def("set_checkpoint", &es4cgp::set_checkpoint, es4cgp_set_checkpoint_doc().c_str(),
+                (bp::arg("filename"), bp::arg("interval")));
+    es4cgp_.def("resume", &es4cgp::resume, es4cgp_resume_doc().c_str(), (bp::arg("pop")));
     pg::expose_algo_log(es4cgp_, es4cgp_get_log_doc().c_str());
 
     // Making data from the gym available in python
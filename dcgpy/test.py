@@ -77,6 +77,19 @@ class test_kernel_set(_ut.TestCase):
         self.assertEqual(a[0]([x, y, z]), x-y-z)
         self.assertEqual(a[1]([x, y, z]), x*y*z)
         self.assertEqual(a[2]([x, y, z]), x+y+z)
+        # Registered kernels are constructed by name, until unregistered
+        from dcgpy import register_kernel_double, unregister_kernel_double, registered_kernels_double
+        register_kernel_double(my_kernel)
+        self.assertTrue("my_sum_kernel" in registered_kernels_double())
+        self.assertEqual(kernel_set(["my_sum_kernel"])[0]([x, y, z]), x+y+z)
+        self.assertRaises(ValueError, lambda: register_kernel_double(my_kernel))
+        unregister_kernel_double("my_sum_kernel")
+        self.assertFalse("my_sum_kernel" in registered_kernels_double())
+        self.assertRaises(ValueError, lambda: kernel_set(["my_sum_kernel"]))
+        self.assertRaises(ValueError, lambda: unregister_kernel_double("my_sum_kernel"))
+        # and can then be registered again
+        register_kernel_double(my_kernel)
+        unregister_kernel_double("my_sum_kernel")
 
     def test_gdual_double(self):
         from dcgpy import kernel_set_gdual_double as kernel_set
@@ -0,0 +1,85 @@
+#ifndef DCGP_CHECKPOINT_H
+#define DCGP_CHECKPOINT_H
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <cstdio>
+#include <fstream>
+#include <pagmo/population.hpp>
+#include <pagmo/s11n.hpp>
+#include <pagmo/types.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dcgp
+{
+namespace detail
+{
+// Writes the state of an evolution (the checkpoint of an algorithm) to a binary file, after the name of the algorithm.
+// The archive is written to a temporary file which then replaces the previous checkpoint, so that a run killed while
+// writing leaves the previous checkpoint intact.
+template <typename State>
+inline void save_checkpoint(const std::string &filename, const std::string &algorithm, const State &state)
+{
+    const std::string tmp = filename + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::runtime_error("Could not open the checkpoint file " + tmp + " for writing");
+        }
+        boost::archive::binary_oarchive oa(ofs);
+        oa << algorithm;
+        oa << state;
+        if (!ofs) {
+            throw std::runtime_error("Could not write the checkpoint file " + tmp);
+        }
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("Could not rename " + tmp + " to " + filename);
+    }
+}
+
+// Reads the state of an evolution written by save_checkpoint, checking that it was written by the same algorithm
+template <typename State>
+inline State load_checkpoint(const std::string &filename, const std::string &algorithm)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        throw std::invalid_argument("Could not open the checkpoint file " + filename);
+    }
+    boost::archive::binary_iarchive ia(ifs);
+    std::string name;
+    ia >> name;
+    if (name != algorithm) {
+        throw std::invalid_argument("The checkpoint file " + filename + " was written by " + name + ", not by "
+                                    + algorithm);
+    }
+    State state;
+    ia >> state;
+    return state;
+}
+
+// Replaces the individuals of a population with those of a checkpoint. The fitnesses are not recomputed, hence the
+// number of fitness evaluations of the problem is unchanged.
+inline void set_individuals(pagmo::population &pop, const std::vector<pagmo::vector_double> &xs,
+                            const std::vector<pagmo::vector_double> &fs)
+{
+    if (xs.size() != pop.size() || fs.size() != pop.size()) {
+        throw std::invalid_argument("The checkpoint contains " + std::to_string(xs.size())
+                                    + " individuals, while the population has " + std::to_string(pop.size()));
+    }
+    for (decltype(xs.size()) i = 0u; i < xs.size(); ++i) {
+        if (xs[i].size() != pop.get_problem().get_nx()) {
+            throw std::invalid_argument("The checkpoint chromosomes have dimension " + std::to_string(xs[i].size())
+                                        + ", while the problem has dimension "
+                                        + std::to_string(pop.get_problem().get_nx()));
+        }
+        pop.set_xf(i, xs[i], fs[i]);
+    }
+}
+
+} // namespace detail
+} // namespace dcgp
+
+#endif
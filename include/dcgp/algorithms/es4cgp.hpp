@@ -5,12 +5,15 @@
 #include <pagmo/detail/custom_comparisons.hpp>
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
+#include <pagmo/s11n.hpp>
 #include <random>
 #include <sstream>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include <dcgp/algorithms/checkpoint.hpp>
+#include <dcgp/expression.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 #include <dcgp/rng.hpp>
 
@@ -43,6 +46,8 @@ namespace dcgp
  * In this class we provide an evolutionary strategy tailored to solve problems of the class dcgp::symbolic_regression
  * leveraging the kowledge on the genetic structure of Cartesian Genetic Programs (i.e. able to mutate only active
  * genes).
+ *
+ * Long runs can be checkpointed (see es4cgp::set_checkpoint()) and resumed (see es4cgp::resume()).
  */
 class es4cgp
 {
@@ -67,7 +72,7 @@ public:
     es4cgp(unsigned gen = 1u, unsigned mut_n = 1u, double ftol = 1e-4, bool learn_constants = true,
            unsigned seed = random_device::next())
         : m_gen(gen), m_mut_n(mut_n), m_ftol(ftol), m_learn_constants(learn_constants), m_e(seed), m_seed(seed),
-          m_verbosity(0u)
+          m_verbosity(0u), m_checkpoint_interval(0u)
     {
         if (mut_n == 0u) {
             throw std::invalid_argument("The number of active mutations is zero, it must be at least 1.");
@@ -86,8 +91,99 @@ public:
      * @throws std::invalid_argument if a dcgp::symbolic_regression cannot be extracted from the problem
      * @throws std::invalid_argument if the population size is smaller than 2
      * @throws std::invalid_argument if the number of objectives is not 1.
+     * @throws std::runtime_error if a checkpoint (see es4cgp::set_checkpoint()) cannot be written.
      */
     pagmo::population evolve(pagmo::population pop) const
+    {
+        return evolve_impl(std::move(pop), nullptr);
+    }
+
+    /// Resumes an evolution
+    /**
+     * Continues the evolution saved in the checkpoint file (see es4cgp::set_checkpoint()) from the generation
+     * following the checkpoint. The algorithm must have the parameters of the checkpointed one, and \p pop the same
+     * problem: the evolved population, the log and the state of the random engine are then identical to those of an
+     * uninterrupted call to es4cgp::evolve().
+     *
+     * @param pop population whose problem is the checkpointed one. Its individuals are replaced by the checkpointed
+     * ones.
+     * @return evolved population
+     * @throws std::invalid_argument if no checkpoint file is set or it cannot be opened
+     * @throws std::invalid_argument if the checkpoint was not written by this algorithm or does not match \p pop
+     * @throws unspecified any exception thrown by es4cgp::evolve()
+     */
+    pagmo::population resume(pagmo::population pop) const
+    {
+        if (m_checkpoint_file.empty()) {
+            throw std::invalid_argument(get_name() + " has no checkpoint file to resume from (see set_checkpoint)");
+        }
+        auto cp = detail::load_checkpoint<checkpoint>(m_checkpoint_file, get_name());
+        return evolve_impl(std::move(pop), &cp);
+    }
+
+    /// Sets the checkpoints
+    /**
+     * Makes es4cgp::evolve() (and es4cgp::resume()) save the state of the evolution to a binary file every
+     * \p interval generations, overwriting the previous checkpoint. The state comprises the population, the best
+     * individual, the log and the random engines, so that a preempted run can be continued with es4cgp::resume().
+     *
+     * @param filename the checkpoint file.
+     * @param interval number of generations between checkpoints. Zero disables checkpointing.
+     * @throws std::invalid_argument if \p interval is not zero and \p filename is empty.
+     */
+    void set_checkpoint(const std::string &filename, unsigned interval)
+    {
+        if (interval > 0u && filename.empty()) {
+            throw std::invalid_argument("The checkpoint file name is empty.");
+        }
+        m_checkpoint_file = filename;
+        m_checkpoint_interval = interval;
+    }
+
+    /// Gets the checkpoint file
+    /**
+     * @return the checkpoint file name
+     */
+    const std::string &get_checkpoint_file() const
+    {
+        return m_checkpoint_file;
+    }
+
+    /// Gets the checkpoint interval
+    /**
+     * @return the number of generations between checkpoints (zero if checkpointing is disabled)
+     */
+    unsigned get_checkpoint_interval() const
+    {
+        return m_checkpoint_interval;
+    }
+
+private:
+    // The state of an evolution at the end of a generation
+    struct checkpoint {
+        unsigned gen;
+        unsigned count;
+        unsigned long long fevals;
+        log_type log;
+        std::vector<pagmo::vector_double> pop_x;
+        std::vector<pagmo::vector_double> pop_f;
+        detail::random_engine_type e;
+        std::string normal;
+        expression<double> cgp;
+        pagmo::vector_double best_x;
+        double best_f;
+        pagmo::vector_double best_xd;
+        pagmo::vector_double dvs;
+        pagmo::vector_double fs;
+        template <typename Archive>
+        void serialize(Archive &ar, unsigned)
+        {
+            ar &gen &count &fevals &log &pop_x &pop_f &e &normal &cgp &best_x &best_f &best_xd &dvs &fs;
+        }
+    };
+
+    // Evolves the population, or resumes the evolution from a checkpoint when cp is not null
+    pagmo::population evolve_impl(pagmo::population pop, const checkpoint *cp) const
     {
         const auto &prob = pop.get_problem();
         auto dim = prob.get_nx();
@@ -121,6 +217,10 @@ public:
 
         // No throws, all valid: we clear the logs
         m_log.clear();
+        // When resuming, the population is the checkpointed one
+        if (cp) {
+            detail::set_individuals(pop, cp->pop_x, cp->pop_f);
+        }
         // We make a copy of the cgp which we will use to make mutations.
         auto cgp = udp_ptr->get_cgp();
         // How many ephemeral constants?
@@ -143,8 +243,27 @@ public:
         pagmo::vector_double dvs(NP * dim);
         pagmo::vector_double fs(NP * n_obj);
 
+        // When resuming, we restore the state at the end of the checkpointed generation
+        decltype(m_gen) gen0 = 1u;
+        if (cp) {
+            gen0 = cp->gen + 1u;
+            count = cp->count;
+            fevals0 = prob.get_fevals() - cp->fevals;
+            m_log = cp->log;
+            m_e = cp->e;
+            std::istringstream(cp->normal) >> normal;
+            cgp = cp->cgp;
+            best_x = cp->best_x;
+            best_f = cp->best_f;
+            std::transform(best_x.data() + n_eph, best_x.data() + best_x.size(), best_xu.begin(),
+                           [](double a) { return boost::numeric_cast<unsigned>(a); });
+            best_xd = cp->best_xd;
+            dvs = cp->dvs;
+            fs = cp->fs;
+        }
+
         // Main loop
-        for (decltype(m_gen) gen = 1u; gen <= m_gen; ++gen) {
+        for (decltype(m_gen) gen = gen0; gen <= m_gen; ++gen) {
             // Logs and prints (verbosity modes > 1: a line is added every m_verbosity generations)
             if (m_verbosity > 0u) {
                 // Every m_verbosity generations print a log line
@@ -180,6 +299,9 @@ public:
                         mutated_eph_val[j] = best_xd[j] + 0.1 * normal(m_e);
                     }
                     std::copy(mutated_eph_val.begin(), mutated_eph_val.end(), dvs.data() + i * dim);
+                } else {
+                    // Otherwise the mutants carry the constants of the parent
+                    std::copy(best_xd.begin(), best_xd.end(), dvs.data() + i * dim);
                 }
             }
 
@@ -209,6 +331,15 @@ public:
                 update_pop(pop, dvs, fs, best_f, best_x, NP, dim);
                 return pop;
             }
+            // We checkpoint the evolution
+            if (m_checkpoint_interval > 0u && gen % m_checkpoint_interval == 0u) {
+                std::ostringstream normal_state;
+                normal_state << normal;
+                detail::save_checkpoint(m_checkpoint_file, get_name(),
+                                        checkpoint{gen, count, prob.get_fevals() - fevals0, m_log, pop.get_x(),
+                                                   pop.get_f(), m_e, normal_state.str(), cgp, best_x, best_f, best_xd,
+                                                   dvs, fs});
+            }
         }
         // Evolution has terminated and we now update into the pagmo::pop.
         update_pop(pop, dvs, fs, best_f, best_x, NP, dim);
@@ -222,6 +353,7 @@ public:
         return pop;
     }
 
+public:
     /// Sets the seed
     /**
      * @param seed the seed controlling the algorithm stochastic behaviour
@@ -306,6 +438,9 @@ public:
         pagmo::stream(ss, "\n\tExit condition of the final loss (ftol): ", m_ftol);
         pagmo::stream(ss, "\n\tVerbosity: ", m_verbosity);
         pagmo::stream(ss, "\n\tSeed: ", m_seed);
+        if (m_checkpoint_interval > 0u) {
+            pagmo::stream(ss, "\n\tCheckpoint: ", m_checkpoint_file, " every ", m_checkpoint_interval, " generations");
+        }
         return ss.str();
     }
 
@@ -361,6 +496,8 @@ private:
     unsigned m_verbosity;
     mutable log_type m_log;
     pagmo::bfe m_bfe;
+    std::string m_checkpoint_file;
+    unsigned m_checkpoint_interval;
 };
 } // namespace dcgp
 #endif
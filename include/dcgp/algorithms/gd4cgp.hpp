@@ -8,10 +8,12 @@
 
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
+#include <pagmo/s11n.hpp>
 #include <stdexcept>
-
+#include <string>
 #include <vector>
 
+#include <dcgp/algorithms/checkpoint.hpp>
 #include <dcgp/kernel.hpp>
 #include <dcgp/kernel_set.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
@@ -38,7 +40,7 @@ public:
      * @throws std::invalid_argument if *lr_min* is not in (0, *lr*)
      */
     gd4cgp(unsigned max_iter = 1u, double lr = 1., double lr_min = 1e-3)
-        : m_max_iter(max_iter), m_lr(lr), m_lr_min(lr_min), m_verbosity(0u)
+        : m_max_iter(max_iter), m_lr(lr), m_lr_min(lr_min), m_verbosity(0u), m_checkpoint_interval(0u)
     {
         if (lr_min <= 0.) {
             throw std::invalid_argument("The minimum learning rate must be strictly positive.");
@@ -58,8 +60,96 @@ public:
      * @throws std::invalid_argument if a dcgp::symbolic_regression cannot be extracted from the problem
      * @throws std::invalid_argument if no ephemeral constants are detected in the model.
      * @throws std::invalid_argument if the number of objectives is not 1.
+     * @throws std::runtime_error if a checkpoint (see gd4cgp::set_checkpoint()) cannot be written.
      */
     pagmo::population evolve(pagmo::population pop) const
+    {
+        return evolve_impl(std::move(pop), nullptr);
+    }
+
+    /// Resumes an evolution
+    /**
+     * Continues the evolution saved in the checkpoint file (see gd4cgp::set_checkpoint()) from the iteration
+     * following the checkpoint. The algorithm must have the parameters of the checkpointed one, and \p pop the same
+     * problem: the evolved population and the log are then identical to those of an uninterrupted call to
+     * gd4cgp::evolve().
+     *
+     * @param pop population whose problem is the checkpointed one. Its individuals are replaced by the checkpointed
+     * ones.
+     * @return evolved population
+     * @throws std::invalid_argument if no checkpoint file is set or it cannot be opened
+     * @throws std::invalid_argument if the checkpoint was not written by this algorithm or does not match \p pop
+     * @throws unspecified any exception thrown by gd4cgp::evolve()
+     */
+    pagmo::population resume(pagmo::population pop) const
+    {
+        if (m_checkpoint_file.empty()) {
+            throw std::invalid_argument(get_name() + " has no checkpoint file to resume from (see set_checkpoint)");
+        }
+        auto cp = detail::load_checkpoint<checkpoint>(m_checkpoint_file, get_name());
+        return evolve_impl(std::move(pop), &cp);
+    }
+
+    /// Sets the checkpoints
+    /**
+     * Makes gd4cgp::evolve() (and gd4cgp::resume()) save the state of the evolution to a binary file every
+     * \p interval iterations, overwriting the previous checkpoint. The state comprises the population, the current
+     * chromosome, the learning rate and the log, so that a preempted run can be continued with gd4cgp::resume().
+     *
+     * @param filename the checkpoint file.
+     * @param interval number of iterations between checkpoints. Zero disables checkpointing.
+     * @throws std::invalid_argument if \p interval is not zero and \p filename is empty.
+     */
+    void set_checkpoint(const std::string &filename, unsigned interval)
+    {
+        if (interval > 0u && filename.empty()) {
+            throw std::invalid_argument("The checkpoint file name is empty.");
+        }
+        m_checkpoint_file = filename;
+        m_checkpoint_interval = interval;
+    }
+
+    /// Gets the checkpoint file
+    /**
+     * @return the checkpoint file name
+     */
+    const std::string &get_checkpoint_file() const
+    {
+        return m_checkpoint_file;
+    }
+
+    /// Gets the checkpoint interval
+    /**
+     * @return the number of iterations between checkpoints (zero if checkpointing is disabled)
+     */
+    unsigned get_checkpoint_interval() const
+    {
+        return m_checkpoint_interval;
+    }
+
+private:
+    // The state of an evolution at the end of a iteration
+    struct checkpoint {
+        unsigned iter;
+        unsigned count;
+        unsigned long long fevals;
+        unsigned long long gevals;
+        log_type log;
+        std::vector<pagmo::vector_double> pop_x;
+        std::vector<pagmo::vector_double> pop_f;
+        pagmo::vector_double x0;
+        pagmo::vector_double fit0;
+        double lr;
+        double loss_gradient_norm;
+        template <typename Archive>
+        void serialize(Archive &ar, unsigned)
+        {
+            ar &iter &count &fevals &gevals &log &pop_x &pop_f &x0 &fit0 &lr &loss_gradient_norm;
+        }
+    };
+
+    // Evolves the population, or resumes the evolution from a checkpoint when cp is not null
+    pagmo::population evolve_impl(pagmo::population pop, const checkpoint *cp) const
     {
         const auto &prob = pop.get_problem();
         auto n_obj = prob.get_nobj();
@@ -97,8 +187,13 @@ public:
         // No throws, all valid: we clear the logs
         m_log.clear();
 
-        // 1 - We select a chromosome in the population.
-        auto sel_xf = select_individual(pop);
+        // When resuming, the population is the checkpointed one
+        if (cp) {
+            detail::set_individuals(pop, cp->pop_x, cp->pop_f);
+        }
+
+        // 1 - We select a chromosome in the population (when resuming, the one being descended).
+        auto sel_xf = cp ? std::make_pair(cp->x0, cp->fit0) : select_individual(pop);
         pagmo::vector_double x0(std::move(sel_xf.first)), fit0(std::move(sel_xf.second));
         pagmo::vector_double x1(x0);
         pagmo::vector_double fit1(fit0);
@@ -115,7 +210,19 @@ public:
         double lr = m_lr;
         double loss_gradient_norm = 0.;
 
-        for (unsigned iter = 1u; iter <= m_max_iter; ++iter) {
+        // When resuming, we restore the state at the end of the checkpointed iteration
+        unsigned iter0 = 1u;
+        if (cp) {
+            iter0 = cp->iter + 1u;
+            count = cp->count;
+            fevals0 = prob.get_fevals() - cp->fevals;
+            gevals0 = prob.get_gevals() - cp->gevals;
+            m_log = cp->log;
+            lr = cp->lr;
+            loss_gradient_norm = cp->loss_gradient_norm;
+        }
+
+        for (unsigned iter = iter0; iter <= m_max_iter; ++iter) {
             // We log
             if (m_verbosity > 0u) {
                 // Every m_verbosity generations print a log line
@@ -163,6 +270,13 @@ public:
                     return pop;
                 }
             }
+            // We checkpoint the descent
+            if (m_checkpoint_interval > 0u && iter % m_checkpoint_interval == 0u) {
+                detail::save_checkpoint(m_checkpoint_file, get_name(),
+                                        checkpoint{iter, count, prob.get_fevals() - fevals0,
+                                                   prob.get_gevals() - gevals0, m_log, pop.get_x(), pop.get_f(), x0,
+                                                   fit0, lr, loss_gradient_norm});
+            }
         }
         if (m_verbosity > 0u) {
             log_single_line(m_max_iter, prob, fevals0, gevals0, loss_gradient_norm, lr, fit0);
@@ -172,6 +286,7 @@ public:
         return pop;
     }
 
+public:
     /// Sets the algorithm verbosity
     /**
      * Sets the verbosity level of the screen output and of the
@@ -233,6 +348,9 @@ public:
         pagmo::stream(ss, "\n\tInitial learning rate: ", m_lr);
         pagmo::stream(ss, "\n\tMinimum learning rate: ", m_lr_min);
         pagmo::stream(ss, "\n\tVerbosity: ", m_verbosity);
+        if (m_checkpoint_interval > 0u) {
+            pagmo::stream(ss, "\n\tCheckpoint: ", m_checkpoint_file, " every ", m_checkpoint_interval, " iterations");
+        }
         return ss.str();
     }
 
@@ -265,6 +383,8 @@ private:
     double m_lr_min;
     unsigned m_verbosity;
     mutable log_type m_log;
+    std::string m_checkpoint_file;
+    unsigned m_checkpoint_interval;
 };
 } // namespace dcgp
 #endif
\ No newline at end of file
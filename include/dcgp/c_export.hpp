@@ -0,0 +1,347 @@
+#ifndef DCGP_C_EXPORT_H
+#define DCGP_C_EXPORT_H
+
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_ann.hpp>
+#include <dcgp/expression_weighted.hpp>
+
+namespace dcgp
+{
+namespace detail
+{
+// A double as a C literal that reads back to the very same value
+inline std::string c_literal(double v)
+{
+    if (std::isnan(v)) {
+        return "NAN";
+    }
+    if (std::isinf(v)) {
+        return v > 0 ? "INFINITY" : "(-INFINITY)";
+    }
+    std::ostringstream ss;
+    ss.imbue(std::locale::classic());
+    ss.precision(std::numeric_limits<double>::max_digits10);
+    ss << v;
+    std::string retval = ss.str();
+    if (retval.find_first_of(".e") == std::string::npos) {
+        retval += ".";
+    }
+    return std::signbit(v) ? "(" + retval + ")" : retval;
+}
+
+// Whether a kernel is one of the approximate ones (e.g. sig_fast)
+inline bool is_fast_kernel(const std::string &name)
+{
+    return name.size() > 5u && name.compare(name.size() - 5u, 5u, "_fast") == 0;
+}
+
+// Whether a kernel only uses its first input (the others being connected but ignored)
+inline bool is_unary_kernel(const std::string &name)
+{
+    return name == "sin" || name == "cos" || name == "log" || name == "exp" || name == "gaussian" || name == "sqrt"
+           || name == "exp_fast" || name == "gaussian_fast";
+}
+
+// Emits the C statements computing a node. They mirror, operation by operation, the kernels in wrapped_functions.hpp
+// (and their vectorized versions in expression::run_vectorized). The approximate kernels call the functions
+// <fast_prefix>_fast_exp and <fast_prefix>_fast_tanh (see c_fast_functions), and cannot be emitted if fast_prefix is
+// empty.
+inline void emit_c_kernel(std::ostringstream &ss, const std::string &name, const std::string &res,
+                          const std::vector<std::string> &in, const std::string &fast_prefix = "")
+{
+    // Left fold of the inputs with a compound assignment
+    auto fold = [&ss, &res, &in](const std::string &op, unsigned first) {
+        ss << "    double " << res << " = " << in[first] << ";\n";
+        for (auto j = first + 1u; j < in.size(); ++j) {
+            ss << "    " << res << " " << op << "= " << in[j] << ";\n";
+        }
+    };
+    if (is_fast_kernel(name) && fast_prefix.empty()) {
+        throw std::invalid_argument("The kernel " + name + " cannot be compiled");
+    }
+    if (name == "sum") {
+        fold("+", 0u);
+    } else if (name == "diff") {
+        fold("-", 0u);
+    } else if (name == "mul") {
+        fold("*", 0u);
+    } else if (name == "div") {
+        fold("/", 0u);
+    } else if (name == "pdiv") {
+        if (in.size() < 2u) {
+            throw std::invalid_argument("The kernel pdiv cannot be compiled with arity " + std::to_string(in.size()));
+        }
+        fold("*", 1u);
+        ss << "    " << res << " = " << in[0] << " / " << res << ";\n";
+        ss << "    " << res << " = isfinite(" << res << ") ? " << res << " : 1.;\n";
+    } else if (name == "sig") {
+        fold("+", 0u);
+        ss << "    " << res << " = 1. / (1. + exp(-" << res << "));\n";
+    } else if (name == "tanh") {
+        fold("+", 0u);
+        ss << "    " << res << " = tanh(" << res << ");\n";
+    } else if (name == "ReLu") {
+        fold("+", 0u);
+        ss << "    " << res << " = (" << res << " < 0) ? 0. : " << res << ";\n";
+    } else if (name == "ELU") {
+        fold("+", 0u);
+        ss << "    " << res << " = (" << res << " < 0) ? exp(" << res << ") - 1. : " << res << ";\n";
+    } else if (name == "ISRU") {
+        fold("+", 0u);
+        ss << "    " << res << " = " << res << " / sqrt(1 + " << res << " * " << res << ");\n";
+    } else if (name == "sin") {
+        ss << "    double " << res << " = sin(" << in[0] << ");\n";
+    } else if (name == "cos") {
+        ss << "    double " << res << " = cos(" << in[0] << ");\n";
+    } else if (name == "log") {
+        ss << "    double " << res << " = log(" << in[0] << ");\n";
+    } else if (name == "exp") {
+        ss << "    double " << res << " = exp(" << in[0] << ");\n";
+    } else if (name == "gaussian") {
+        ss << "    double " << res << " = exp(-" << in[0] << " * " << in[0] << ");\n";
+    } else if (name == "sqrt") {
+        ss << "    double " << res << " = sqrt(" << in[0] << ");\n";
+    } else if (name == "sig_fast") {
+        fold("+", 0u);
+        ss << "    " << res << " = 1. / (1. + " << fast_prefix << "_fast_exp(-" << res << "));\n";
+    } else if (name == "tanh_fast") {
+        fold("+", 0u);
+        ss << "    " << res << " = " << fast_prefix << "_fast_tanh(" << res << ");\n";
+    } else if (name == "exp_fast") {
+        ss << "    double " << res << " = " << fast_prefix << "_fast_exp(" << in[0] << ");\n";
+    } else if (name == "gaussian_fast") {
+        ss << "    double " << res << " = " << fast_prefix << "_fast_exp(-" << in[0] << " * " << in[0] << ");\n";
+    } else {
+        throw std::invalid_argument("The kernel " + name + " cannot be compiled");
+    }
+}
+
+// The C version of detail::fast_exp and (if tanh is true) of detail::fast_tanh, called by the approximate kernels
+inline std::string c_fast_functions(const std::string &prefix, bool tanh)
+{
+    std::ostringstream ss;
+    ss << "static double " << prefix << "_fast_exp(double x)\n{\n";
+    ss << "    double xc = (x < -746.) ? -746. : x;\n";
+    ss << "    xc = (xc > 710.) ? 710. : xc;\n";
+    ss << "    const double shifter = 6755399441055744.;\n";
+    ss << "    const double t = xc * 1.4426950408889634 + shifter;\n";
+    ss << "    const double n = t - shifter;\n";
+    ss << "    const double r = (xc - n * 6.93147180369123816490e-01) - n * 1.90821492927058770002e-10;\n";
+    ss << "    double p = 1. / 5040.;\n";
+    ss << "    p = p * r + 1. / 720.;\n";
+    ss << "    p = p * r + 1. / 120.;\n";
+    ss << "    p = p * r + 1. / 24.;\n";
+    ss << "    p = p * r + 1. / 6.;\n";
+    ss << "    p = p * r + 1. / 2.;\n";
+    ss << "    p = p * r + 1.;\n";
+    ss << "    p = p * r + 1.;\n";
+    ss << "    uint64_t bits;\n";
+    ss << "    memcpy(&bits, &t, sizeof(double));\n";
+    ss << "    const uint64_t n_off = bits - 0x4338000000000000ULL + 2048u;\n";
+    ss << "    const uint64_t n1_off = n_off >> 1;\n";
+    ss << "    const uint64_t bits1 = (n1_off - 1u) << 52, bits2 = (n_off - n1_off - 1u) << 52;\n";
+    ss << "    double scale1, scale2;\n";
+    ss << "    memcpy(&scale1, &bits1, sizeof(double));\n";
+    ss << "    memcpy(&scale2, &bits2, sizeof(double));\n";
+    ss << "    return p * scale1 * scale2;\n";
+    ss << "}\n\n";
+    if (!tanh) {
+        return ss.str();
+    }
+    ss << "static double " << prefix << "_fast_tanh(double x)\n{\n";
+    ss << "    const double x2 = x * x;\n";
+    ss << "    const double xs = (x2 < 1.) ? x : 0.;\n";
+    ss << "    const double xs2 = xs * xs;\n";
+    ss << "    const double small = xs + xs * xs2 * (-1. / 3. + xs2 * (2. / 15. + xs2 * (-17. / 315. + xs2 * (62. / "
+          "2835.))));\n";
+    ss << "    const double large = 1. - 2. / (" << prefix << "_fast_exp(2. * x) + 1.);\n";
+    ss << "    const double w = (x2 < 0.015625) ? 1. : 0.;\n";
+    ss << "    return large + w * (small - large);\n";
+    ss << "}\n\n";
+    return ss.str();
+}
+
+// Writes the C function evaluating the active phenotype of an expression. node_inputs(node_id, in) turns the names of
+// the nodes connected to node_id into the kernel inputs (e.g. applying the weights).
+template <typename F>
+inline std::string c_function(const expression<double> &ex, const std::string &name, F node_inputs)
+{
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        throw std::invalid_argument("The function name " + name + " is not a valid C identifier");
+    }
+    for (char ch : name) {
+        if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '_') {
+            throw std::invalid_argument("The function name " + name + " is not a valid C identifier");
+        }
+    }
+    const auto &x = ex.get();
+    const auto n = ex.get_n();
+    const auto n_in = n - static_cast<unsigned>(ex.get_eph_val().size());
+    // The name of the variable holding the value of a node. Ephemeral constants are written in place
+    auto var = [&ex, n, n_in](unsigned node_id) {
+        if (node_id < n_in) {
+            return "x[" + std::to_string(node_id) + "]";
+        } else if (node_id < n) {
+            return c_literal(ex.get_eph_val()[node_id - n_in]);
+        }
+        return "n" + std::to_string(node_id);
+    };
+    // The active nodes also include those connected to the ignored inputs of the unary kernels, which are not needed
+    // to compute the outputs. Active nodes are sorted, hence they are visited from the outputs backwards.
+    const auto &active = ex.get_active_nodes();
+    std::vector<bool> needed(n + ex.get_r() * ex.get_c(), false);
+    for (auto i = 0u; i < ex.get_m(); ++i) {
+        needed[x[x.size() - ex.get_m() + i]] = true;
+    }
+    for (auto it = active.rbegin(); it != active.rend(); ++it) {
+        if (*it < n || !needed[*it]) {
+            continue;
+        }
+        const auto idx = ex.get_gene_idx()[*it];
+        const auto arity = is_unary_kernel(ex.get_f()[x[idx]].get_name()) ? 1u : ex.get_arity(*it);
+        for (auto j = 0u; j < arity; ++j) {
+            needed[x[idx + 1u + j]] = true;
+        }
+    }
+    std::ostringstream body;
+    bool fast = false, fast_tanh = false;
+    // Each node only depends on nodes already computed
+    for (auto node_id : active) {
+        if (node_id < n || !needed[node_id]) {
+            continue;
+        }
+        const auto idx = ex.get_gene_idx()[node_id];
+        const auto arity = ex.get_arity(node_id);
+        std::vector<std::string> in;
+        for (auto j = 0u; j < arity; ++j) {
+            in.push_back(var(x[idx + 1u + j]));
+        }
+        const auto &kernel_name = ex.get_f()[x[idx]].get_name();
+        fast = fast || is_fast_kernel(kernel_name);
+        fast_tanh = fast_tanh || kernel_name == "tanh_fast";
+        emit_c_kernel(body, kernel_name, var(node_id), node_inputs(node_id, in), name);
+    }
+    for (auto i = 0u; i < ex.get_m(); ++i) {
+        body << "    out[" << i << "] = " << var(x[x.size() - ex.get_m() + i]) << ";\n";
+    }
+    std::ostringstream ss;
+    ss << "/* Generated by dcgp::c_source: " << n_in << " inputs, " << ex.get_m() << " outputs */\n";
+    ss << "#include <math.h>\n";
+    if (fast) {
+        ss << "#include <stdint.h>\n#include <string.h>\n\n" << c_fast_functions(name, fast_tanh);
+    } else {
+        ss << "\n";
+    }
+    ss << "void " << name << "(const double *x, double *out)\n{\n";
+    ss << "    (void)x;\n";
+    ss << body.str();
+    ss << "}\n";
+    return ss.str();
+}
+
+// The product of a kernel input and its weight (unit weights are skipped, as x * 1. is x)
+inline std::string c_weighted(const std::string &in, double w)
+{
+    return w == 1. ? in : "(" + in + " * " + c_literal(w) + ")";
+}
+
+} // namespace detail
+
+/// Exports a dCGP expression as C source
+/**
+ * Generates a self-contained C99 function evaluating the active phenotype of a dCGP expression:
+ *
+ * @code
+ * void name(const double *x, double *out);
+ * @endcode
+ *
+ * which computes in \p out the m outputs from the inputs \p x (n minus the number of ephemeral constants). Only the
+ * active nodes the outputs depend on are emitted, each as a few arithmetic statements, and the values of the
+ * ephemeral constants are written in the source. The code depends only on the C standard library (math.h, plus
+ * stdint.h and string.h if the approximate kernels are used), so that it can be embedded where the dcgp headers are
+ * not available and evaluated without any dispatch.
+ *
+ * The kernels are translated to the same floating point operations as in the library, so that, compiled without
+ * contraction of floating point operations (e.g. with -ffp-contract=off), the function returns the values of
+ * expression::operator() up to the rounding of the mathematical functions that the compiler may evaluate at compile
+ * time on the constants.
+ *
+ * @param[in] ex the expression. Its kernels must be among those of dcgp::kernel_set.
+ * @param[in] name the name of the C function.
+ *
+ * @return the C source.
+ *
+ * @throw std::invalid_argument if \p ex is not a plain expression<double>, if it contains kernels that cannot be
+ * exported or if \p name is not a valid C identifier.
+ */
+inline std::string c_source(const expression<double> &ex, const std::string &name = "dcgp_expression")
+{
+    // Derived expressions have a different semantics and are exported by the overloads below
+    if (typeid(ex) != typeid(expression<double>)) {
+        throw std::invalid_argument("Only expression<double> and its weighted and ANN versions can be exported");
+    }
+    return detail::c_function(ex, name, [](unsigned, const std::vector<std::string> &in) { return in; });
+}
+
+/// Exports a dCGP-weighted expression as C source
+/**
+ * As c_source(const expression<double> &, const std::string &), the weights being written in the source.
+ *
+ * @param[in] ex the dCGP-weighted expression. Its kernels must be among those of dcgp::kernel_set.
+ * @param[in] name the name of the C function.
+ *
+ * @return the C source.
+ *
+ * @throw std::invalid_argument if \p ex contains kernels that cannot be exported or if \p name is not a valid C
+ * identifier.
+ */
+inline std::string c_source(const expression_weighted<double> &ex, const std::string &name = "dcgp_expression")
+{
+    return detail::c_function(ex, name, [&ex](unsigned node_id, std::vector<std::string> in) {
+        // See expression_weighted::evaluate
+        const auto w_idx = ex.get_gene_idx()[node_id] - (node_id - ex.get_n());
+        for (auto j = 0u; j < in.size(); ++j) {
+            in[j] = detail::c_weighted(in[j], ex.get_weights()[w_idx + j]);
+        }
+        return in;
+    });
+}
+
+/// Exports a dCGP-ANN expression as C source
+/**
+ * As c_source(const expression<double> &, const std::string &), the weights and the biases being written in the
+ * source.
+ *
+ * @param[in] ex the dCGP-ANN expression.
+ * @param[in] name the name of the C function.
+ *
+ * @return the C source.
+ *
+ * @throw std::invalid_argument if \p name is not a valid C identifier.
+ */
+inline std::string c_source(const expression_ann<double> &ex, const std::string &name = "dcgp_expression")
+{
+    return detail::c_function(ex, name, [&ex](unsigned node_id, std::vector<std::string> in) {
+        // See expression_ann::fill_nodes
+        const auto w_idx = ex.get_gene_idx()[node_id] - (node_id - ex.get_n());
+        for (auto j = 0u; j < in.size(); ++j) {
+            in[j] = detail::c_weighted(in[j], ex.get_weights()[w_idx + j]);
+        }
+        in[0] = "(" + in[0] + " + " + detail::c_literal(ex.get_biases()[node_id - ex.get_n()]) + ")";
+        return in;
+    });
+}
+
+} // namespace dcgp
+
+#endif // DCGP_C_EXPORT_H
@@ -4,21 +4,31 @@
 #include <algorithm>
 #include <audi/functions.hpp>
 #include <audi/io.hpp>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <cassert>
+#include <cmath>
 #include <dcgp/config.hpp>
 #include <dcgp/kernel.hpp>
+#include <dcgp/kernel_registry.hpp>
 #include <dcgp/rng.hpp>
 #include <dcgp/type_traits.hpp>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <tbb/spin_mutex.h>
+#include <tbb/blocked_range.h>
 #include <tbb/tbb.h>
 #include <vector>
 
 #include <dcgp/kernel_set.hpp>
+#include <dcgp/static_kernel_set.hpp>
 namespace dcgp
 {
 
@@ -28,19 +38,64 @@ namespace dcgp
  * contains algorithms to compute its value (numerical and symbolical) and its
  * derivatives as well as to mutate the expression.
  *
- * @tparam T expression type. Can be double, or a gdual type.
+ * The expression can be saved to (and restored from) a Boost archive, binary or text: the chromosome, the dCGP
+ * parameters, the ephemeral constants and the state of the random engine are stored, while the kernels are stored by
+ * name and are looked up in dcgp::kernel_registry when loading. The archived kernels must thus be registered.
+ *
+ * The kernels, the arities and the gene bounds and positions never change after construction and are shared by the
+ * copies of an expression, so that copying an expression (e.g. the individuals of an evolutionary algorithm or the
+ * per-thread clones of a problem) only duplicates its chromosome, its ephemeral constants and the data structures
+ * derived from them.
+ *
+ * @tparam T expression type. Can be double, float, or a gdual type.
  */
 template <typename T>
 class expression
 {
 private:
     // Static checks.
-    static_assert(std::is_same<T, double>::value || is_gdual<T>::value,
-                  "A d-CGP expression can only be operating on doubles or gduals");
+    static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value || is_gdual<T>::value,
+                  "A d-CGP expression can only be operating on doubles, floats or gduals");
     // SFINAE dust
     template <typename U>
-    using functor_enabler = typename std::enable_if<
-        std::is_same<U, double>::value || is_gdual<T>::value || std::is_same<U, std::string>::value, int>::type;
+    using functor_enabler = typename std::enable_if<std::is_same<U, double>::value || std::is_same<U, float>::value
+                                                        || is_gdual<T>::value || std::is_same<U, std::string>::value,
+                                                    int>::type;
+    // The type counts are converted to when dividing by them: T itself for floating point types (to avoid mixed
+    // precision), double for gduals (which are cheaply divided by a scalar)
+    using count_type = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+protected:
+    // The parts of an expression fixed at construction. They are never modified, hence shared by all the copies
+    struct layout {
+        // function arity
+        std::vector<unsigned> arity;
+        // the functions allowed
+        std::vector<kernel<T>> f;
+        // the opcode of each kernel (custom if it is not called directly)
+        std::vector<kernel_opcode> f_op;
+        // lower and upper bounds on all genes
+        std::vector<unsigned> lb;
+        std::vector<unsigned> ub;
+        // The starting index in the chromosome of the genes expressing a node
+        std::vector<unsigned> gene_idx;
+    };
+
+    // A single instruction of the tape (the compiled phenotype)
+    struct instruction {
+        // the node id
+        unsigned node;
+        // the kernel id
+        unsigned f_id;
+        // the opcode of the kernel, when it is a built-in called directly (custom otherwise)
+        kernel_opcode op;
+        // the kernel arity
+        unsigned arity;
+        // the position in m_tape_in of the first input slot
+        unsigned in;
+        // the output slot
+        unsigned out;
+    };
 
 public:
     /// Loss types
@@ -75,15 +130,12 @@ public:
                std::vector<kernel<T>> f,    // functions
                unsigned n_eph,              // number of ephemeral constants
                unsigned seed = dcgp::random_device::next())
-        : m_n(n + n_eph), m_m(m), m_r(r), m_c(c), m_l(l), m_arity(arity), m_f(f), m_e(seed)
+        : m_n(n + n_eph), m_m(m), m_r(r), m_c(c), m_l(l), m_e(seed)
     {
-        // Sanity checks
-        sanity_checks();
-        // Initializing bounds and chromosome
-        init_bounds_and_chromosome();
+        init_layout(std::move(arity), std::move(f));
         // We generate a random chromosome (expression)
         for (auto i = 0u; i < m_x.size(); ++i) {
-            m_x[i] = std::uniform_int_distribution<unsigned>(m_lb[i], m_ub[i])(m_e);
+            m_x[i] = std::uniform_int_distribution<unsigned>(m_layout->lb[i], m_layout->ub[i])(m_e);
         }
         // We init the ephemeral constants with 1,2,3,4,5 ...
         for (auto i = 1u; i <= n_eph; ++i) {
@@ -121,17 +173,13 @@ public:
                std::vector<kernel<T>> f = kernel_set<T>({"sum"})(), // functions
                unsigned n_eph = 0u,                                 // number of ephemeral constants
                unsigned seed = dcgp::random_device::next())
-        : m_n(n + n_eph), m_m(m), m_r(r), m_c(c), m_l(l), m_f(f), m_e(seed)
+        : m_n(n + n_eph), m_m(m), m_r(r), m_c(c), m_l(l), m_e(seed)
     {
         // We fill the arity vector with the same number (uniform arity)
-        m_arity = std::vector<unsigned>(m_c, arity);
-        // Sanity checks
-        sanity_checks();
-        // Initializing bounds and chromosome
-        init_bounds_and_chromosome();
+        init_layout(std::vector<unsigned>(m_c, arity), std::move(f));
         // We generate a random chromosome (expression)
         for (auto i = 0u; i < m_x.size(); ++i) {
-            m_x[i] = std::uniform_int_distribution<unsigned>(m_lb[i], m_ub[i])(m_e);
+            m_x[i] = std::uniform_int_distribution<unsigned>(m_layout->lb[i], m_layout->ub[i])(m_e);
         }
         // We init the ephemeral constants with 1, 2, 3, 4, 5 ...
         for (auto i = 1u; i <= n_eph; ++i) {
@@ -157,6 +205,49 @@ public:
     /// Move assignment operator
     expression &operator=(expression &&) = default;
 
+    /// Evaluation workspace
+    /**
+     * Holds the buffers needed to evaluate the expression. Reusing the same workspace across calls to
+     * expression::evaluate avoids any heap allocation once the buffers have reached their needed size.
+     * A workspace must not be shared between threads.
+     */
+    struct workspace {
+        // the values of the nodes (or of the tape slots)
+        std::vector<T> node;
+        // the inputs of the kernel being called
+        std::vector<T> function_in;
+        // the inputs of the kernel being called over a block of points
+        std::vector<const T *> function_rows;
+        // the outputs of the expression (used when computing the loss)
+        std::vector<T> out;
+        // the values of the tape slots over a block of points (used by the batch evaluation), or of the
+        // recomputed nodes (used by the incremental evaluation)
+        std::vector<T> block;
+        // the row of block holding the values of each recomputed node (used by the incremental evaluation)
+        std::vector<T *> column;
+    };
+
+    /// Values of the nodes over a dataset
+    /**
+     * Holds a dataset and the values of the active nodes of an expression (the parent) over it. An expression
+     * differing from the parent by a few mutations can then be evaluated on the same dataset recomputing only the
+     * nodes downstream of the mutations (see expression::evaluate_incremental()). It is filled by
+     * expression::init_node_cache() and can be moved to a new parent by expression::update_node_cache().
+     */
+    struct node_cache {
+        // the number of points
+        unsigned N = 0u;
+        // the chromosome the values were computed with
+        std::vector<unsigned> x;
+        // the values of the ephemeral constants they were computed with
+        std::vector<T> eph_val;
+        // the values of each node over the points (empty for nodes not active in the parent)
+        std::vector<std::vector<T>> column;
+    };
+
+    /// Number of points processed together by expression::evaluate_batch
+    static constexpr unsigned batch_block_size = 64u;
+
     /// Evaluates the dCGP expression
     /**
      * This evaluates the dCGP expression.
@@ -168,33 +259,185 @@ public:
      */
     virtual std::vector<T> operator()(const std::vector<T> &point) const
     {
-        std::vector<T> point_expanded(point);
-        point_expanded.insert(point_expanded.end(), m_eph_val.begin(), m_eph_val.end());
-
-        if (point_expanded.size() != m_n) {
+        if (point.size() + m_eph_val.size() != m_n) {
             throw std::invalid_argument("Input size is incompatible");
         }
         std::vector<T> retval(m_m);
-        std::vector<T> node(m_n + m_r * m_c);
-        std::vector<T> function_in;
+        workspace ws;
+        evaluate(point.data(), retval.data(), ws);
+        return retval;
+    }
 
-        for (auto node_id : m_active_nodes) {
-            if (node_id < m_n) {
-                node[node_id] = point_expanded[node_id];
-            } else {
-                unsigned arity = _get_arity(node_id);
-                function_in.resize(arity);
-                unsigned idx = m_gene_idx[node_id]; // position in the chromosome of the current node
-                for (auto j = 0u; j < arity; ++j) {
-                    function_in[j] = node[m_x[idx + j + 1u]];
+    /// Evaluates the dCGP expression (using a workspace)
+    /**
+     * This evaluates the dCGP expression writing the outputs into a caller provided buffer and using
+     * the buffers of a caller provided workspace. When the same workspace is reused, no heap allocation
+     * takes place at steady state. No checks are made on the sizes of the input and output buffers.
+     *
+     * @param[in] point pointer to the values (n minus the number of ephemeral constants) where the dCGP expression has
+     * to be computed.
+     * @param[out] out pointer to the m values where the outputs will be written.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    virtual void evaluate(const T *point, T *out, workspace &ws) const
+    {
+        evaluate_impl<dynamic_dispatch>(point, out, ws);
+    }
+
+    /// Evaluates the dCGP expression on a batch of points
+    /**
+     * This evaluates the dCGP expression over a whole dataset at once. The points are processed in blocks
+     * of expression::batch_block_size and each instruction of the tape is run over all the points of a block
+     * before moving to the next one. For T = double or float, the built-in kernels (see dcgp::kernel_opcode) are run
+     * as tight loops the compiler can vectorize, user defined kernels are called point by point. The results are
+     * identical to those of the scalar evaluation. No checks are made on the sizes of the input and output buffers.
+     *
+     * @param[in] points pointer to a column-major matrix of size (n minus the number of ephemeral constants) x N,
+     * that is the point k starts at points + k * (n - n_eph).
+     * @param[out] out pointer to a column-major matrix of size m x N where the outputs will be written.
+     * @param[in] N number of points.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    virtual void evaluate_batch(const T *points, T *out, unsigned N, workspace &ws) const
+    {
+        evaluate_batch_impl<dynamic_dispatch>(points, out, N, ws);
+    }
+
+    /// Initializes a node cache
+    /**
+     * Stores a dataset into a node cache and computes the values of all the active nodes over it, so that the
+     * expression becomes the parent of the cache.
+     *
+     * @param[in] points pointer to a column-major matrix of size (n minus the number of ephemeral constants) x N,
+     * that is the point k starts at points + k * (n - n_eph).
+     * @param[in] N number of points.
+     * @param[out] nc the node cache.
+     */
+    void init_node_cache(const T *points, unsigned N, node_cache &nc) const
+    {
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        nc.N = N;
+        nc.x.clear();
+        nc.eph_val.clear();
+        nc.column.assign(m_n + m_r * m_c, std::vector<T>());
+        for (auto i = 0u; i < n_in; ++i) {
+            nc.column[i].resize(N);
+            for (auto k = 0u; k < N; ++k) {
+                nc.column[i][k] = points[k * n_in + i];
+            }
+        }
+        update_node_cache(nc);
+    }
+
+    /// Updates a node cache
+    /**
+     * Makes the expression the parent of a node cache (see expression::init_node_cache()), recomputing only the
+     * nodes that are not active in the previous parent or are downstream of a gene (or an ephemeral constant) that
+     * differs from it.
+     *
+     * @param[in,out] nc the node cache.
+     *
+     * @throw std::invalid_argument if the node cache was not initialized by an expression with the same structure.
+     */
+    virtual void update_node_cache(node_cache &nc) const
+    {
+        check_node_cache(nc);
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        // First we mark the nodes (and the ephemeral constants) to be recomputed ...
+        std::vector<char> changed(nc.column.size(), 0);
+        for (auto i = n_in; i < m_n; ++i) {
+            if (nc.eph_val.size() != m_eph_val.size() || !(nc.eph_val[i - n_in] == m_eph_val[i - n_in])) {
+                nc.column[i].assign(nc.N, m_eph_val[i - n_in]);
+                changed[i] = 1;
+            }
+        }
+        for (const auto &instr : m_tape) {
+            if (!reusable(instr.node, nc, [&changed](unsigned id) { return changed[id] != 0; })) {
+                nc.column[instr.node].resize(nc.N);
+                changed[instr.node] = 1;
+            }
+        }
+        // ... then we recompute them, block by block so that the values being used stay in cache
+        const unsigned B = batch_block_size;
+        workspace ws;
+        for (auto k0 = 0u; k0 < nc.N; k0 += B) {
+            auto b = std::min(B, nc.N - k0);
+            for (const auto &instr : m_tape) {
+                if (changed[instr.node]) {
+                    auto idx = m_layout->gene_idx[instr.node];
+                    auto in = [this, &nc, idx, k0](unsigned j) { return nc.column[m_x[idx + 1u + j]].data() + k0; };
+                    run_instruction(instr, in, nc.column[instr.node].data() + k0, b, ws);
                 }
-                node[node_id] = m_f[m_x[idx]](function_in);
             }
         }
-        for (auto i = 0u; i < m_m; ++i) {
-            retval[i] = node[m_x[m_x.size() - m_m + i]];
+        // The values of the nodes that are no longer active would become stale
+        for (auto node_id = m_n; node_id < nc.column.size(); ++node_id) {
+            if (!is_active(node_id)) {
+                std::vector<T>().swap(nc.column[node_id]);
+            }
+        }
+        nc.x = m_x;
+        nc.eph_val = m_eph_val;
+    }
+
+    /// Evaluates the dCGP expression incrementally on the dataset of a node cache
+    /**
+     * Evaluates the dCGP expression on all the points of the dataset stored in a node cache, reusing the values
+     * cached for the parent (see expression::init_node_cache()) and recomputing only the nodes that are downstream
+     * of a gene (or an ephemeral constant) differing from it. As in expression::evaluate_batch(), the points are
+     * processed in blocks of expression::batch_block_size and the results are identical. The node cache is not
+     * modified, so that it can be shared by several threads evaluating different mutants of the same parent, each
+     * one with its own workspace.
+     *
+     * @param[in] nc the node cache.
+     * @param[out] out pointer to a column-major matrix of size m x N where the outputs will be written.
+     * @param[in,out] ws the evaluation workspace.
+     *
+     * @throw std::invalid_argument if the node cache was not initialized by an expression with the same structure.
+     */
+    virtual void evaluate_incremental(const node_cache &nc, T *out, workspace &ws) const
+    {
+        check_node_cache(nc);
+        const unsigned B = batch_block_size;
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        // The nodes (and the ephemeral constants) to be recomputed get a row of ws.block, the others are
+        // marked with a nullptr and read from the node cache
+        ws.block.resize((m_n - n_in + m_tape.size()) * B);
+        ws.column.assign(nc.column.size(), nullptr);
+        T *row = ws.block.data();
+        for (auto i = n_in; i < m_n; ++i) {
+            if (nc.eph_val.size() != m_eph_val.size() || !(nc.eph_val[i - n_in] == m_eph_val[i - n_in])) {
+                std::fill(row, row + B, m_eph_val[i - n_in]);
+                ws.column[i] = row;
+                row += B;
+            }
+        }
+        const auto &column = ws.column;
+        for (const auto &instr : m_tape) {
+            if (!reusable(instr.node, nc, [&column](unsigned id) { return column[id] != nullptr; })) {
+                ws.column[instr.node] = row;
+                row += B;
+            }
+        }
+        for (auto k0 = 0u; k0 < nc.N; k0 += B) {
+            auto b = std::min(B, nc.N - k0);
+            auto values = [&nc, &column, k0](unsigned id) {
+                return column[id] != nullptr ? static_cast<const T *>(column[id]) : nc.column[id].data() + k0;
+            };
+            for (const auto &instr : m_tape) {
+                if (column[instr.node] != nullptr) {
+                    auto idx = m_layout->gene_idx[instr.node];
+                    run_instruction(instr, [this, &values, idx](unsigned j) { return values(m_x[idx + 1u + j]); },
+                                    column[instr.node], b, ws);
+                }
+            }
+            for (auto i = 0u; i < m_m; ++i) {
+                const T *res = values(m_x[m_x.size() - m_m + i]);
+                for (auto p = 0u; p < b; ++p) {
+                    out[(k0 + p) * m_m + i] = res[p];
+                }
+            }
         }
-        return retval;
     }
 
     /// Evaluates the dCGP expression (from initializer list)
@@ -206,9 +449,9 @@ public:
      *
      * @return The value of the function (an std::vector)
      */
-    std::vector<double> operator()(const std::initializer_list<double> &in) const
+    std::vector<T> operator()(const std::initializer_list<T> &in) const
     {
-        std::vector<double> dummy(in);
+        std::vector<T> dummy(in);
         return (*this)(dummy);
     }
 
@@ -223,30 +466,18 @@ public:
      */
     virtual std::vector<std::string> operator()(const std::vector<std::string> &in) const
     {
-        std::vector<std::string> point(in);
-        point.insert(point.end(), m_eph_symb.begin(), m_eph_symb.end());
-        if (point.size() != m_n) {
+        if (in.size() + m_eph_symb.size() != m_n) {
             throw std::invalid_argument("Input size is incompatible");
         }
         std::vector<std::string> retval(m_m);
-        std::vector<std::string> node(m_n + m_r * m_c);
+        std::vector<std::string> slot(m_n + m_tape.size());
+        std::copy(in.begin(), in.end(), slot.begin());
+        std::copy(m_eph_symb.begin(), m_eph_symb.end(), slot.begin() + static_cast<std::ptrdiff_t>(in.size()));
         std::vector<std::string> function_in;
-
-        for (auto node_id : m_active_nodes) {
-            if (node_id < m_n) {
-                node[node_id] = point[node_id];
-            } else {
-                unsigned arity = _get_arity(node_id);
-                function_in.resize(arity);
-                unsigned idx = m_gene_idx[node_id]; // position in the chromosome of the current node
-                for (auto j = 0u; j < arity; ++j) {
-                    function_in[j] = node[m_x[idx + j + 1u]];
-                }
-                node[node_id] = m_f[m_x[idx]](function_in);
-            }
-        }
+        // No constant is folded in the symbolic representation
+        run_tape(slot, function_in, 0u);
         for (auto i = 0u; i < m_m; ++i) {
-            retval[i] = node[m_x[m_x.size() - m_m + i]];
+            retval[i] = slot[m_tape_out[i]];
         }
         return retval;
     }
@@ -266,6 +497,97 @@ public:
         return (*this)(dummy);
     }
 
+    /// Evaluates the dCGP expression (symbolic, with shared subexpressions)
+    /**
+     * The symbolic form returned by operator()(const std::vector<std::string> &) inlines the representation of each
+     * node wherever it is used, so that its length can grow exponentially with the depth of the graph. This returns
+     * instead one binding per active node, in evaluation order, where each node is applied to the names of its inputs
+     * (the symbols for the input nodes, \f$t_i\f$ for the node \f$i\f$), followed by one binding per output. E.g.:
+     *
+     * @code
+     * {"t3 = (x0*x1)", "t4 = (t3+t3)", "y0 = t4"}
+     * @endcode
+     *
+     * Both its time and its size are linear in the number of active nodes.
+     *
+     * @param[in] in the symbols to use for the inputs.
+     *
+     * @return the bindings.
+     *
+     * @throw std::invalid_argument if the number of symbols is incompatible with the expression.
+     */
+    std::vector<std::string> symbolic_dag(const std::vector<std::string> &in) const
+    {
+        if (in.size() + m_eph_symb.size() != m_n) {
+            throw std::invalid_argument("Input size is incompatible");
+        }
+        std::vector<std::string> retval, function_in;
+        for (auto node_id : m_active_nodes) {
+            if (node_id < m_n) {
+                continue;
+            }
+            auto arity = _get_arity(node_id);
+            function_in.resize(arity);
+            for (auto j = 0u; j < arity; ++j) {
+                function_in[j] = node_symbol(in, m_x[m_layout->gene_idx[node_id] + j + 1u]);
+            }
+            retval.push_back("t" + std::to_string(node_id) + " = " + print_node(node_id, function_in));
+        }
+        for (auto i = 0u; i < m_m; ++i) {
+            retval.push_back("y" + std::to_string(i) + " = " + node_symbol(in, m_x[m_x.size() - m_m + i]));
+        }
+        return retval;
+    }
+
+    /// Length of the symbolic representation
+    /**
+     * Computes the lengths of the strings returned by operator()(const std::vector<std::string> &), without building
+     * them. Each active node is printed once, on placeholder inputs, so that the time is linear in the number of
+     * active nodes even when the strings are exponentially long.
+     *
+     * @param[in] in the symbols to use for the inputs.
+     *
+     * @return the length of the symbolic representation of each output.
+     *
+     * @throw std::invalid_argument if the number of symbols is incompatible with the expression.
+     */
+    std::vector<double> symbolic_length(const std::vector<std::string> &in) const
+    {
+        if (in.size() + m_eph_symb.size() != m_n) {
+            throw std::invalid_argument("Input size is incompatible");
+        }
+        std::vector<double> length(m_n + m_r * m_c, 0.), retval(m_m);
+        for (auto i = 0u; i < m_n; ++i) {
+            length[i] = static_cast<double>(node_symbol(in, i).length());
+        }
+        std::vector<std::string> placeholder, function_in;
+        for (auto node_id : m_active_nodes) {
+            if (node_id < m_n) {
+                continue;
+            }
+            auto arity = _get_arity(node_id);
+            // The placeholders of the inputs cannot appear in a printed kernel
+            while (placeholder.size() < arity) {
+                placeholder.push_back("\x01" + std::to_string(placeholder.size()) + "\x02");
+            }
+            function_in.assign(placeholder.begin(), placeholder.begin() + arity);
+            auto printed = print_node(node_id, function_in);
+            // Each occurrence of a placeholder is replaced by the representation of the input
+            length[node_id] = static_cast<double>(printed.length());
+            for (auto j = 0u; j < arity; ++j) {
+                auto input_length = length[m_x[m_layout->gene_idx[node_id] + j + 1u]];
+                for (auto pos = printed.find(placeholder[j]); pos != std::string::npos;
+                     pos = printed.find(placeholder[j], pos + placeholder[j].length())) {
+                    length[node_id] += input_length - static_cast<double>(placeholder[j].length());
+                }
+            }
+        }
+        for (auto i = 0u; i < m_m; ++i) {
+            retval[i] = length[m_x[m_x.size() - m_m + i]];
+        }
+        return retval;
+    }
+
     /// Evaluates the model loss (single data point)
     /**
      * Returns the model loss over a single point of data of the dCGP output.
@@ -278,58 +600,66 @@ public:
      */
     T loss(const std::vector<T> &point, const std::vector<T> &prediction, loss_type loss_e) const
     {
-        if (point.size() != this->get_n() - m_eph_val.size()) {
-            throw std::invalid_argument("When computing the loss, the point dimension (input) seemed wrong, it was: "
-                                        + std::to_string(point.size())
-                                        + " while I expected: " + std::to_string(this->get_n() - m_eph_val.size()));
-        }
-        if (prediction.size() != this->get_m()) {
-            throw std::invalid_argument(
-                "When computing the loss the prediction dimension (output) seemed wrong, it was: "
-                + std::to_string(prediction.size()) + " while I expected: " + std::to_string(this->get_m()));
-        }
-        T retval(0.);
+        workspace ws;
+        return loss(point, prediction, loss_e, ws);
+    }
 
-        auto outputs = this->operator()(point);
-        switch (loss_e) {
-            // Mean Square Error
-            case loss_type::MSE: {
-                for (decltype(outputs.size()) i = 0u; i < outputs.size(); ++i) {
-                    retval += (outputs[i] - prediction[i]) * (outputs[i] - prediction[i]);
-                }
-                retval /= static_cast<double>(outputs.size());
-                break; // and exits the switch
-            }
-            // Cross Entropy
-            case loss_type::CE: {
-                // We guard from numerical instabilities subtracting the max element
-                auto max = *std::max_element(outputs.begin(), outputs.end());
-                // exp(a_i - max)
-                std::transform(outputs.begin(), outputs.end(), outputs.begin(),
-                               [max](T a) { return audi::exp(a - max); });
-                // sum exp(a_i - max)
-                T cumsum = std::accumulate(outputs.begin(), outputs.end(), T(0.));
-                // log(p_i) * y_i
-                std::transform(outputs.begin(), outputs.end(), prediction.begin(), outputs.begin(),
-                               [cumsum](T a, T y) { return audi::log(a / cumsum) * y; });
-                // - sum log(p_i) y_i
-                retval = -std::accumulate(outputs.begin(), outputs.end(), T(0.));
-                break;
-            }
-        }
-        return retval;
+    /// Evaluates the model loss (single data point, using a workspace)
+    /**
+     * Returns the model loss over a single point of data of the dCGP output. The buffers of
+     * the workspace are used to evaluate the expression, so that repeated calls do not allocate.
+     *
+     * @param[point] The input data (single point)
+     * @param[prediction] The predicted output (single point)
+     * @param[loss_e] The loss type. Can be "MSE" for Mean Square Error (regression) or "CE" for Cross Entropy
+     * (classification)
+     * @param[ws] The evaluation workspace
+     * @return the computed loss
+     */
+    T loss(const std::vector<T> &point, const std::vector<T> &prediction, loss_type loss_e, workspace &ws) const
+    {
+        check_loss_dimensions(point, prediction);
+        auto &outputs = ws.out;
+        outputs.resize(m_m);
+        evaluate(point.data(), outputs.data(), ws);
+        return output_loss([&outputs](unsigned i) -> const T & { return outputs[i]; }, prediction.data(), loss_e);
+    }
+
+    /// Accumulates the model loss over a batch of points
+    /**
+     * Adds the loss of each point of a batch to \p retval, in order. The points are evaluated in blocks of
+     * expression::batch_block_size as in expression::evaluate_batch() and the loss of each point is reduced directly
+     * from the slots of the output nodes, so that no outputs are stored.
+     *
+     * @param[in] points pointer to the first of the \p N input points.
+     * @param[in] labels pointer to the first of the \p N labels.
+     * @param[in] N number of points.
+     * @param[in] loss_e the loss type.
+     * @param[in,out] retval the value the losses of the points are added to.
+     * @param[in,out] ws the evaluation workspace.
+     *
+     * @throw std::invalid_argument if the dimension of a point or of a label is wrong.
+     */
+    virtual void accumulate_loss(const std::vector<T> *points, const std::vector<T> *labels, unsigned N,
+                                 loss_type loss_e, T &retval, workspace &ws) const
+    {
+        accumulate_loss_impl<dynamic_dispatch>(points, labels, N, loss_e, retval, ws);
     }
 
     /// Evaluates the model loss (on a batch)
     /**
-     * Evaluates the model loss over a batch.
+     * Evaluates the model loss over a batch. In parallel, the data is split into at most
+     * expression::max_loss_chunks chunks of at least expression::batch_block_size consecutive points, which are
+     * evaluated by parallel tasks, and the partial sums are then added in a fixed order. The chunks only depend on the
+     * batch size, hence the result is the same for any value of \p parallel, any number of threads and any
+     * scheduling (it may differ, in the last bits, from the serial result).
      *
      * @param[points] The input data (a batch).
      * @param[labels] The predicted outputs (a batch).
      * @param[loss_s] The loss type. Can be "MSE" for Mean Square Error (regression) or "CE" for Cross Entropy
      * (classification)
-     * @param[parallel] sets the grain for parallelism. 0 -> no parallelism n -> divides the data into n parts and
-     * evaluates them in parallel threads.
+     * @param[parallel] 0 -> no parallelism, otherwise the chunks of data are evaluated in parallel threads (the value
+     * is otherwise ignored).
      * @return the loss
      */
     T loss(const std::vector<std::vector<T>> &points, const std::vector<std::vector<T>> &labels,
@@ -344,15 +674,64 @@ public:
         if (points.size() == 0) {
             throw std::invalid_argument("Data size cannot be zero");
         }
-        loss_type loss_e;
-        if (loss_s == "MSE") { // Mean Squared Error
-            loss_e = loss_type::MSE;
-        } else if (loss_s == "CE") {
-            loss_e = loss_type::CE; // Cross Entropy
-        } else {
-            throw std::invalid_argument("The requested loss was: " + loss_s + " while only MSE and CE are allowed");
+        return loss(points.begin(), points.end(), labels.begin(), get_loss_type(loss_s), parallel);
+    }
+
+    /// Evaluates the model loss (on a batch, with an upper bound)
+    /**
+     * Evaluates the model loss over a batch, stopping as soon as the loss is known to exceed an upper bound (e.g.
+     * the loss of a parent expression). Since the loss of each point is non negative (for the CE loss this requires
+     * non negative labels), the loss is larger than the bound as soon as the sum of the losses of the points visited
+     * so far, divided by the batch size, is. The points are evaluated in blocks of expression::batch_block_size
+     * (see expression::accumulate_loss()) and the blocks are visited with a fixed stride (0, stride, 2 stride, ...,
+     * then 1, 1 + stride, ...), so that the first points visited are spread over the whole batch when the data is
+     * sorted. With a unit stride, the loss is identical to that computed by expression::loss().
+     *
+     * @param[points] The input data (a batch).
+     * @param[labels] The predicted outputs (a batch).
+     * @param[loss_s] The loss type. Can be "MSE" for Mean Square Error (regression) or "CE" for Cross Entropy
+     * (classification)
+     * @param[bound] The upper bound.
+     * @param[stride] The stride used to visit the blocks of points.
+     *
+     * @return the loss if it does not exceed \p bound, otherwise a lower bound of the loss larger than \p bound.
+     *
+     * @throw std::invalid_argument if points and labels have different or zero size, if their dimensions are wrong,
+     * if the loss type is unknown or if the stride is zero.
+     */
+    template <typename U = T, typename std::enable_if<std::is_floating_point<U>::value, int>::type = 0>
+    T bounded_loss(const std::vector<std::vector<T>> &points, const std::vector<std::vector<T>> &labels,
+                   const std::string &loss_s, T bound, unsigned stride = 1u) const
+    {
+        if (points.size() != labels.size()) {
+            throw std::invalid_argument("Data and label size mismatch data size is: " + std::to_string(points.size())
+                                        + " while label size is: " + std::to_string(labels.size()));
+        }
+        if (points.size() == 0) {
+            throw std::invalid_argument("Data size cannot be zero");
+        }
+        if (stride == 0u) {
+            throw std::invalid_argument("The stride cannot be zero");
         }
-        return loss(points.begin(), points.end(), labels.begin(), loss_e, parallel);
+        auto loss_e = get_loss_type(loss_s);
+        const unsigned B = batch_block_size;
+        auto N = static_cast<unsigned>(points.size());
+        auto n_blocks = (N + B - 1u) / B;
+        // The loss exceeds the bound as soon as the partial sum exceeds this threshold
+        T threshold = bound * static_cast<T>(N);
+        T retval(0.);
+        workspace ws;
+        for (auto r = 0u; r < stride && r < n_blocks; ++r) {
+            for (auto block = r; block < n_blocks; block += stride) {
+                auto k0 = block * B;
+                accumulate_loss(points.data() + k0, labels.data() + k0, std::min(B, N - k0), loss_e, retval, ws);
+                if (retval > threshold) {
+                    return retval / static_cast<T>(N);
+                }
+            }
+        }
+        retval /= static_cast<T>(N);
+        return retval;
     }
 
     /// Sets the chromosome
@@ -381,18 +760,19 @@ public:
      */
     void set_f_gene(unsigned node_id, unsigned f_id)
     {
-        if (f_id > m_f.size() - 1) {
+        if (f_id > m_layout->f.size() - 1) {
             throw std::invalid_argument("You are trying to set a kernel id of: " + std::to_string(f_id)
-                                        + ", but allowed values are [0 ... " + std::to_string(m_f.size() - 1)
-                                        + "] since this CGP has " + std::to_string(m_f.size() - 1) + " kernels.");
+                                        + ", but allowed values are [0 ... " + std::to_string(m_layout->f.size() - 1)
+                                        + "] since this CGP has " + std::to_string(m_layout->f.size() - 1)
+                                        + " kernels.");
         }
         if (node_id < m_n || node_id > m_n + m_c * m_r - 1u) {
             throw std::invalid_argument("You are trying to set the gene corresponding to a node_id: "
                                         + std::to_string(node_id) + ", but allowed values are [" + std::to_string(m_n)
                                         + " ... " + std::to_string(m_n + m_c * m_r - 1u) + "]");
         }
-        auto gene_idx = m_gene_idx[node_id];
-        m_x[gene_idx] = f_id;
+        set_gene(m_layout->gene_idx[node_id], f_id);
+        update_active_nodes();
     }
 
     /// Sets the values of ephemeral constants
@@ -410,6 +790,7 @@ public:
                 + ", while you are trying to set their values with a vector of size " + std::to_string(eph_val.size()));
         }
         m_eph_val = eph_val;
+        fold_constants();
     }
 
     /// Sets the values of ephemeral constants
@@ -473,7 +854,7 @@ public:
      */
     const std::vector<unsigned> &get_lb() const
     {
-        return m_lb;
+        return m_layout->lb;
     }
 
     /// Gets the upper bounds
@@ -484,7 +865,7 @@ public:
      */
     const std::vector<unsigned> &get_ub() const
     {
-        return m_ub;
+        return m_layout->ub;
     }
 
     /// Gets the active genes
@@ -513,6 +894,49 @@ public:
         return m_active_nodes;
     }
 
+    /// Gets the phenotype
+    /**
+     * Gets the part of the chromosome that is expressed: for each active (non input) node its id, its function gene
+     * and its connection genes, followed by the output genes. Two chromosomes differing only in inactive genes have
+     * the same phenotype.
+     *
+     * @return An std::vector containing the phenotype
+     */
+    std::vector<unsigned> get_phenotype() const
+    {
+        std::vector<unsigned> retval;
+        retval.reserve(m_active_nodes.size() + m_active_genes.size());
+        for (auto node_id : m_active_nodes) {
+            if (node_id >= m_n) {
+                retval.push_back(node_id);
+                retval.insert(retval.end(), m_x.begin() + m_layout->gene_idx[node_id],
+                              m_x.begin() + m_layout->gene_idx[node_id] + _get_arity(node_id) + 1u);
+            }
+        }
+        retval.insert(retval.end(), m_x.end() - m_m, m_x.end());
+        return retval;
+    }
+
+    /// Hashes the phenotype
+    /**
+     * Computes a hash of the phenotype (see expression::get_phenotype()) and of the values of the ephemeral
+     * constants. Chromosomes differing only in inactive genes have the same hash, so that it can be used to
+     * key caches of quantities (e.g. the loss) that only depend on what the expression computes.
+     *
+     * @return the hash of the phenotype
+     */
+    std::size_t phenotype_hash() const
+    {
+        std::size_t seed = 0u;
+        for (auto gene : get_phenotype()) {
+            hash_combine(seed, std::hash<unsigned>()(gene));
+        }
+        for (const auto &val : m_eph_val) {
+            hash_combine(seed, value_hash(val));
+        }
+        return seed;
+    }
+
     /// Gets the number of inputs
     /**
      * Gets the number of inputs of the dCGP expression
@@ -576,7 +1000,7 @@ public:
      */
     const std::vector<unsigned> &get_arity() const
     {
-        return m_arity;
+        return m_layout->arity;
     }
 
     /// Gets the arity of a particular node
@@ -595,7 +1019,7 @@ public:
                                         + "] are valid");
         }
         unsigned col = (node_id - m_n) / m_r;
-        return m_arity[col];
+        return m_layout->arity[col];
     }
 
     /// Gets the function set
@@ -606,7 +1030,7 @@ public:
      */
     const std::vector<kernel<T>> &get_f() const
     {
-        return m_f;
+        return m_layout->f;
     }
 
     /// Gets gene_idx
@@ -618,7 +1042,7 @@ public:
      */
     const std::vector<unsigned> &get_gene_idx() const
     {
-        return m_gene_idx;
+        return m_layout->gene_idx;
     }
 
     /// Mutates randomly one gene
@@ -627,23 +1051,27 @@ public:
      *
      * @param[in] idx index of the gene to me mutated
      *
+     * @return true if the phenotype changed, false if the mutation was neutral (e.g. an inactive gene was mutated).
+     *
      * @throw std::invalid_argument if \p idx is too large
      */
-    void mutate(unsigned idx)
+    bool mutate(unsigned idx)
     {
         if (idx >= m_x.size()) {
             throw std::invalid_argument("idx of gene to be mutated is out of bounds");
         }
+        bool retval = false;
         // If only one value is allowed for the gene, (lb==ub),
         // then we will not do anything as mutation does not apply
-        if (m_lb[idx] < m_ub[idx]) {
+        if (m_layout->lb[idx] < m_layout->ub[idx]) {
             unsigned new_value;
             do {
-                new_value = std::uniform_int_distribution<unsigned>(m_lb[idx], m_ub[idx])(m_e);
+                new_value = std::uniform_int_distribution<unsigned>(m_layout->lb[idx], m_layout->ub[idx])(m_e);
             } while (new_value == m_x[idx]);
-            m_x[idx] = new_value;
-            update_data_structures(); // TODO: unecessary if the gene is a function gene
+            retval = set_gene(idx, new_value);
+            update_active_nodes();
         }
+        return retval;
     }
 
     /// Mutates multiple genes at once
@@ -652,27 +1080,31 @@ public:
      *
      * @param[in] idxs vector of indexes of the genes to me mutated
      *
+     * @return true if the phenotype may have changed, false if all mutations were neutral.
+     *
      * @throw std::invalid_argument if \p idx is too large
      */
-    void mutate(std::vector<unsigned> idxs)
+    bool mutate(std::vector<unsigned> idxs)
     {
-        bool flag = false;
+        bool flag = false, retval = false;
         for (auto i = 0u; i < idxs.size(); ++i) {
             if (idxs[i] >= m_x.size()) {
                 throw std::invalid_argument("idx of gene to be mutated is out of bounds");
             }
             // If only one value is allowed for the gene, (lb==ub),
             // then we will not do anything as mutation does not apply
-            if (m_lb[idxs[i]] < m_ub[idxs[i]]) {
+            if (m_layout->lb[idxs[i]] < m_layout->ub[idxs[i]]) {
                 unsigned new_value;
                 do {
-                    new_value = std::uniform_int_distribution<unsigned>(m_lb[idxs[i]], m_ub[idxs[i]])(m_e);
+                    new_value
+                        = std::uniform_int_distribution<unsigned>(m_layout->lb[idxs[i]], m_layout->ub[idxs[i]])(m_e);
                 } while (new_value == m_x[idxs[i]]);
-                m_x[idxs[i]] = new_value;
+                retval = set_gene(idxs[i], new_value) || retval;
                 flag = true;
             }
         }
-        if (flag) update_data_structures();
+        if (flag) update_active_nodes();
+        return retval;
     }
 
     /// Mutates N random genes
@@ -681,24 +1113,26 @@ public:
      *
      * @param[in] N number of genes to be mutated
      *
+     * @return true if the phenotype may have changed, false if all mutations were neutral.
      */
-    void mutate_random(unsigned N)
+    bool mutate_random(unsigned N)
     {
-        bool flag = false;
+        bool flag = false, retval = false;
         for (auto i = 0u; i < N; ++i) {
             // If only one value is allowed for the gene, (lb==ub),
             // then we will not do anything as mutation does not apply
-            auto idx = std::uniform_int_distribution<unsigned>(0, m_lb.size() - 1)(m_e);
-            if (m_lb[idx] < m_ub[idx]) {
+            auto idx = std::uniform_int_distribution<unsigned>(0, m_layout->lb.size() - 1)(m_e);
+            if (m_layout->lb[idx] < m_layout->ub[idx]) {
                 unsigned new_value;
                 do {
-                    new_value = std::uniform_int_distribution<unsigned>(m_lb[idx], m_ub[idx])(m_e);
+                    new_value = std::uniform_int_distribution<unsigned>(m_layout->lb[idx], m_layout->ub[idx])(m_e);
                 } while (new_value == m_x[idx]);
-                m_x[idx] = new_value;
+                retval = set_gene(idx, new_value) || retval;
                 flag = true;
             }
         }
-        if (flag) update_data_structures();
+        if (flag) update_active_nodes();
+        return retval;
     }
 
     /// Mutates active genes
@@ -708,23 +1142,29 @@ public:
      *
      * @param[in] N Number of active genes to be mutated
      *
+     * @return true if the phenotype may have changed, false if all mutations were neutral.
      */
-    void mutate_active(unsigned N = 1)
+    bool mutate_active(unsigned N = 1)
     {
+        bool retval = false;
         for (auto i = 0u; i < N; ++i) {
             unsigned idx
                 = std::uniform_int_distribution<unsigned>(0, static_cast<unsigned>(m_active_genes.size() - 1u))(m_e);
             idx = m_active_genes[idx];
-            mutate(idx);
+            retval = mutate(idx) || retval;
         }
+        return retval;
     }
 
     /// Mutates one of the active function genes
     /**
      * Mutates exactly one of the active function genes within its allowed bounds.
+     *
+     * @return true if the phenotype may have changed, false if all mutations were neutral.
      */
-    void mutate_active_fgene(unsigned N = 1u)
+    bool mutate_active_fgene(unsigned N = 1u)
     {
+        bool retval = false;
         // If no active function gene exists, do nothing
         if (m_active_genes.size() > m_m) {
             for (auto i = 0u; i < N; ++i) {
@@ -734,18 +1174,22 @@ public:
                         0, static_cast<unsigned>(m_active_nodes.size() - 1u))(m_e)];
                 }
                 // Since the first gene, for each node, is the function gene, we just mutate on that position
-                mutate(m_gene_idx[node_id]);
+                retval = mutate(m_layout->gene_idx[node_id]) || retval;
             }
         }
+        return retval;
     }
 
     /// Mutates one of the active connection genes
     /**
      * Mutates exactly one of the active connection genes within its allowed
      * bounds.
+     *
+     * @return true if the phenotype may have changed, false if all mutations were neutral.
      */
-    void mutate_active_cgene(unsigned N = 1u)
+    bool mutate_active_cgene(unsigned N = 1u)
     {
+        bool retval = false;
         // If no active function gene exists, do nothing
         if (m_active_genes.size() > m_m) {
             for (auto i = 0u; i < N; ++i) {
@@ -754,17 +1198,20 @@ public:
                     idx = m_active_nodes[std::uniform_int_distribution<unsigned>(
                         0, static_cast<unsigned>(m_active_nodes.size() - 1u))(m_e)];
                 }
-                idx = m_gene_idx[idx] + std::uniform_int_distribution<unsigned>(1, _get_arity(idx))(m_e);
-                mutate(idx);
+                idx = m_layout->gene_idx[idx] + std::uniform_int_distribution<unsigned>(1, _get_arity(idx))(m_e);
+                retval = mutate(idx) || retval;
             }
         }
+        return retval;
     }
 
     /// Mutates one of the active output genes
     /**
      * Mutates exactly one of the output genes within its allowed bounds.
+     *
+     * @return true if the phenotype changed, false if the mutation was neutral.
      */
-    void mutate_ogene(unsigned N = 1)
+    bool mutate_ogene(unsigned N = 1)
     {
         unsigned idx;
         if (m_m > 1) {
@@ -777,7 +1224,7 @@ public:
             idx = static_cast<unsigned>(m_active_genes.size() - 1u);
         }
         idx = m_active_genes[idx];
-        mutate(idx);
+        return mutate(idx);
     }
 
     /// Sets the internal seed
@@ -798,7 +1245,8 @@ public:
      */
     bool is_active(const unsigned node_id) const
     {
-        return (std::find(m_active_nodes.begin(), m_active_nodes.end(), node_id) != m_active_nodes.end());
+        // A node is active iff it is referenced by an active node or by an output gene (constant time)
+        return node_id < m_n_refs.size() && m_n_refs[node_id] > 0u;
     }
 
     /// Overloaded stream operator
@@ -817,14 +1265,14 @@ public:
         audi::stream(os, "\tNumber of rows:\t\t\t", d.m_r, '\n');
         audi::stream(os, "\tNumber of columns:\t\t", d.m_c, '\n');
         audi::stream(os, "\tNumber of levels-back allowed:\t", d.m_l, '\n');
-        audi::stream(os, "\tBasis function arity:\t\t", d.m_arity, '\n');
-        audi::stream(os, "\tStart of the gene expressing the node:\t\t", d.m_gene_idx, '\n');
-        audi::stream(os, "\n\tResulting lower bounds:\t", d.m_lb);
-        audi::stream(os, "\n\tResulting upper bounds:\t", d.m_ub, '\n');
+        audi::stream(os, "\tBasis function arity:\t\t", d.m_layout->arity, '\n');
+        audi::stream(os, "\tStart of the gene expressing the node:\t\t", d.m_layout->gene_idx, '\n');
+        audi::stream(os, "\n\tResulting lower bounds:\t", d.m_layout->lb);
+        audi::stream(os, "\n\tResulting upper bounds:\t", d.m_layout->ub, '\n');
         audi::stream(os, "\n\tCurrent expression (encoded):\t", d.m_x, '\n');
         audi::stream(os, "\tActive nodes:\t\t\t", d.m_active_nodes, '\n');
         audi::stream(os, "\tActive genes:\t\t\t", d.m_active_genes, '\n');
-        audi::stream(os, "\n\tFunction set:\t\t\t", d.m_f, '\n');
+        audi::stream(os, "\n\tFunction set:\t\t\t", d.m_layout->f, '\n');
         audi::stream(os, "\tNumber of ephemeral constants:\t\t\t", d.get_eph_val().size(), '\n');
         audi::stream(os, "\tEphemeral constants names:\t\t\t", d.get_eph_symb(), '\n');
         audi::stream(os, "\tEphemeral constants values:\t\t\t", d.get_eph_val(), '\n');
@@ -832,6 +1280,22 @@ public:
     }
 
 protected:
+    /// Prints a node
+    /**
+     * Returns the symbolic representation of an active node applied to the given inputs. It is used by
+     * expression::symbolic_dag() and expression::symbolic_length(), and overridden by the expressions whose nodes
+     * also have weights or biases.
+     *
+     * @param[in] node_id the node id.
+     * @param[in,out] function_in the symbols of the node inputs (may be modified).
+     *
+     * @return the symbolic representation of the node.
+     */
+    virtual std::string print_node(unsigned node_id, std::vector<std::string> &function_in) const
+    {
+        return m_layout->f[m_x[m_layout->gene_idx[node_id]]](function_in);
+    }
+
     /// Validity of the CGP encoding
     /**
      * Checks if a CGP encoding (i.e. a sequence of integers) is a valid expression
@@ -842,18 +1306,18 @@ protected:
     bool check_cgp_encoding(const std::vector<unsigned> &xu) const
     {
         // Checking for length
-        if (xu.size() != m_lb.size()) {
+        if (xu.size() != m_layout->lb.size()) {
             throw std::invalid_argument("Inconsistent chromosome: length of the chromosome is : "
                                         + std::to_string(xu.size())
-                                        + ", while it should be: " + std::to_string(m_lb.size()));
+                                        + ", while it should be: " + std::to_string(m_layout->lb.size()));
         }
         // Checking for bounds on all genes
         for (auto i = 0u; i < xu.size(); ++i) {
-            if ((xu[i] > m_ub[i]) || (xu[i] < m_lb[i])) {
+            if ((xu[i] > m_layout->ub[i]) || (xu[i] < m_layout->lb[i])) {
                 throw std::invalid_argument("Inconsistent chromosome: out of bounds. The component " + std::to_string(i)
                                             + " of the chromosome is " + std::to_string(xu[i])
-                                            + " while the bounds are: [" + std::to_string(m_lb[i]) + " " + ", "
-                                            + std::to_string(m_ub[i]) + "]");
+                                            + " while the bounds are: [" + std::to_string(m_layout->lb[i]) + " " + ", "
+                                            + std::to_string(m_layout->ub[i]) + "]");
             }
         }
         return true;
@@ -871,20 +1335,22 @@ protected:
     {
         assert(node_id >= m_n && node_id < m_n + m_r * m_c);
         unsigned col = (node_id - m_n) / m_r;
-        return m_arity[col];
+        return m_layout->arity[col];
     }
     /// Updates the class data that depend on the chromosome
     /**
      * Some of the expression data depend on the chromosome. This is the case, for example,
      * of the active nodes and active genes. Each time the chromosome is changed, these structures need also to be
-     * changed. A call to this method takes care of this. In derived classes (such as for example expression_ann), one
-     * can add more of these chromosome dependant data, and will thus need to override this method, making sure to still
-     * have it called by the new method and adding there the new data book-keeping.
+     * changed. A call to this method takes care of this rebuilding them from scratch. Mutations, instead, update the
+     * active nodes incrementally (see expression::update_active_nodes). Both paths end calling
+     * expression::update_active_genes, which is the method derived classes (such as for example expression_ann) adding
+     * more of these chromosome dependant data need to override, making sure to still have it called by the new method
+     * and adding there the new data book-keeping.
      */
 
     void update_data_structures()
     {
-        assert(m_x.size() == m_lb.size());
+        assert(m_x.size() == m_layout->lb.size());
 
         // First we update the active nodes
         std::vector<unsigned> current(m_m), next;
@@ -903,7 +1369,7 @@ protected:
                 {
                     auto node_arity = _get_arity(node_id);
                     for (auto i = 1u; i <= node_arity; ++i) {
-                        next.push_back(m_x[m_gene_idx[node_id] + i]);
+                        next.push_back(m_x[m_layout->gene_idx[node_id] + i]);
                     }
                 } else {
                     m_active_nodes.push_back(node_id);
@@ -921,13 +1387,124 @@ protected:
         std::sort(m_active_nodes.begin(), m_active_nodes.end());
         m_active_nodes.erase(std::unique(m_active_nodes.begin(), m_active_nodes.end()), m_active_nodes.end());
 
-        // Then the active genes
+        // Then the number of references to each node, used to keep the active nodes up to date after a mutation
+        m_n_refs.assign(m_n + m_r * m_c, 0u);
+        m_touched.clear();
+        m_dirty = false;
+        for (auto i = 0u; i < m_m; ++i) {
+            ++m_n_refs[m_x[m_x.size() - m_m + i]];
+        }
+        for (auto node_id : m_active_nodes) {
+            if (node_id >= m_n) {
+                for (auto j = 1u; j <= _get_arity(node_id); ++j) {
+                    ++m_n_refs[m_x[m_layout->gene_idx[node_id] + j]];
+                }
+            }
+        }
+        // Then the active genes and the tape used to evaluate the expression
+        update_active_genes();
+    }
+
+    /// Updates the active nodes after a mutation
+    /**
+     * Updates the active nodes, the active genes and the tape after one or more calls to expression::set_gene.
+     * Only the nodes whose number of references went to or from zero have been visited (by expression::set_gene),
+     * and they are merged into the (sorted) active nodes in a single linear pass. The active genes and the tape are
+     * then rebuilt by expression::update_active_genes, so that the cost is linear in the number of active nodes
+     * rather than in the size of the whole graph, as the breadth-first visit of expression::update_data_structures
+     * is. Nothing is done if only inactive genes or function genes were changed.
+     */
+    void update_active_nodes()
+    {
+        if (!m_dirty) {
+            return;
+        }
+        m_dirty = false;
+        std::sort(m_touched.begin(), m_touched.end());
+        m_touched.erase(std::unique(m_touched.begin(), m_touched.end()), m_touched.end());
+        // We merge the touched nodes into the sorted active nodes, keeping only those still referenced
+        m_merged.clear();
+        auto it = m_active_nodes.begin();
+        for (auto node_id : m_touched) {
+            while (it != m_active_nodes.end() && *it < node_id) {
+                m_merged.push_back(*it++);
+            }
+            if (it != m_active_nodes.end() && *it == node_id) {
+                ++it;
+            }
+            if (m_n_refs[node_id] > 0u) {
+                m_merged.push_back(node_id);
+            }
+        }
+        m_merged.insert(m_merged.end(), it, m_active_nodes.end());
+        m_active_nodes.swap(m_merged);
+        m_touched.clear();
+        update_active_genes();
+    }
+
+    /// Changes a gene
+    /**
+     * Changes the value of a gene keeping the number of references to each node up to date. Nodes becoming
+     * active or inactive are recorded and their own connections are followed. A call to
+     * expression::update_active_nodes is needed, after all genes have been changed, to update the active nodes.
+     * Changing an active function gene only patches the corresponding tape instruction, while changing an inactive
+     * gene does not require any update.
+     *
+     * @param[in] idx the gene index
+     * @param[in] value the new value of the gene
+     *
+     * @return true if the phenotype changed, false otherwise.
+     */
+    bool set_gene(unsigned idx, unsigned value)
+    {
+        auto old_value = m_x[idx];
+        if (old_value == value) {
+            return false;
+        }
+        m_x[idx] = value;
+        if (idx < m_x.size() - m_m) {
+            // The node expressed by the gene (the gene positions are increasing for non input nodes)
+            const auto &gene_idx = m_layout->gene_idx;
+            auto node_id = static_cast<unsigned>(
+                std::upper_bound(gene_idx.begin() + m_n, gene_idx.end(), idx) - gene_idx.begin() - 1);
+            // The genes of inactive nodes do not change the phenotype
+            if (m_n_refs[node_id] == 0u) {
+                return false;
+            }
+            // Function genes do not change the active nodes: if the tape is up to date we patch it
+            if (idx == m_layout->gene_idx[node_id]) {
+                if (!m_dirty) {
+                    auto k = m_node_slot[node_id] - m_n;
+                    m_tape[k].f_id = value;
+                    m_tape[k].op = m_layout->f_op[value];
+                    if (k < m_folded.size()) {
+                        fold_constants();
+                    }
+                }
+                return true;
+            }
+        }
+        // Output genes and connection genes of active nodes: we first add the new reference so that the nodes
+        // also reachable via the new one are not visited
+        add_reference(value);
+        remove_reference(old_value);
+        m_dirty = true;
+        return true;
+    }
+
+    /// Updates the active genes
+    /**
+     * Updates the active genes and the tape from the active nodes. It is called each time the active nodes change.
+     * Derived classes with additional data depending on the active nodes override it.
+     */
+    virtual void update_active_genes()
+    {
         m_active_genes.clear();
         for (auto i = 0u; i < m_active_nodes.size(); ++i) {
             auto node_id = m_active_nodes[i];
             if (node_id >= m_n) {
                 for (auto j = 0u; j <= _get_arity(node_id); ++j) {
-                    m_active_genes.push_back(m_gene_idx[node_id] + j);
+                    m_active_genes.push_back(m_layout->gene_idx[node_id] + j);
                 }
             }
         }
@@ -935,18 +1512,352 @@ protected:
         for (auto i = 0u; i < m_m; ++i) {
             m_active_genes.push_back(static_cast<unsigned>(m_x.size()) - m_m + i);
         }
+        // And finally the tape used to evaluate the expression
+        compile_tape();
+    }
+
+    /// Compiles the phenotype into a tape
+    /**
+     * Decodes the active nodes into a flat sequence of instructions (the tape) so that the evaluation of the
+     * expression does not need to look into the chromosome, the gene positions or the arities. Each instruction
+     * reads its inputs from slots and writes its output into a new slot. The first \f$n\f$ slots contain the inputs
+     * (followed by the ephemeral constants) and slot \f$n+k\f$ is written by the k-th instruction.
+     *
+     * The nodes depending only on the ephemeral constants come first, followed by those depending on the inputs.
+     * Since m_active_nodes is sorted, the instructions are in a valid evaluation order. The values of the former
+     * are folded once (see expression::fold_constants()) so that the numerical evaluation only runs the latter.
+     */
+    void compile_tape()
+    {
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        // We first detect the nodes whose value does not depend on the inputs
+        m_constant.resize(m_n + m_r * m_c);
+        auto n_constant = 0u;
+        for (auto node_id : m_active_nodes) {
+            if (node_id >= m_n) {
+                unsigned idx = m_layout->gene_idx[node_id];
+                bool constant = true;
+                for (auto j = 1u; j <= _get_arity(node_id) && constant; ++j) {
+                    auto in = m_x[idx + j];
+                    constant = in >= m_n ? m_constant[in] != 0 : in >= n_in;
+                }
+                m_constant[node_id] = constant;
+                n_constant += constant;
+            }
+        }
+        // Then we assign a slot to each active node (input nodes keep their id), constant nodes first
+        auto &node_slot = m_node_slot;
+        node_slot.resize(m_n + m_r * m_c);
+        for (auto i = 0u; i < m_n; ++i) {
+            node_slot[i] = i;
+        }
+        m_tape.clear();
+        m_tape_in.clear();
+        for (auto constant : {true, false}) {
+            for (auto node_id : m_active_nodes) {
+                if (node_id >= m_n && (m_constant[node_id] != 0) == constant) {
+                    unsigned idx = m_layout->gene_idx[node_id]; // position in the chromosome of the current node
+                    unsigned arity = _get_arity(node_id);
+                    node_slot[node_id] = m_n + static_cast<unsigned>(m_tape.size());
+                    m_tape.push_back({node_id, m_x[idx], m_layout->f_op[m_x[idx]], arity,
+                                      static_cast<unsigned>(m_tape_in.size()), node_slot[node_id]});
+                    for (auto j = 1u; j <= arity; ++j) {
+                        m_tape_in.push_back(node_slot[m_x[idx + j]]);
+                    }
+                }
+            }
+        }
+        m_tape_out.resize(m_m);
+        for (auto i = 0u; i < m_m; ++i) {
+            m_tape_out[i] = node_slot[m_x[m_x.size() - m_m + i]];
+        }
+        m_folded.resize(n_constant);
+        fold_constants();
+    }
+
+    /// Folds the constants
+    /**
+     * Computes the values of the first instructions of the tape, those depending only on the ephemeral constants.
+     * It is called each time the tape or the values of the ephemeral constants change.
+     */
+    void fold_constants()
+    {
+        if (m_folded.empty()) {
+            return;
+        }
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        std::vector<T> slot(m_n + m_folded.size(), T(0.)), function_in;
+        std::copy(m_eph_val.begin(), m_eph_val.end(), slot.begin() + n_in);
+        for (auto k = 0u; k < m_folded.size(); ++k) {
+            const auto &instr = m_tape[k];
+            const unsigned *in = m_tape_in.data() + instr.in;
+            slot[instr.out] = call_kernel(
+                instr, [&slot, in](unsigned j) -> const T & { return slot[in[j]]; }, function_in);
+            m_folded[k] = slot[instr.out];
+        }
+    }
+
+    /// Runs the tape
+    /**
+     * Interprets the tape filling in all the slots. The first \f$n\f$ slots must already contain the input values,
+     * and the slots of the instructions skipped their values.
+     *
+     * @param[in, out] slot the slots. Must have size n + tape length.
+     * @param[in] function_in a buffer used to call the kernels.
+     * @param[in] first the first instruction to run.
+     */
+    template <typename U>
+    void run_tape(std::vector<U> &slot, std::vector<U> &function_in, unsigned first) const
+    {
+        const auto &f = m_layout->f;
+        for (auto k = first; k < m_tape.size(); ++k) {
+            const auto &instr = m_tape[k];
+            function_in.resize(instr.arity);
+            for (auto j = 0u; j < instr.arity; ++j) {
+                function_in[j] = slot[m_tape_in[instr.in + j]];
+            }
+            slot[instr.out] = f[instr.f_id](function_in);
+        }
+    }
+
+    /// Runs an instruction over a number of points
+    /**
+     * Runs the vectorized implementation of an instruction (if any) over a number of points.
+     *
+     * @param[in] instr the instruction.
+     * @param[in] row a callable returning, for each input j of the instruction, a pointer to its values.
+     * @param[out] res pointer to where the values of the instruction output will be written.
+     * @param[in] b number of points.
+     *
+     * @return false if the instruction has no vectorized implementation, true otherwise.
+     */
+    template <typename Row, typename U = T, typename std::enable_if<std::is_floating_point<U>::value, int>::type = 0>
+    bool run_vectorized(const instruction &instr, Row row, U *res, unsigned b) const
+    {
+        return run_builtin_kernel(instr.op, row, res, b, instr.arity);
+    }
+
+    // Only floating point types have vectorized kernels
+    template <typename Row, typename U = T, typename std::enable_if<!std::is_floating_point<U>::value, int>::type = 0>
+    bool run_vectorized(const instruction &, Row, U *, unsigned) const
+    {
+        return false;
+    }
+
+    // Calls the built-in kernel of an instruction (if any) directly, returning false for custom kernels
+    template <typename In, typename U = T, typename std::enable_if<std::is_floating_point<U>::value, int>::type = 0>
+    bool call_builtin(const instruction &instr, In in, U &retval) const
+    {
+        return call_builtin_kernel(instr.op, in, instr.arity, retval);
+    }
+
+    // Only floating point types call the built-in kernels directly
+    template <typename In, typename U = T, typename std::enable_if<!std::is_floating_point<U>::value, int>::type = 0>
+    bool call_builtin(const instruction &, In, U &) const
+    {
+        return false;
+    }
+
+    /// Calls the kernel of an instruction
+    /**
+     * Calls the kernel of an instruction on in(0), ..., in(arity - 1) through its std::function. When the arity of
+     * the instruction is one or two, and the kernel has the matching fixed-arity entry point, the inputs are passed
+     * directly rather than copied into \p function_in.
+     *
+     * @param[in] instr the instruction.
+     * @param[in] in a callable returning the inputs of the instruction.
+     * @param[in] function_in a buffer used to call the kernel.
+     *
+     * @return the kernel value.
+     */
+    template <typename In>
+    T call_kernel(const instruction &instr, In in, std::vector<T> &function_in) const
+    {
+        const auto &f = m_layout->f[instr.f_id];
+        if (instr.arity == 2u && f.has_binary()) {
+            return f(in(0u), in(1u));
+        }
+        if (instr.arity == 1u && f.has_unary()) {
+            return f(in(0u));
+        }
+        function_in.resize(instr.arity);
+        for (auto j = 0u; j < instr.arity; ++j) {
+            function_in[j] = in(j);
+        }
+        return f(function_in);
+    }
+
+    /// Runs an instruction over a number of points
+    /**
+     * Runs an instruction over a number of points, using the vectorized implementation of its built-in kernel or
+     * the batched entry point of its custom kernel if available, and calling the kernel point by point otherwise.
+     *
+     * @param[in] instr the instruction.
+     * @param[in] row a callable returning, for each input j of the instruction, a pointer to its values.
+     * @param[out] res pointer to where the values of the instruction output will be written.
+     * @param[in] b number of points.
+     * @param[in,out] ws the workspace holding the buffers used to call the kernel.
+     */
+    template <typename Row>
+    void run_instruction(const instruction &instr, Row row, T *res, unsigned b, workspace &ws) const
+    {
+        if (run_vectorized(instr, row, res, b)) {
+            return;
+        }
+        const auto &f = m_layout->f[instr.f_id];
+        if (f.has_batch()) {
+            ws.function_rows.resize(instr.arity);
+            for (auto j = 0u; j < instr.arity; ++j) {
+                ws.function_rows[j] = row(j);
+            }
+            f(ws.function_rows, res, b);
+            return;
+        }
+        for (auto k = 0u; k < b; ++k) {
+            res[k] = call_kernel(
+                instr, [&row, k](unsigned j) -> const T & { return row(j)[k]; }, ws.function_in);
+        }
+    }
+
+    // Sizes the block of the workspace and fills the slots of the ephemeral constants and of the folded constants,
+    // which are the same for all blocks. The slot s of the k-th point of a block is in ws.block[s * B + k]
+    void init_block(workspace &ws) const
+    {
+        const unsigned B = batch_block_size;
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        ws.block.resize((m_n + m_tape.size()) * B);
+        for (auto i = n_in; i < m_n; ++i) {
+            std::fill(ws.block.begin() + i * B, ws.block.begin() + (i + 1u) * B, m_eph_val[i - n_in]);
+        }
+        for (auto i = 0u; i < m_folded.size(); ++i) {
+            std::fill(ws.block.begin() + (m_n + i) * B, ws.block.begin() + (m_n + i + 1u) * B, m_folded[i]);
+        }
+    }
+
+    // Runs the tape, from the first instruction that is not folded, over the first b points of the block (their
+    // inputs are expected in the first slots)
+    template <typename Dispatch>
+    void run_block(unsigned b, workspace &ws) const
+    {
+        const unsigned B = batch_block_size;
+        for (auto it = m_tape.begin() + static_cast<std::ptrdiff_t>(m_folded.size()); it != m_tape.end(); ++it) {
+            const auto &instr = *it;
+            const T *block = ws.block.data();
+            Dispatch::run(
+                *this, instr, [this, &instr, block](unsigned j) { return block + m_tape_in[instr.in + j] * B; },
+                ws.block.data() + instr.out * B, b, ws);
+        }
+    }
+
+    // Calls the built-in kernels with a switch on their opcode and the custom ones through their std::function (see
+    // expression_static for a static dispatch). The kernels of an instruction are called on in(0), ..., in(arity - 1)
+    // by call() and over a block of points by run()
+    struct dynamic_dispatch {
+        template <typename In>
+        static T call(const expression &ex, const instruction &instr, In in, std::vector<T> &function_in)
+        {
+            T retval;
+            if (ex.call_builtin(instr, in, retval)) {
+                return retval;
+            }
+            return ex.call_kernel(instr, in, function_in);
+        }
+        template <typename Row>
+        static void run(const expression &ex, const instruction &instr, Row row, T *res, unsigned b, workspace &ws)
+        {
+            ex.run_instruction(instr, row, res, b, ws);
+        }
+    };
+
+    // Implementation of expression::evaluate(), calling the kernels via Dispatch
+    template <typename Dispatch>
+    void evaluate_impl(const T *point, T *out, workspace &ws) const
+    {
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        // The first m_n slots contain the inputs followed by the ephemeral constants
+        ws.node.resize(m_n + m_tape.size());
+        std::copy(point, point + n_in, ws.node.begin());
+        std::copy(m_eph_val.begin(), m_eph_val.end(), ws.node.begin() + n_in);
+        // The folded constants follow and the tape is run from the first instruction depending on the inputs
+        std::copy(m_folded.begin(), m_folded.end(), ws.node.begin() + m_n);
+        const T *slot = ws.node.data();
+        for (auto it = m_tape.begin() + static_cast<std::ptrdiff_t>(m_folded.size()); it != m_tape.end(); ++it) {
+            const auto &instr = *it;
+            // The callable captures two pointers only, so that it is passed in registers
+            const unsigned *in = m_tape_in.data() + instr.in;
+            ws.node[instr.out] = Dispatch::call(
+                *this, instr, [slot, in](unsigned j) -> const T & { return slot[in[j]]; }, ws.function_in);
+        }
+        for (auto i = 0u; i < m_m; ++i) {
+            out[i] = ws.node[m_tape_out[i]];
+        }
+    }
+
+    // Implementation of expression::evaluate_batch(), calling the kernels via Dispatch
+    template <typename Dispatch>
+    void evaluate_batch_impl(const T *points, T *out, unsigned N, workspace &ws) const
+    {
+        const unsigned B = batch_block_size;
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        init_block(ws);
+        for (auto k0 = 0u; k0 < N; k0 += B) {
+            auto b = std::min(B, N - k0);
+            // We transpose the inputs of the block into the first slots
+            for (auto k = 0u; k < b; ++k) {
+                for (auto i = 0u; i < n_in; ++i) {
+                    ws.block[i * B + k] = points[(k0 + k) * n_in + i];
+                }
+            }
+            run_block<Dispatch>(b, ws);
+            for (auto k = 0u; k < b; ++k) {
+                for (auto i = 0u; i < m_m; ++i) {
+                    out[(k0 + k) * m_m + i] = ws.block[m_tape_out[i] * B + k];
+                }
+            }
+        }
+    }
+
+    // Implementation of expression::accumulate_loss(), calling the kernels via Dispatch
+    template <typename Dispatch>
+    void accumulate_loss_impl(const std::vector<T> *points, const std::vector<T> *labels, unsigned N, loss_type loss_e,
+                              T &retval, workspace &ws) const
+    {
+        const unsigned B = batch_block_size;
+        auto n_in = m_n - static_cast<unsigned>(m_eph_val.size());
+        init_block(ws);
+        for (auto k0 = 0u; k0 < N; k0 += B) {
+            auto b = std::min(B, N - k0);
+            // We transpose the inputs of the block into the first slots
+            for (auto k = 0u; k < b; ++k) {
+                check_loss_dimensions(points[k0 + k], labels[k0 + k]);
+                for (auto i = 0u; i < n_in; ++i) {
+                    ws.block[i * B + k] = points[k0 + k][i];
+                }
+            }
+            run_block<Dispatch>(b, ws);
+            for (auto k = 0u; k < b; ++k) {
+                const T *block = ws.block.data() + k;
+                retval += output_loss([this, block](unsigned i) -> const T & { return block[m_tape_out[i] * B]; },
+                                      labels[k0 + k].data(), loss_e);
+            }
+        }
     }
 
+    /// Maximum number of chunks the data is split into by the parallel loss
+    static constexpr unsigned max_loss_chunks = 256u;
+
     /// Evaluates the model loss (on a batch)
     /**
-     * Evaluates the model loss over a batch.
+     * Evaluates the model loss over a batch. In parallel, the data is split into at most
+     * expression::max_loss_chunks chunks of at least expression::batch_block_size consecutive points. Each chunk is
+     * summed by a single task and the partial sums are then added in a fixed order. Since the chunks only depend on
+     * the batch size, the result does not depend on the number of threads nor on their timing.
      *
      * @param[dfirst] Begin of data.
      * @param[dlast] End of data.
      * @param[lfirst] Begin of labels.
      * @param[loss_e] The loss type.
-     * @param[parallel] sets the grain for parallelism. 0 -> no parallelism n -> divides the data into n parts and
-     * evaluates them in parallel threads.
+     * @param[parallel] 0 -> no parallelism, otherwise the chunks of data are evaluated in parallel threads.
      * @return the loss
      */
     T loss(typename std::vector<std::vector<T>>::const_iterator dfirst,
@@ -956,74 +1867,328 @@ protected:
         T retval(0.);
         unsigned batch_size = static_cast<unsigned>(dlast - dfirst);
         if (parallel > 0u) {
-            if (batch_size % parallel != 0) {
-                throw std::invalid_argument("The batch size is: " + std::to_string(batch_size)
-                                            + " and cannot be divided into " + std::to_string(parallel) + " parts.");
-            }
-            unsigned inner_batch_size = batch_size / parallel;
-            // The mutex that will protect read/write access to retval
-            tbb::spin_mutex mutex_weights_updates;
-            // This loops over all points, predictions in the mini-batch
-            tbb::parallel_for(0u, batch_size, inner_batch_size, [&](unsigned i) {
-                T err(0.);
-                // The loss gets computed
-                for (auto j = 0u; j < inner_batch_size; ++j) {
-                    err += loss(*(dfirst + i + j), *(lfirst + i + j), loss_e);
+            const unsigned min_chunk = batch_block_size, max_chunks = max_loss_chunks;
+            auto chunk = std::max(min_chunk, (batch_size + max_chunks - 1u) / max_chunks);
+            auto n_chunks = (batch_size + chunk - 1u) / chunk;
+            std::vector<T> partial(n_chunks, T(0.));
+            tbb::parallel_for(tbb::blocked_range<unsigned>(0u, n_chunks), [&](const tbb::blocked_range<unsigned> &r) {
+                // Each task owns its workspace
+                workspace ws;
+                for (auto c = r.begin(); c != r.end(); ++c) {
+                    T err(0.);
+                    auto first = c * chunk;
+                    accumulate_loss(&*(dfirst + first), &*(lfirst + first), std::min(chunk, batch_size - first), loss_e,
+                                    err, ws);
+                    partial[c] = err;
                 }
-                // We acquire the lock on the mutex
-                tbb::spin_mutex::scoped_lock lock(mutex_weights_updates);
-                // We update the cumulative loss and gradient
-                retval += err;
             });
-        } else {
-            for (decltype(batch_size) i = 0; i < batch_size; ++i) {
-                // The loss gets computed
-                retval += loss(*(dfirst + i), *(lfirst + i), loss_e);
+            // The partial sums are reduced in a fixed order
+            for (const auto &err : partial) {
+                retval += err;
             }
+        } else {
+            workspace ws;
+            accumulate_loss(&*dfirst, &*lfirst, batch_size, loss_e, retval, ws);
         }
-        retval /= batch_size;
+        retval /= static_cast<count_type>(batch_size);
 
         return retval;
     }
 
 private:
-    void sanity_checks()
+    friend class boost::serialization::access;
+    // Archives the dCGP parameters, the kernel names, the ephemeral constants, the chromosome and the random engine
+    // state (everything else is derived from these)
+    template <typename Archive>
+    void save(Archive &ar, unsigned) const
+    {
+        std::vector<std::string> names;
+        for (const auto &f : m_layout->f) {
+            names.push_back(f.get_name());
+        }
+        std::ostringstream rng;
+        rng << m_e;
+        ar << static_cast<unsigned>(m_n - m_eph_val.size());
+        ar << m_m;
+        ar << m_r;
+        ar << m_c;
+        ar << m_l;
+        ar << m_layout->arity;
+        ar << names;
+        ar << m_eph_val;
+        ar << m_eph_symb;
+        ar << m_x;
+        ar << rng.str();
+    }
+
+    // Restores an archived expression, rebuilding it (and thus checking the parameters and the chromosome) from its
+    // parameters and its kernels resolved by name
+    template <typename Archive>
+    void load(Archive &ar, unsigned)
+    {
+        unsigned n, m, r, c, l;
+        std::vector<unsigned> arity, x;
+        std::vector<std::string> names, eph_symb;
+        std::vector<T> eph_val;
+        std::string rng;
+        ar >> n;
+        ar >> m;
+        ar >> r;
+        ar >> c;
+        ar >> l;
+        ar >> arity;
+        ar >> names;
+        ar >> eph_val;
+        ar >> eph_symb;
+        ar >> x;
+        ar >> rng;
+        std::vector<kernel<T>> f;
+        for (const auto &name : names) {
+            f.push_back(kernel_registry<T>::instance().get(name).k);
+        }
+        expression<T>::operator=(expression<T>(n, m, r, c, l, arity, f, static_cast<unsigned>(eph_val.size()), 0u));
+        set_eph_val(eph_val);
+        set_eph_symb(eph_symb);
+        set(x);
+        std::istringstream(rng) >> m_e;
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    // The name of a node in expression::symbolic_dag(): its symbol for the input nodes (in, then the ephemeral
+    // constants), t followed by its id otherwise
+    std::string node_symbol(const std::vector<std::string> &in, unsigned node_id) const
+    {
+        if (node_id < in.size()) {
+            return in[node_id];
+        }
+        if (node_id < m_n) {
+            return m_eph_symb[node_id - in.size()];
+        }
+        return "t" + std::to_string(node_id);
+    }
+
+    // Computes the loss of a single point, out(i) returning the i-th output of the expression
+    template <typename Out>
+    T output_loss(Out out, const T *prediction, loss_type loss_e) const
+    {
+        T retval(0.);
+        switch (loss_e) {
+            // Mean Square Error
+            case loss_type::MSE: {
+                for (auto i = 0u; i < m_m; ++i) {
+                    T diff = out(i) - prediction[i];
+                    retval += diff * diff;
+                }
+                retval /= static_cast<count_type>(m_m);
+                break; // and exits the switch
+            }
+            // Cross Entropy
+            case loss_type::CE: {
+                // We guard from numerical instabilities subtracting the max element
+                T max = out(0u);
+                for (auto i = 1u; i < m_m; ++i) {
+                    if (max < out(i)) {
+                        max = out(i);
+                    }
+                }
+                // log(sum exp(a_i - max))
+                T cumsum(0.);
+                for (auto i = 0u; i < m_m; ++i) {
+                    cumsum += audi::exp(out(i) - max);
+                }
+                T log_cumsum = audi::log(cumsum);
+                // - sum log(p_i) y_i, with log(p_i) = a_i - max - log(sum exp(a_j - max))
+                for (auto i = 0u; i < m_m; ++i) {
+                    retval -= (out(i) - max - log_cumsum) * prediction[i];
+                }
+                break;
+            }
+        }
+        return retval;
+    }
+
+    // Checks the dimensions of a point and of its label when computing the loss
+    void check_loss_dimensions(const std::vector<T> &point, const std::vector<T> &prediction) const
+    {
+        if (point.size() != this->get_n() - m_eph_val.size()) {
+            throw std::invalid_argument("When computing the loss, the point dimension (input) seemed wrong, it was: "
+                                        + std::to_string(point.size())
+                                        + " while I expected: " + std::to_string(this->get_n() - m_eph_val.size()));
+        }
+        if (prediction.size() != this->get_m()) {
+            throw std::invalid_argument(
+                "When computing the loss the prediction dimension (output) seemed wrong, it was: "
+                + std::to_string(prediction.size()) + " while I expected: " + std::to_string(this->get_m()));
+        }
+    }
+
+    // Converts the loss name into its loss_type
+    static loss_type get_loss_type(const std::string &loss_s)
+    {
+        if (loss_s == "MSE") { // Mean Squared Error
+            return loss_type::MSE;
+        } else if (loss_s == "CE") {
+            return loss_type::CE; // Cross Entropy
+        }
+        throw std::invalid_argument("The requested loss was: " + loss_s + " while only MSE and CE are allowed");
+    }
+
+    // Checks that a node cache was initialized by an expression with the same structure
+    void check_node_cache(const node_cache &nc) const
+    {
+        if (nc.column.size() != m_n + m_r * m_c || (!nc.x.empty() && nc.x.size() != m_x.size())) {
+            throw std::invalid_argument("The node cache has " + std::to_string(nc.column.size())
+                                        + " nodes, while this expression has " + std::to_string(m_n + m_r * m_c)
+                                        + ". It must be initialized by an expression with the same structure.");
+        }
+    }
+
+    // Checks whether the values of a node cached for the parent can be reused, that is if the node is active in the
+    // parent with the same genes and none of its inputs has changed
+    template <typename Changed>
+    bool reusable(unsigned node_id, const node_cache &nc, Changed changed) const
+    {
+        if (nc.x.empty() || nc.column[node_id].empty()) {
+            return false;
+        }
+        auto idx = m_layout->gene_idx[node_id];
+        for (auto j = 0u; j <= _get_arity(node_id); ++j) {
+            if (m_x[idx + j] != nc.x[idx + j] || (j > 0u && changed(m_x[idx + j]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Combines a hash into seed (same mixing as boost::hash_combine)
+    static void hash_combine(std::size_t &seed, std::size_t h)
+    {
+        seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    template <typename U = T, typename std::enable_if<std::is_floating_point<U>::value, int>::type = 0>
+    static std::size_t value_hash(const U &val)
+    {
+        return std::hash<U>()(val);
+    }
+
+    // Generalized duals have no std::hash, we hash their representation
+    template <typename U = T, typename std::enable_if<!std::is_floating_point<U>::value, int>::type = 0>
+    static std::size_t value_hash(const U &val)
+    {
+        std::ostringstream ss;
+        ss << val;
+        return std::hash<std::string>()(ss.str());
+    }
+
+    // Adds a reference to a node. If the node becomes active, its connections are followed.
+    void add_reference(unsigned node_id)
+    {
+        m_stack.push_back(node_id);
+        while (!m_stack.empty()) {
+            auto current = m_stack.back();
+            m_stack.pop_back();
+            if (m_n_refs[current]++ == 0u) {
+                m_touched.push_back(current);
+                if (current >= m_n) {
+                    for (auto j = 1u; j <= _get_arity(current); ++j) {
+                        m_stack.push_back(m_x[m_layout->gene_idx[current] + j]);
+                    }
+                }
+            }
+        }
+    }
+    // Removes a reference to a node. If the node becomes inactive, its connections are followed.
+    void remove_reference(unsigned node_id)
+    {
+        m_stack.push_back(node_id);
+        while (!m_stack.empty()) {
+            auto current = m_stack.back();
+            m_stack.pop_back();
+            assert(m_n_refs[current] > 0u);
+            if (--m_n_refs[current] == 0u) {
+                m_touched.push_back(current);
+                if (current >= m_n) {
+                    for (auto j = 1u; j <= _get_arity(current); ++j) {
+                        m_stack.push_back(m_x[m_layout->gene_idx[current] + j]);
+                    }
+                }
+            }
+        }
+    }
+    // Builds the layout of the expression (checking the parameters) and allocates the chromosome
+    void init_layout(std::vector<unsigned> arity, std::vector<kernel<T>> f)
+    {
+        auto lay = std::make_shared<layout>();
+        lay->arity = std::move(arity);
+        lay->f = std::move(f);
+        // Sanity checks
+        sanity_checks(*lay);
+        // Initializing bounds
+        init_bounds(*lay);
+        // Detecting the built-in kernels
+        init_opcodes(*lay);
+        m_x = std::vector<unsigned>(lay->lb.size(), 0u);
+        m_layout = std::move(lay);
+    }
+    void sanity_checks(const layout &lay) const
     {
         if (m_n == 0) throw std::invalid_argument("Number of inputs is 0");
         if (m_m == 0) throw std::invalid_argument("Number of outputs is 0");
         if (m_c == 0) throw std::invalid_argument("Number of columns is 0");
         if (m_r == 0) throw std::invalid_argument("Number of rows is 0");
         if (m_l == 0) throw std::invalid_argument("Number of level-backs is 0");
-        if (m_arity.size() != m_c)
-            throw std::invalid_argument("The arity vector size (" + std::to_string(m_arity.size())
+        if (lay.arity.size() != m_c)
+            throw std::invalid_argument("The arity vector size (" + std::to_string(lay.arity.size())
                                         + ") must be the same as the number of columns (" + std::to_string(m_c) + ")");
-        if (std::any_of(m_arity.begin(), m_arity.end(), [](unsigned a) { return a == 0; })) {
+        if (std::any_of(lay.arity.begin(), lay.arity.end(), [](unsigned a) { return a == 0; })) {
             throw std::invalid_argument("Basis functions arity cannot be zero");
         }
-        if (m_f.size() == 0) throw std::invalid_argument("Number of basis functions is 0");
+        if (lay.f.size() == 0) throw std::invalid_argument("Number of basis functions is 0");
+        // Kernels may need more inputs than a node has (e.g. pdiv reads two). This is known for the kernels resolved
+        // from the registry and for the built-in ones (see kernel::get_min_arity()), not for other user kernels, even
+        // when they share the name of a registered one.
+        const auto min_arity = *std::min_element(lay.arity.begin(), lay.arity.end());
+        for (const auto &ker : lay.f) {
+            if (ker.get_min_arity() > min_arity) {
+                throw std::invalid_argument("The kernel " + ker.get_name() + " needs at least "
+                                            + std::to_string(ker.get_min_arity())
+                                            + " inputs, but the arity of some nodes is " + std::to_string(min_arity));
+            }
+        }
     }
-    void init_bounds_and_chromosome()
+    static void init_opcodes(layout &lay)
+    {
+        lay.f_op = std::vector<kernel_opcode>(lay.f.size(), kernel_opcode::custom);
+        // Only floating point types call the built-in kernels directly
+        if (!std::is_floating_point<T>::value) {
+            return;
+        }
+        for (decltype(lay.f.size()) i = 0u; i < lay.f.size(); ++i) {
+            lay.f_op[i] = lay.f[i].get_opcode();
+        }
+    }
+    void init_bounds(layout &lay) const
     {
         // Chromosome size is r*c + sum(arity)*r + m
-        unsigned size = m_r * m_c + m_r * std::accumulate(m_arity.begin(), m_arity.end(), 0u) + m_m;
-        // Allocate bounds and chromosome and gene position
-        m_x = std::vector<unsigned>(size, 0u);
-        m_lb = std::vector<unsigned>(size, 0u);
-        m_ub = std::vector<unsigned>(size, 0u);
-        m_gene_idx = std::vector<unsigned>(m_r * m_c + m_n, 0u);
+        unsigned size = m_r * m_c + m_r * std::accumulate(lay.arity.begin(), lay.arity.end(), 0u) + m_m;
+        // Allocate bounds and gene position
+        lay.lb = std::vector<unsigned>(size, 0u);
+        lay.ub = std::vector<unsigned>(size, 0u);
+        lay.gene_idx = std::vector<unsigned>(m_r * m_c + m_n, 0u);
 
         // We loop over all nodes and set function and connection genes
         unsigned k = 0u;
         for (auto i = 0u; i < m_c; ++i) {     // column first
             for (auto j = 0u; j < m_r; ++j) { // then rows
                 // Function gene (lower bounds are all 0u)
-                m_ub[k] = static_cast<unsigned>(m_f.size() - 1u);
+                lay.ub[k] = static_cast<unsigned>(lay.f.size() - 1u);
                 k++;
                 // Connections genes
-                for (auto l = 0u; l < m_arity[i]; ++l) {
-                    m_ub[k] = m_n + i * m_r - 1u;
+                for (auto l = 0u; l < lay.arity[i]; ++l) {
+                    lay.ub[k] = m_n + i * m_r - 1u;
                     if (i >= m_l) { // only if level-backs allow a lower bound exists
-                        m_lb[k] = m_n + m_r * (i - m_l);
+                        lay.lb[k] = m_n + m_r * (i - m_l);
                     }
                     k++;
                 }
@@ -1031,25 +2196,25 @@ private:
         }
         // Bounds for the output genes
         for (auto i = size - m_m; i < size; ++i) {
-            m_ub[i] = m_n + m_r * m_c - 1u;
+            lay.ub[i] = m_n + m_r * m_c - 1u;
             if (m_l <= m_c) {
-                m_lb[i] = m_n + m_r * (m_c - m_l);
+                lay.lb[i] = m_n + m_r * (m_c - m_l);
             }
         }
         // We compute the position of genes expressing a given node
-        for (auto node_id = 0u; node_id < m_gene_idx.size(); ++node_id) {
+        for (auto node_id = 0u; node_id < lay.gene_idx.size(); ++node_id) {
             if (node_id < m_n) {
-                m_gene_idx[node_id]
+                lay.gene_idx[node_id]
                     = 0u; // We put some unused values for the input nodes as they have no gene representation
             } else {
                 unsigned col = (node_id - m_n) / m_r;
                 unsigned row = (node_id - m_n) % m_r;
                 unsigned acc = 0u;
                 for (auto j = 0u; j < col; ++j) {
-                    acc = acc + m_arity[j];
+                    acc = acc + lay.arity[j];
                 }
                 acc *= m_r;
-                m_gene_idx[node_id] = acc + row * m_arity[col] + (node_id - m_n);
+                lay.gene_idx[node_id] = acc + row * lay.arity[col] + (node_id - m_n);
             }
         }
     }
@@ -1064,26 +2229,39 @@ private:
     unsigned m_c;
     // number of levels_back allowed
     unsigned m_l;
-    // function arity
-    std::vector<unsigned> m_arity;
-
-    // the functions allowed
-    std::vector<kernel<T>> m_f;
+    // the kernels, the bounds and the gene positions (shared by the copies)
+    std::shared_ptr<const layout> m_layout;
     // the ephemeral constants values
     std::vector<T> m_eph_val;
     // the ephemeral constants names
     std::vector<std::string> m_eph_symb;
-    // lower and upper bounds on all genes
-    std::vector<unsigned> m_lb;
-    std::vector<unsigned> m_ub;
     // active nodes idx (guaranteed to be always sorted)
     std::vector<unsigned> m_active_nodes;
     // active genes idx
     std::vector<unsigned> m_active_genes;
     // the encoded chromosome
     std::vector<unsigned> m_x;
-    // The starting index in the chromosome of the genes expressing a node
-    std::vector<unsigned> m_gene_idx;
+    // the number of references (from active nodes and output genes) to each node. A node is active iff positive
+    std::vector<unsigned> m_n_refs;
+    // the nodes whose number of references went to or from zero since the last update of the active nodes
+    std::vector<unsigned> m_touched;
+    // work buffers used to update the active nodes
+    std::vector<unsigned> m_stack;
+    std::vector<unsigned> m_merged;
+    // true if the active nodes, the active genes and the tape need to be updated
+    bool m_dirty = false;
+    // the tape: one instruction per active (non input) node, in evaluation order
+    std::vector<instruction> m_tape;
+    // the slots read by the instructions
+    std::vector<unsigned> m_tape_in;
+    // the slots containing the expression outputs
+    std::vector<unsigned> m_tape_out;
+    // the slot written by each active node (the instruction of a non input node is at m_node_slot[node_id] - n)
+    std::vector<unsigned> m_node_slot;
+    // the values of the first m_folded.size() instructions of the tape, that do not depend on the inputs
+    std::vector<T> m_folded;
+    // whether each active node depends only on the ephemeral constants (used by compile_tape)
+    std::vector<char> m_constant;
     // the random engine for the class
     detail::random_engine_type m_e;
     // The expression type
@@ -3,9 +3,14 @@
 
 #include <algorithm>
 #include <audi/io.hpp>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
 #include <dcgp/config.hpp>
 #include <dcgp/expression.hpp>
 #include <dcgp/kernel.hpp>
+#include <dcgp/static_kernel_set.hpp>
 #include <dcgp/type_traits.hpp>
 #include <functional>
 #include <initializer_list>
@@ -29,16 +34,26 @@ namespace dcgp
  * program. It adds weights, biases and backward automated differentiation to the class
  * dcgp::expression.
  *
+ * As dcgp::expression, it can be saved to (and restored from) a Boost archive, which also stores the weights and the
+ * biases.
+ *
+ * Before single precision support, this class was not a template and operated on doubles only. It must now be spelled
+ * expression_ann<double> (or expression_ann<>, double being the default type), e.g. expression_ann<>::loss_type
+ * in place of expression_ann::loss_type.
+ *
+ * @tparam T expression type. Can be double (the default) or float.
  */
-class expression_ann : public expression<double>
+template <typename T = double>
+class expression_ann : public expression<T>
 {
 
 private:
+    // Static checks.
+    static_assert(std::is_same<T, double>::value || std::is_same<T, float>::value,
+                  "A dCGP-ANN expression can only be operating on doubles or floats");
     template <typename U>
-    using enable_double_string =
-        typename std::enable_if<std::is_same<U, double>::value || std::is_same<U, std::string>::value, int>::type;
-    template <typename U>
-    using enable_double = typename std::enable_if<std::is_same<U, double>::value, int>::type;
+    using enable_T_string =
+        typename std::enable_if<std::is_same<U, T>::value || std::is_same<U, std::string>::value, int>::type;
 
 public:
     /// Allowed kernels (for backpropagation to work)
@@ -54,7 +69,22 @@ public:
         /// ISRU
         ISRU,
         /// Simple sum of inputs
-        SUM
+        SUM,
+        /// Approximate sigmoid (see dcgp::my_sig_fast)
+        SIG_FAST,
+        /// Approximate hyperbolic tangent (see dcgp::my_tanh_fast)
+        TANH_FAST
+    };
+
+    /// Backpropagation workspace
+    /**
+     * Extends the evaluation workspace with the buffers needed to compute the loss gradient. Reusing the same
+     * workspace across calls to expression_ann::d_loss avoids any heap allocation at steady state.
+     * A workspace must not be shared between threads.
+     */
+    struct backprop_workspace : expression<T>::workspace {
+        // the derivatives of the activation functions (followed by those of the loss w.r.t. the outputs)
+        std::vector<T> d_node;
     };
     /// Constructor
     /** Constructs a dCGPANN expression
@@ -68,45 +98,23 @@ public:
      * @param[in] f function set. An std::vector of dcgp::kernel<expression::type>. Can only contain allowed functions.
      * @param[in] seed seed for the random number generator (initial expression and mutations depend on this).
      */
-    expression_ann(unsigned n,                    // n. inputs
-                   unsigned m,                    // n. outputs
-                   unsigned r,                    // n. rows
-                   unsigned c,                    // n. columns
-                   unsigned l,                    // n. levels-back
-                   std::vector<unsigned> arity,   // basis functions' arity
-                   std::vector<kernel<double>> f, // functions
-                   unsigned seed                  // seed for the pseudo-random numbers
+    expression_ann(unsigned n,                  // n. inputs
+                   unsigned m,                  // n. outputs
+                   unsigned r,                  // n. rows
+                   unsigned c,                  // n. columns
+                   unsigned l,                  // n. levels-back
+                   std::vector<unsigned> arity, // basis functions' arity
+                   std::vector<kernel<T>> f,    // functions
+                   unsigned seed                // seed for the pseudo-random numbers
                    )
-        : expression<double>(n, m, r, c, l, arity, f, 0u, seed), m_biases(r * c, 0.), m_kernel_map(f.size())
+        : expression<T>(n, m, r, c, l, arity, f, 0u, seed), m_biases(r * c, T(0.)), m_kernel_map(f.size())
 
     {
-        // Sanity checks
-        for (const auto &ker : f) {
-            if (ker.get_name() != "tanh" && ker.get_name() != "sig" && ker.get_name() != "ReLu"
-                && ker.get_name() != "ELU" && ker.get_name() != "ISRU" && ker.get_name() != "sum") {
-                throw std::invalid_argument(
-                    "Only tanh, sig, ReLu, ELU, ISRU and sum Kernels are valid for dCGP-ANN expressions");
-            }
-        }
-        // Initialize the kernel map
-        for (decltype(f.size()) i = 0u; i < f.size(); ++i) {
-            if (f[i].get_name() == "sig") {
-                m_kernel_map[i] = kernel_type::SIG;
-            } else if (f[i].get_name() == "tanh") {
-                m_kernel_map[i] = kernel_type::TANH;
-            } else if (f[i].get_name() == "ReLu") {
-                m_kernel_map[i] = kernel_type::RELU;
-            } else if (f[i].get_name() == "ELU") {
-                m_kernel_map[i] = kernel_type::ELU;
-            } else if (f[i].get_name() == "ISRU") {
-                m_kernel_map[i] = kernel_type::ISRU;
-            } else if (f[i].get_name() == "sum") {
-                m_kernel_map[i] = kernel_type::SUM;
-            }
-        }
+        // Sanity checks and initialization of the kernel map
+        init_kernel_map(f);
         // Default initialization of weights to 1.
         unsigned n_connections = std::accumulate(this->get_arity().begin(), this->get_arity().end(), 0u) * r;
-        m_weights = std::vector<double>(n_connections, 1.);
+        m_weights = std::vector<T>(n_connections, 1.);
 
         // Filling in the symbols for the weights and biases
         for (auto node_id = n; node_id < r * c + n; ++node_id) {
@@ -119,7 +127,7 @@ public:
         }
         // This will call the derived class method (not the base class) where the base class method is also called.
         // As a consequence data members of both classes will be updated.
-        update_data_structures();
+        this->update_data_structures();
     }
 
     /// Constructor
@@ -134,46 +142,24 @@ public:
      * @param[in] f function set. An std::vector of dcgp::kernel<expression::type>. Can only contain allowed functions.
      * @param[in] seed seed for the random number generator (initial expression and mutations depend on this).
      */
-    expression_ann(unsigned n,                    // n. inputs
-                   unsigned m,                    // n. outputs
-                   unsigned r,                    // n. rows
-                   unsigned c,                    // n. columns
-                   unsigned l,                    // n. levels-back
-                   unsigned arity,                // basis functions' arity
-                   std::vector<kernel<double>> f, // functions
-                   unsigned seed                  // seed for the pseudo-random numbers
+    expression_ann(unsigned n,               // n. inputs
+                   unsigned m,               // n. outputs
+                   unsigned r,               // n. rows
+                   unsigned c,               // n. columns
+                   unsigned l,               // n. levels-back
+                   unsigned arity,           // basis functions' arity
+                   std::vector<kernel<T>> f, // functions
+                   unsigned seed             // seed for the pseudo-random numbers
                    )
-        : expression<double>(n, m, r, c, l, std::vector<unsigned>(c, arity), f, 0u, seed), m_biases(r * c, 0.),
+        : expression<T>(n, m, r, c, l, std::vector<unsigned>(c, arity), f, 0u, seed), m_biases(r * c, T(0.)),
           m_kernel_map(f.size())
 
     {
-        // Sanity checks
-        for (const auto &ker : f) {
-            if (ker.get_name() != "tanh" && ker.get_name() != "sig" && ker.get_name() != "ReLu"
-                && ker.get_name() != "ELU" && ker.get_name() != "ISRU" && ker.get_name() != "sum") {
-                throw std::invalid_argument(
-                    "Only tanh, sig, ReLu, ELU, ISRU and sum Kernels are valid for dCGP-ANN expressions");
-            }
-        }
-        // Initialize the kernel map
-        for (decltype(f.size()) i = 0u; i < f.size(); ++i) {
-            if (f[i].get_name() == "sig") {
-                m_kernel_map[i] = kernel_type::SIG;
-            } else if (f[i].get_name() == "tanh") {
-                m_kernel_map[i] = kernel_type::TANH;
-            } else if (f[i].get_name() == "ReLu") {
-                m_kernel_map[i] = kernel_type::RELU;
-            } else if (f[i].get_name() == "ELU") {
-                m_kernel_map[i] = kernel_type::ELU;
-            } else if (f[i].get_name() == "ISRU") {
-                m_kernel_map[i] = kernel_type::ISRU;
-            } else if (f[i].get_name() == "sum") {
-                m_kernel_map[i] = kernel_type::SUM;
-            }
-        }
+        // Sanity checks and initialization of the kernel map
+        init_kernel_map(f);
         // Default initialization of weights to 1.
         unsigned n_connections = std::accumulate(this->get_arity().begin(), this->get_arity().end(), 0u) * r;
-        m_weights = std::vector<double>(n_connections, 1.);
+        m_weights = std::vector<T>(n_connections, 1.);
 
         // Filling in the symbols for the weights and biases
         for (auto node_id = n; node_id < r * c + n; ++node_id) {
@@ -186,7 +172,7 @@ public:
         }
         // This will call the derived class method (not the base class) where the base class method is also called.
         // As a consequence data members of both classes will be updated.
-        update_data_structures();
+        this->update_data_structures();
     }
 
     /// Evaluates the dCGP-ANN expression
@@ -199,15 +185,99 @@ public:
      *
      * @return The value of the output (an std::vector)
      */
-    std::vector<double> operator()(const std::vector<double> &point) const override
+    std::vector<T> operator()(const std::vector<T> &point) const override
     {
-        std::vector<double> retval(this->get_m());
-        auto node = fill_nodes(point);
-        for (auto i = 0u; i < this->get_m(); ++i) {
-            retval[i] = node[this->get()[this->get().size() - this->get_m() + i]];
+        if (point.size() != this->get_n()) {
+            throw std::invalid_argument("Input size is incompatible");
         }
+        std::vector<T> retval(this->get_m());
+        typename expression<T>::workspace ws;
+        evaluate(point.data(), retval.data(), ws);
         return retval;
     }
+
+    /// Evaluates the dCGP-ANN expression (using a workspace)
+    /**
+     * This evaluates the dCGP-ANN expression writing the outputs into a caller provided buffer and
+     * using the buffers of a caller provided workspace. This method overrides the base class method.
+     *
+     * @param[in] point pointer to the n values where the dCGP-ANN expression has to be computed.
+     * @param[out] out pointer to the m values where the outputs will be written.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate(const T *point, T *out, typename expression<T>::workspace &ws) const override
+    {
+        ws.node.resize(this->get_n() + this->get_r() * this->get_c());
+        fill_nodes(point, ws.node, ws.function_in);
+        for (auto i = 0u; i < this->get_m(); ++i) {
+            out[i] = ws.node[this->get()[this->get().size() - this->get_m() + i]];
+        }
+    }
+
+    /// Evaluates the dCGP-ANN expression on a batch of points
+    /**
+     * This overrides the base class method. The points are evaluated one by one as the weights are not part of the
+     * tape interpreted by the base class.
+     *
+     * @param[in] points pointer to a column-major matrix of size n x N.
+     * @param[out] out pointer to a column-major matrix of size m x N where the outputs will be written.
+     * @param[in] N number of points.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate_batch(const T *points, T *out, unsigned N, typename expression<T>::workspace &ws) const override
+    {
+        for (auto k = 0u; k < N; ++k) {
+            evaluate(points + k * this->get_n(), out + k * this->get_m(), ws);
+        }
+    }
+
+    /// Accumulates the model loss over a batch of points
+    /**
+     * This overrides the base class method. The loss of each point is computed one by one as the weights are not part
+     * of the tape interpreted by the base class.
+     *
+     * @param[in] points pointer to the first of the \p N input points.
+     * @param[in] labels pointer to the first of the \p N labels.
+     * @param[in] N number of points.
+     * @param[in] loss_e the loss type.
+     * @param[in,out] retval the value the losses of the points are added to.
+     * @param[in,out] ws the evaluation workspace.
+     *
+     * @throw std::invalid_argument if the dimension of a point or of a label is wrong.
+     */
+    void accumulate_loss(const std::vector<T> *points, const std::vector<T> *labels, unsigned N,
+                         typename expression<T>::loss_type loss_e, T &retval,
+                         typename expression<T>::workspace &ws) const override
+    {
+        for (auto k = 0u; k < N; ++k) {
+            retval += this->loss(points[k], labels[k], loss_e, ws);
+        }
+    }
+
+    /// Updates a node cache
+    /**
+     * This overrides the base class method. The incremental evaluation is not available for dCGP-ANN expressions,
+     * as the weights are not part of the genes it compares.
+     *
+     * @throw std::invalid_argument always.
+     */
+    void update_node_cache(typename expression<T>::node_cache &) const override
+    {
+        throw std::invalid_argument("The incremental evaluation is not available for dCGP-ANN expressions");
+    }
+
+    /// Evaluates the dCGP-ANN expression incrementally on the dataset of a node cache
+    /**
+     * This overrides the base class method. The incremental evaluation is not available for dCGP-ANN expressions,
+     * as the weights are not part of the genes it compares.
+     *
+     * @throw std::invalid_argument always.
+     */
+    void evaluate_incremental(const typename expression<T>::node_cache &, T *,
+                              typename expression<T>::workspace &) const override
+    {
+        throw std::invalid_argument("The incremental evaluation is not available for dCGP-ANN expressions");
+    }
     /// Evaluates the dCGP-ANN expression
     /**
      * This evaluates the dCGP-ANN expression. This method overrides the base class
@@ -219,8 +289,12 @@ public:
      */
     std::vector<std::string> operator()(const std::vector<std::string> &point) const override
     {
+        if (point.size() != this->get_n()) {
+            throw std::invalid_argument("Input size is incompatible");
+        }
         std::vector<std::string> retval(this->get_m());
-        auto node = fill_nodes(point);
+        std::vector<std::string> node(this->get_n() + this->get_r() * this->get_c()), function_in;
+        fill_nodes(point.data(), node, function_in);
         for (auto i = 0u; i < this->get_m(); ++i) {
             retval[i] = node[this->get()[this->get().size() - this->get_m() + i]];
         }
@@ -230,7 +304,7 @@ public:
     /// Evaluates the dCGP-ANN expression
     /**
      * This evaluates the dCGP-ANN expression. This template can be instantiated
-     * with type *U* double, in which case the algorithm computes the numerical value of the inputs
+     * with type *U* = T, in which case the algorithm computes the numerical value of the inputs
      * or with *U* being a string, in which case the instantiated method will produce a symbolic representation of the
      * output.
      *
@@ -239,7 +313,7 @@ public:
      *
      * @return The value of the output (an std::vector)
      */
-    template <typename U, enable_double_string<U> = 0>
+    template <typename U, enable_T_string<U> = 0>
     std::vector<U> operator()(const std::initializer_list<U> &point) const
     {
         std::vector<U> dummy(point);
@@ -259,9 +333,32 @@ public:
      * @param[loss_e] The loss type. Must be loss_type::MSE for Mean Square Error (regression) or loss_type::CE for
      * Cross Entropy (classification)
      */
-    void d_loss(double &value, std::vector<double> &gweights, std::vector<double> &gbiases,
-                const std::vector<double> &point, const std::vector<double> &prediction,
-                const expression<double>::loss_type loss_e) const
+    void d_loss(T &value, std::vector<T> &gweights, std::vector<T> &gbiases,
+                const std::vector<T> &point, const std::vector<T> &prediction,
+                const typename expression<T>::loss_type loss_e) const
+    {
+        backprop_workspace ws;
+        d_loss(value, gweights, gbiases, point, prediction, loss_e, ws);
+    }
+
+    /// Cumulates the loss and its gradient (of a single point, using a workspace)
+    /**
+     * Cumulates the loss and its gradient with respect to weights and biases. The values are cumulated into the inputs.
+     * If called in a loop with many data points will cumulate the total batch values. The buffers of the
+     * workspace are used for the forward and backward passes, so that repeated calls do not allocate.
+     *
+     * @param[value] The initial loss
+     * @param[gweights] The initial loss gradient w.r.t. weights
+     * @param[gbiases] The initial loss gradient w.r.t. biases
+     * @param[point] The input data (single point)
+     * @param[prediction] The predicted output (single point)
+     * @param[loss_e] The loss type. Must be loss_type::MSE for Mean Square Error (regression) or loss_type::CE for
+     * Cross Entropy (classification)
+     * @param[ws] The backpropagation workspace
+     */
+    void d_loss(T &value, std::vector<T> &gweights, std::vector<T> &gbiases,
+                const std::vector<T> &point, const std::vector<T> &prediction,
+                const typename expression<T>::loss_type loss_e, backprop_workspace &ws) const
     {
         if (point.size() != this->get_n()) {
             throw std::invalid_argument("When computing the loss the point dimension (input) seemed wrong, it was: "
@@ -287,26 +384,31 @@ public:
         // All active nodes outputs get computed as well as
         // the activation function derivatives
         auto n_nodes = this->get_n() + this->get_r() * this->get_c();
-        std::vector<double> node(n_nodes, 0.), d_node(n_nodes, 0.);
-        fill_nodes(point, node, d_node); // here is where the computatinal graph is computed.
+        auto &node = ws.node;
+        auto &d_node = ws.d_node;
+        node.assign(n_nodes, T(0.));
+        d_node.assign(n_nodes, T(0.));
+        // here is where the computatinal graph is computed.
+        fill_nodes(point, node, d_node, ws.function_in);
 
         // We add to node_d some virtual nodes containing the derivative of the loss with respect to the outputs
         // (dL/do_i)
         switch (loss_e) {
             // Mean Square Error
-            case expression<double>::loss_type::MSE: {
-                auto sample_dim = static_cast<double>(prediction.size());
+            case expression<T>::loss_type::MSE: {
+                auto sample_dim = static_cast<T>(prediction.size());
                 for (decltype(this->get_m()) i = 0u; i < this->get_m(); ++i) {
                     auto node_idx = this->get()[this->get().size() - this->get_m() + i];
                     auto dummy = (node[node_idx] - prediction[i]);
-                    d_node.push_back(2. * dummy / sample_dim);
+                    d_node.push_back(T(2.) * dummy / sample_dim);
                     value += dummy * dummy / sample_dim;
                 }
                 break; // and exits the switch
             }
             // Cross Entropy
-            case expression<double>::loss_type::CE: {
-                std::vector<double> ps(this->get_m(), 0.);
+            case expression<T>::loss_type::CE: {
+                auto &ps = ws.out;
+                ps.resize(this->get_m());
                 // We store output values in ps
                 for (decltype(this->get_m()) i = 0u; i < this->get_m(); ++i) {
                     auto node_idx = this->get()[this->get().size() - this->get_m() + i];
@@ -314,20 +416,20 @@ public:
                 }
                 // We guard from numerical instabilities subtracting the max
                 auto max = *std::max_element(ps.begin(), ps.end());
-                std::transform(ps.begin(), ps.end(), ps.begin(), [max](double a) { return std::exp(a - max); });
+                std::transform(ps.begin(), ps.end(), ps.begin(), [max](T a) { return std::exp(a - max); });
                 // We compute the sum of exp(o_i - max)
-                double cumsum = std::accumulate(ps.begin(), ps.end(), 0.);
+                T cumsum = std::accumulate(ps.begin(), ps.end(), T(0.));
                 // We transform to probabilities p_i
-                std::transform(ps.begin(), ps.end(), ps.begin(), [cumsum](double a) { return a / cumsum; });
+                std::transform(ps.begin(), ps.end(), ps.begin(), [cumsum](T a) { return a / cumsum; });
                 // We add the derivatives of the loss w.r.t. to outputs
                 for (decltype(ps.size()) i = 0u; i < ps.size(); ++i) {
                     d_node.push_back(ps[i] - prediction[i]);
                 }
                 // We compute the cross-entropy
                 std::transform(ps.begin(), ps.end(), prediction.begin(), ps.begin(),
-                               [](double p, double y) { return std::log(p) * y; });
+                               [](T p, T y) { return std::log(p) * y; });
                 // - sum log(p_i) y_i
-                value += -std::accumulate(ps.begin(), ps.end(), 0.);
+                value += -std::accumulate(ps.begin(), ps.end(), T(0.));
                 break;
             }
         }
@@ -347,7 +449,7 @@ public:
             auto w_idx = c_idx - (node_id - this->get_n());
 
             // We update the d_node information
-            double cum = 0.;
+            T cum(0.);
             for (auto i = 0u; i < m_connected[node_id].size(); ++i) {
                 // If the node is not "virtual", that is not one of the m virtual nodes we added computing (x-x_i)^2
                 if (m_connected[node_id][i].first < this->get_n() + this->get_r() * this->get_c()) {
@@ -380,9 +482,9 @@ public:
      * @return the loss, the gradient of the loss w.r.t. all weights (also inactive) and the gradient of the loss w.r.t
      * all biases.
      */
-    std::tuple<double, std::vector<double>, std::vector<double>> d_loss(const std::vector<std::vector<double>> &points,
-                                                                        const std::vector<std::vector<double>> &labels,
-                                                                        expression<double>::loss_type loss_e,
+    std::tuple<T, std::vector<T>, std::vector<T>> d_loss(const std::vector<std::vector<T>> &points,
+                                                                        const std::vector<std::vector<T>> &labels,
+                                                                        typename expression<T>::loss_type loss_e,
                                                                         unsigned parallel = 0u)
     {
         if (points.size() != labels.size()) {
@@ -414,7 +516,7 @@ public:
      * @throws std::invalid_argument if the *data* and *label* size do not match or is zero, or if *lr* is not
      * positive.
      */
-    double sgd(std::vector<std::vector<double>> &points, std::vector<std::vector<double>> &labels, double lr,
+    T sgd(std::vector<std::vector<T>> &points, std::vector<std::vector<T>> &labels, T lr,
                unsigned batch_size, const std::string &loss_s, unsigned parallel = 0u, bool shuffle = true)
     {
         // Sanity checks for the inputs
@@ -431,11 +533,11 @@ public:
         }
 
         // Decoding the loss from string to the enum type (loss_s -> loss_e)
-        expression<double>::loss_type loss_e;
+        typename expression<T>::loss_type loss_e;
         if (loss_s == "MSE") {
-            loss_e = expression<double>::loss_type::MSE;
+            loss_e = expression<T>::loss_type::MSE;
         } else if (loss_s == "CE") {
-            loss_e = expression<double>::loss_type::CE;
+            loss_e = expression<T>::loss_type::CE;
         } else {
             throw std::invalid_argument("The requested loss was: " + loss_s + " while only MSE and CE are allowed");
         }
@@ -454,8 +556,8 @@ public:
         auto dfirst = points.begin();
         auto dlast = points.end();
         auto lfirst = labels.begin();
-        double retval = 0.;
-        double counter = 0.;
+        T retval(0.);
+        T counter(0.);
         while (dfirst != dlast) {
             if (dfirst + batch_size > dlast) {
                 retval += update_weights(dfirst, dlast, lfirst, lr, loss_e, parallel);
@@ -497,6 +599,10 @@ public:
             it = std::find(m_kernel_map.begin(), m_kernel_map.end(), kernel_type::ISRU);
         } else if (name == "sum") {
             it = std::find(m_kernel_map.begin(), m_kernel_map.end(), kernel_type::SUM);
+        } else if (name == "sig_fast") {
+            it = std::find(m_kernel_map.begin(), m_kernel_map.end(), kernel_type::SIG_FAST);
+        } else if (name == "tanh_fast") {
+            it = std::find(m_kernel_map.begin(), m_kernel_map.end(), kernel_type::TANH_FAST);
         }
 
         if (it == m_kernel_map.end()) {
@@ -579,7 +685,7 @@ public:
      *
      * @throws std::invalid_argument if the node_id or input_id are not valid
      */
-    void set_weight(unsigned node_id, unsigned input_id, const double &w)
+    void set_weight(unsigned node_id, unsigned input_id, const T &w)
     {
         if (node_id < this->get_n() || node_id >= this->get_n() + this->get_r() * this->get_c()) {
             throw std::invalid_argument("Requested node id does not exist");
@@ -601,7 +707,7 @@ public:
      *
      * @throws std::invalid_argument if the node_id or input_id are not valid
      */
-    void set_weight(std::vector<double>::size_type idx, const double &w)
+    void set_weight(typename std::vector<T>::size_type idx, const T &w)
     {
         m_weights[idx] = w;
     }
@@ -614,7 +720,7 @@ public:
      *
      * @throws std::invalid_argument if the input vector dimension is not valid.
      */
-    void set_weights(const std::vector<double> &ws)
+    void set_weights(const std::vector<T> &ws)
     {
         if (ws.size() != m_weights.size()) {
             throw std::invalid_argument("The vector of weights has the wrong dimension");
@@ -634,7 +740,7 @@ public:
      *
      * @throws std::invalid_argument if the node_id or input_id are not valid
      */
-    double get_weight(unsigned node_id, unsigned input_id) const
+    T get_weight(unsigned node_id, unsigned input_id) const
     {
         if (node_id < this->get_n() || node_id >= this->get_n() + this->get_r() * this->get_c()) {
             throw std::invalid_argument(
@@ -655,7 +761,7 @@ public:
      * @param[in] idx index of the weight
      *
      */
-    double get_weight(std::vector<double>::size_type idx) const
+    T get_weight(typename std::vector<T>::size_type idx) const
     {
         return m_weights[idx];
     }
@@ -666,7 +772,7 @@ public:
      *
      * @return an std::vector containing all the weights
      */
-    const std::vector<double> &get_weights() const
+    const std::vector<T> &get_weights() const
     {
         return m_weights;
     }
@@ -681,17 +787,17 @@ public:
  *
  */
 #if !defined(DCGP_DOXYGEN_INVOKED)
-    void randomise_weights(double mean = 0, double std = 0.1,
+    void randomise_weights(T mean = 0, T std = T(0.1),
                            std::random_device::result_type seed = std::random_device{}())
     {
         std::mt19937 gen{seed};
-        std::normal_distribution<double> nd{mean, std};
+        std::normal_distribution<T> nd{mean, std};
         for (auto &w : m_weights) {
             w = nd(gen);
         }
     }
 #else
-    void randomise_weights(double mean = 0, double std = 0.1, std::random_device::result_type seed = random_number) {}
+    void randomise_weights(T mean = 0, T std = T(0.1), std::random_device::result_type seed = random_number) {}
 #endif
 
     /// Sets a bias
@@ -702,7 +808,7 @@ public:
      * @param[w] value of the new bias.
      *
      */
-    void set_bias(typename std::vector<double>::size_type idx, const double &w)
+    void set_bias(typename std::vector<T>::size_type idx, const T &w)
     {
         m_biases[idx] = w;
     }
@@ -715,7 +821,7 @@ public:
      *
      * @throws std::invalid_argument if the input vector dimension is not valid (r*c)
      */
-    void set_biases(const std::vector<double> &bs)
+    void set_biases(const std::vector<T> &bs)
     {
         if (bs.size() != m_biases.size()) {
             throw std::invalid_argument("The vector of biases has the wrong dimension");
@@ -730,7 +836,7 @@ public:
      * @param[in] idx index of the bias
      *
      */
-    double get_bias(typename std::vector<double>::size_type idx) const
+    T get_bias(typename std::vector<T>::size_type idx) const
     {
         return m_biases[idx];
     }
@@ -741,7 +847,7 @@ public:
      *
      * @return an std::vector containing all the biases
      */
-    const std::vector<double> &get_biases() const
+    const std::vector<T> &get_biases() const
     {
         return m_biases;
     }
@@ -756,29 +862,74 @@ public:
  *
  */
 #if !defined(DCGP_DOXYGEN_INVOKED)
-    void randomise_biases(double mean = 0., double std = 0.1,
+    void randomise_biases(T mean = 0., T std = T(0.1),
                           std::random_device::result_type seed = std::random_device{}())
     {
         std::mt19937 gen{seed};
-        std::normal_distribution<double> nd{mean, std};
+        std::normal_distribution<T> nd{mean, std};
         for (auto &b : m_biases) {
             b = nd(gen);
         }
     }
 #else
-    void randomise_biases(double mean = 0, double std = 0.1, std::random_device::result_type seed = random_number) {}
+    void randomise_biases(T mean = 0, T std = T(0.1), std::random_device::result_type seed = random_number) {}
 #endif
 
     /*@}*/
 
     // Delete ephemeral constants methods.
-    void set_eph_val(const std::vector<double> &) = delete;
-    void set_eph_symb(const std::vector<double> &) = delete;
+    void set_eph_val(const std::vector<T> &) = delete;
+    void set_eph_symb(const std::vector<T> &) = delete;
+
+protected:
+    // Prints a node applying its weights and bias to the inputs (see expression::print_node())
+    std::string print_node(unsigned node_id, std::vector<std::string> &function_in) const override
+    {
+        unsigned g_idx = this->get_gene_idx()[node_id];
+        return kernel_call(function_in, g_idx, this->_get_arity(node_id), g_idx - (node_id - this->get_n()),
+                           node_id - this->get_n());
+    }
 
 private:
+    // Maps the kernels to the allowed ones using their opcodes
+    void init_kernel_map(const std::vector<kernel<T>> &f)
+    {
+        for (decltype(f.size()) i = 0u; i < f.size(); ++i) {
+            switch (f[i].get_opcode()) {
+                case kernel_opcode::sig:
+                    m_kernel_map[i] = kernel_type::SIG;
+                    break;
+                case kernel_opcode::tanh:
+                    m_kernel_map[i] = kernel_type::TANH;
+                    break;
+                case kernel_opcode::relu:
+                    m_kernel_map[i] = kernel_type::RELU;
+                    break;
+                case kernel_opcode::elu:
+                    m_kernel_map[i] = kernel_type::ELU;
+                    break;
+                case kernel_opcode::isru:
+                    m_kernel_map[i] = kernel_type::ISRU;
+                    break;
+                case kernel_opcode::sum:
+                    m_kernel_map[i] = kernel_type::SUM;
+                    break;
+                case kernel_opcode::sig_fast:
+                    m_kernel_map[i] = kernel_type::SIG_FAST;
+                    break;
+                case kernel_opcode::tanh_fast:
+                    m_kernel_map[i] = kernel_type::TANH_FAST;
+                    break;
+                default:
+                    throw std::invalid_argument("Only tanh, sig, ReLu, ELU, ISRU, sum, tanh_fast and sig_fast Kernels "
+                                                "are valid for dCGP-ANN expressions");
+            }
+        }
+    }
+
     // For numeric computations
-    double kernel_call(std::vector<double> &function_in, unsigned idx, unsigned arity, unsigned weight_idx,
-                       unsigned bias_idx) const
+    T kernel_call(std::vector<T> &function_in, unsigned idx, unsigned arity, unsigned weight_idx,
+                  unsigned bias_idx) const
     {
         // Weights (we transform the inputs a,b,c,d,e in w_1 a, w_2 b, w_3 c, etc...)
         for (auto j = 0u; j < arity; ++j) {
@@ -787,8 +938,27 @@ private:
         // Biases (we add to the first input a bias so that a,b,c,d,e goes in c, etc...))
         function_in[0] += m_biases[bias_idx];
         // We compute the node function that will, for example, map w_1 a + bias, w_2 b, w_3 c,... into f(w_1 a +
-        // w_2 b + w_3 c + ... + bias)
-        return this->get_f()[this->get()[idx]](function_in);
+        // w_2 b + w_3 c + ... + bias). The allowed kernels are called directly
+        auto in = [&function_in](unsigned j) -> const T & { return function_in[j]; };
+        switch (m_kernel_map[this->get()[idx]]) {
+            case kernel_type::SIG:
+                return sig_kernel::eval<T>(in, arity);
+            case kernel_type::TANH:
+                return tanh_kernel::eval<T>(in, arity);
+            case kernel_type::RELU:
+                return relu_kernel::eval<T>(in, arity);
+            case kernel_type::ELU:
+                return elu_kernel::eval<T>(in, arity);
+            case kernel_type::ISRU:
+                return isru_kernel::eval<T>(in, arity);
+            case kernel_type::SIG_FAST:
+                return sig_fast_kernel::eval<T>(in, arity);
+            case kernel_type::TANH_FAST:
+                return tanh_fast_kernel::eval<T>(in, arity);
+            case kernel_type::SUM:
+                break;
+        }
+        return sum_kernel::eval<T>(in, arity);
     }
 
     // For the symbolic expression
@@ -804,15 +974,10 @@ private:
         return this->get_f()[this->get()[idx]](function_in);
     }
 
-    // computes node to evaluate the expression
-    template <typename U, enable_double_string<U> = 0>
-    std::vector<U> fill_nodes(const std::vector<U> &in) const
+    // computes node to evaluate the expression (node must have size n + r * c)
+    template <typename U, enable_T_string<U> = 0>
+    void fill_nodes(const U *in, std::vector<U> &node, std::vector<U> &function_in) const
     {
-        if (in.size() != this->get_n()) {
-            throw std::invalid_argument("Input size is incompatible");
-        }
-        std::vector<U> node(this->get_n() + this->get_r() * this->get_c());
-        std::vector<U> function_in;
         for (auto node_id : this->get_active_nodes()) {
             if (node_id < this->get_n()) {
                 node[node_id] = in[node_id];
@@ -831,24 +996,23 @@ private:
                 node[node_id] = kernel_call(function_in, g_idx, arity, w_idx, b_idx);
             }
         }
-        return node;
     }
 
     // computes node and node_d to start backprop
-    void fill_nodes(const std::vector<double> &in, std::vector<double> &node, std::vector<double> &d_node) const
+    void fill_nodes(const std::vector<T> &in, std::vector<T> &node, std::vector<T> &d_node,
+                    std::vector<T> &function_in) const
     {
         if (in.size() != this->get_n()) {
             throw std::invalid_argument("Input size is incompatible");
         }
         // Start
-        std::vector<double> function_in;
         for (auto node_id : this->get_active_nodes()) {
             if (node_id < this->get_n()) {
                 node[node_id] = in[node_id];
                 // We need d_node to have the same structure of node, hence we also
                 // put some bogus entries fot the input nodes that actually do not have an activation function
                 // hence no need/use/meaning for a derivative
-                d_node[node_id] = 0.;
+                d_node[node_id] = T(0.);
             } else {
                 unsigned arity = this->_get_arity(node_id);
                 function_in.resize(arity);
@@ -866,22 +1030,24 @@ private:
                 // sigmoid derivative is sig(1-sig)
                 switch (m_kernel_map[this->get()[g_idx]]) {
                     case kernel_type::SIG:
-                        d_node[node_id] = node[node_id] * (1. - node[node_id]);
+                    case kernel_type::SIG_FAST:
+                        d_node[node_id] = node[node_id] * (T(1.) - node[node_id]);
                         break;
                     case kernel_type::TANH:
-                        d_node[node_id] = 1. - node[node_id] * node[node_id];
+                    case kernel_type::TANH_FAST:
+                        d_node[node_id] = T(1.) - node[node_id] * node[node_id];
                         break;
                     case kernel_type::SUM:
-                        d_node[node_id] = 1.;
+                        d_node[node_id] = T(1.);
                         break;
                     case kernel_type::RELU:
-                        d_node[node_id] = (node[node_id] > 0.) ? 1. : 0.;
+                        d_node[node_id] = (node[node_id] > T(0.)) ? T(1.) : T(0.);
                         break;
                     case kernel_type::ELU:
-                        d_node[node_id] = (node[node_id] > 0.) ? 1. : node[node_id] + 1.;
+                        d_node[node_id] = (node[node_id] > T(0.)) ? T(1.) : node[node_id] + T(1.);
                         break;
                     case kernel_type::ISRU: {
-                        auto cumin = std::accumulate(function_in.begin(), function_in.end(), 0.);
+                        auto cumin = std::accumulate(function_in.begin(), function_in.end(), T(0.));
                         d_node[node_id] = node[node_id] * node[node_id] * node[node_id] / cumin / cumin / cumin;
                         break;
                     }
@@ -890,11 +1056,12 @@ private:
         }
     }
 
-    // This overrides the base class update_data_structures and updates also the m_connected (as well as
-    // m_active_nodes and genes). It is called upon construction and each time active genes are changed.
-    void update_data_structures()
+    // This overrides the base class update_active_genes and updates also the m_connected (as well as
+    // the active genes). It is called upon construction and each time the active nodes are changed, also
+    // when this happens via the (incremental) mutation methods of the base class.
+    void update_active_genes() override
     {
-        expression<double>::update_data_structures();
+        expression<T>::update_active_genes();
         m_connected.clear();
         m_connected.resize(this->get_n() + this->get_m() + this->get_r() * this->get_c());
         for (auto node_id : this->get_active_nodes()) {
@@ -935,33 +1102,33 @@ private:
      * @return the loss before the weight update
      *
      */
-    double update_weights(typename std::vector<std::vector<double>>::const_iterator dfirst,
-                          typename std::vector<std::vector<double>>::const_iterator dlast,
-                          typename std::vector<std::vector<double>>::const_iterator lfirst, double lr,
-                          expression<double>::loss_type loss_e, unsigned parallel = 0u)
+    T update_weights(typename std::vector<std::vector<T>>::const_iterator dfirst,
+                          typename std::vector<std::vector<T>>::const_iterator dlast,
+                          typename std::vector<std::vector<T>>::const_iterator lfirst, T lr,
+                          typename expression<T>::loss_type loss_e, unsigned parallel = 0u)
     {
         auto err = d_loss(dfirst, dlast, lfirst, loss_e, parallel);
 
         // We now update the weights with the stochastic gradient descent update rule
         std::transform(m_weights.begin(), m_weights.end(), std::get<1>(err).begin(), m_weights.begin(),
-                       [&lr](double a, double b) { return a - lr * b; });
+                       [&lr](T a, T b) { return a - lr * b; });
         std::transform(m_biases.begin(), m_biases.end(), std::get<2>(err).begin(), m_biases.begin(),
-                       [&lr](double a, double b) { return a - lr * b; });
+                       [&lr](T a, T b) { return a - lr * b; });
         return std::get<0>(err);
     }
 
-    std::tuple<double, std::vector<double>, std::vector<double>>
-    d_loss(typename std::vector<std::vector<double>>::const_iterator dfirst,
-           typename std::vector<std::vector<double>>::const_iterator dlast,
-           typename std::vector<std::vector<double>>::const_iterator lfirst, expression<double>::loss_type loss_e,
+    std::tuple<T, std::vector<T>, std::vector<T>>
+    d_loss(typename std::vector<std::vector<T>>::const_iterator dfirst,
+           typename std::vector<std::vector<T>>::const_iterator dlast,
+           typename std::vector<std::vector<T>>::const_iterator lfirst, typename expression<T>::loss_type loss_e,
            unsigned parallel = 0u) const
     {
         // Batch dimension
         const unsigned batch_size = static_cast<unsigned>(dlast - dfirst);
         // These variables need to be read/written by all tasks.
-        double value = 0.;
-        std::vector<double> gweights(m_weights.size(), 0.);
-        std::vector<double> gbiases(m_biases.size(), 0.);
+        T value(0.);
+        std::vector<T> gweights(m_weights.size(), T(0.));
+        std::vector<T> gbiases(m_biases.size(), T(0.));
 
         if (parallel > 0u) {
             if (batch_size % parallel != 0) {
@@ -973,41 +1140,86 @@ private:
             tbb::spin_mutex mutex_weights_updates;
             // This loops over all points, predictions in the mini-batch
             tbb::parallel_for(0u, batch_size, inner_batch_size, [&](unsigned i) {
-                double value2 = 0.;
-                std::vector<double> gweights2(m_weights.size(), 0.);
-                std::vector<double> gbiases2(m_biases.size(), 0.);
+                T value2(0.);
+                std::vector<T> gweights2(m_weights.size(), T(0.));
+                std::vector<T> gbiases2(m_biases.size(), T(0.));
+                // Each task owns its workspace
+                backprop_workspace ws;
                 // The loss and its gradient get computed
                 for (auto j = 0u; j < inner_batch_size; ++j) {
-                    d_loss(value2, gweights2, gbiases2, *(dfirst + i + j), *(lfirst + i + j), loss_e);
+                    d_loss(value2, gweights2, gbiases2, *(dfirst + i + j), *(lfirst + i + j), loss_e, ws);
                 }
                 // We acquire the lock on the mutex
                 tbb::spin_mutex::scoped_lock lock(mutex_weights_updates);
                 // We update the cumulative loss and gradient
                 value += value2;
                 std::transform(gweights.begin(), gweights.end(), gweights2.begin(), gweights.begin(),
-                               [](double a, double b) { return a + b; });
+                               [](T a, T b) { return a + b; });
                 std::transform(gbiases.begin(), gbiases.end(), gbiases2.begin(), gbiases.begin(),
-                               [](double a, double b) { return a + b; });
+                               [](T a, T b) { return a + b; });
             });
         } else {
+            backprop_workspace ws;
             for (unsigned i = 0u; i < batch_size; ++i) {
                 // The loss and its gradient get computed and cumulated in value, gweights, gbiases
-                d_loss(value, gweights, gbiases, *(dfirst + i), *(lfirst + i), loss_e);
+                d_loss(value, gweights, gbiases, *(dfirst + i), *(lfirst + i), loss_e, ws);
             }
         }
-        std::transform(gweights.begin(), gweights.end(), gweights.begin(),
-                       [&batch_size](double a) { return a / batch_size; });
-        std::transform(gbiases.begin(), gbiases.end(), gbiases.begin(),
-                       [&batch_size](double a) { return a / batch_size; });
-        value /= batch_size;
+        const auto n_points = static_cast<T>(batch_size);
+        std::transform(gweights.begin(), gweights.end(), gweights.begin(), [n_points](T a) { return a / n_points; });
+        std::transform(gbiases.begin(), gbiases.end(), gbiases.begin(), [n_points](T a) { return a / n_points; });
+        value /= n_points;
         return std::make_tuple(std::move(value), std::move(gweights), std::move(gbiases));
     }
 
 private:
-    std::vector<double> m_weights;
+    friend class boost::serialization::access;
+    // Archives the expression (see expression::save()), the weights and the biases
+    template <typename Archive>
+    void save(Archive &ar, unsigned) const
+    {
+        ar << boost::serialization::base_object<expression<T>>(*this);
+        ar << m_weights;
+        ar << m_biases;
+    }
+
+    // Restores an archived dCGPANN, rebuilding the kernel map and the weights and biases symbols
+    template <typename Archive>
+    void load(Archive &ar, unsigned)
+    {
+        std::vector<T> weights, biases;
+        ar >> boost::serialization::base_object<expression<T>>(*this);
+        ar >> weights;
+        ar >> biases;
+        auto n = this->get_n();
+        auto rc = this->get_r() * this->get_c();
+        auto n_connections
+            = std::accumulate(this->get_arity().begin(), this->get_arity().end(), 0u) * this->get_r();
+        if (weights.size() != n_connections || biases.size() != rc) {
+            throw std::invalid_argument("The archive contains " + std::to_string(weights.size()) + " weights and "
+                                        + std::to_string(biases.size())
+                                        + " biases, while the archived dCGPANN has " + std::to_string(n_connections)
+                                        + " connections and " + std::to_string(rc) + " nodes");
+        }
+        m_kernel_map.resize(this->get_f().size());
+        init_kernel_map(this->get_f());
+        m_weights = weights;
+        m_biases = biases;
+        m_weights_symbols.clear();
+        m_biases_symbols.clear();
+        for (auto node_id = n; node_id < rc + n; ++node_id) {
+            for (auto j = 0u; j < this->_get_arity(node_id); ++j) {
+                m_weights_symbols.push_back("w" + std::to_string(node_id) + "_" + std::to_string(j));
+            }
+            m_biases_symbols.push_back("b" + std::to_string(node_id));
+        }
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    std::vector<T> m_weights;
     std::vector<std::string> m_weights_symbols;
 
-    std::vector<double> m_biases;
+    std::vector<T> m_biases;
     std::vector<std::string> m_biases_symbols;
 
     // In order to be able to perform backpropagation on the dCGPANN program, we need to add
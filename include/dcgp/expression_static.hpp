@@ -0,0 +1,201 @@
+#ifndef DCGP_EXPRESSION_STATIC_H
+#define DCGP_EXPRESSION_STATIC_H
+
+#include <algorithm>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <dcgp/config.hpp>
+#include <dcgp/expression.hpp>
+#include <dcgp/kernel_registry.hpp>
+#include <dcgp/rng.hpp>
+#include <dcgp/static_kernel_set.hpp>
+
+namespace dcgp
+{
+
+/// A dCGP expression with a compile-time kernel set
+/**
+ * This class represents the same mathematical expression as dcgp::expression, but its kernels are fixed at compile
+ * time (see dcgp::static_kernel_set). The numerical evaluation (expression::operator(), expression::evaluate(),
+ * expression::evaluate_batch() and the loss) selects the kernel of each node comparing its id to the kernel indexes,
+ * and calls it directly rather than via an std::function, so that the kernel bodies are inlined. The results are
+ * identical to those of a dcgp::expression constructed with the same kernels. All other methods (mutations,
+ * symbolic evaluation, etc.) are inherited unchanged. It is archived as a dcgp::expression, and can only be restored
+ * from an archive whose kernels are \p Kernels.
+ *
+ * @code
+ * expression_static<double, sum_kernel, diff_kernel, mul_kernel, div_kernel> ex(2, 1, 1, 10, 11, 2, 0u, 23u);
+ * @endcode
+ *
+ * @tparam T expression type. Can be double or float.
+ * @tparam Kernels the kernels (e.g. dcgp::sum_kernel).
+ */
+template <typename T, typename... Kernels>
+class expression_static : public expression<T>
+{
+    // Static checks.
+    static_assert(std::is_floating_point<T>::value,
+                  "A static d-CGP expression can only be operating on doubles or floats");
+
+    using kernels = static_kernel_set<T, Kernels...>;
+    using instruction = typename expression<T>::instruction;
+
+    // Calls the kernels through the static kernel set (see expression::dynamic_dispatch)
+    struct static_dispatch {
+        template <typename In>
+        static T call(const expression<T> &, const instruction &instr, In in, std::vector<T> &)
+        {
+            return kernels::call(instr.f_id, in, instr.arity);
+        }
+        template <typename Row>
+        static void run(const expression<T> &, const instruction &instr, Row row, T *res, unsigned b,
+                        typename expression<T>::workspace &)
+        {
+            kernels::run(instr.f_id, row, res, b, instr.arity);
+        }
+    };
+
+    friend class boost::serialization::access;
+    // Archives the expression (see expression::save())
+    template <typename Archive>
+    void save(Archive &ar, unsigned) const
+    {
+        ar << boost::serialization::base_object<expression<T>>(*this);
+    }
+
+    // Restores an archived expression, checking that its kernels are those dispatched statically (the expression is
+    // left unchanged otherwise)
+    template <typename Archive>
+    void load(Archive &ar, unsigned)
+    {
+        expression<T> old(*this);
+        ar >> boost::serialization::base_object<expression<T>>(*this);
+        auto f = kernels()();
+        bool same = this->get_f().size() == f.size();
+        for (decltype(f.size()) i = 0u; same && i < f.size(); ++i) {
+            same = this->get_f()[i].get_name() == f[i].get_name();
+        }
+        if (!same) {
+            expression<T>::operator=(old);
+            throw std::invalid_argument(
+                "The kernels of the archived expression are not those of this static expression");
+        }
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    // The smallest arity accepted by all the kernels (see kernel::get_min_arity())
+    static unsigned default_arity()
+    {
+        unsigned retval = 1u;
+        for (const auto &ker : kernels()()) {
+            retval = std::max(retval, ker.get_min_arity());
+        }
+        return retval;
+    }
+
+public:
+    /// Constructor
+    /** Constructs a static dCGP expression with variable arity
+     *
+     * @param[in] n number of inputs (independent variables).
+     * @param[in] m number of outputs (dependent variables).
+     * @param[in] r number of rows of the dCGP.
+     * @param[in] c number of columns of the dCGP.
+     * @param[in] l number of levels-back allowed in the dCGP.
+     * @param[in] arity arities of the basis functions for each column.
+     * @param[in] n_eph Number of ephemeral constants.
+     * @param[in] seed seed for the random number generator (initial expression and mutations depend on this).
+     */
+    expression_static(unsigned n,                  // n. inputs
+                      unsigned m,                  // n. outputs
+                      unsigned r,                  // n. rows
+                      unsigned c,                  // n. columns
+                      unsigned l,                  // n. levels-back
+                      std::vector<unsigned> arity, // basis functions' arity
+                      unsigned n_eph,              // number of ephemeral constants
+                      unsigned seed = dcgp::random_device::next())
+        : expression<T>(n, m, r, c, l, arity, kernels()(), n_eph, seed)
+    {
+    }
+
+    /// Constructor
+    /** Constructs a static dCGP expression with uniform arity
+     *
+     * @param[in] n number of inputs (independent variables).
+     * @param[in] m number of outputs (dependent variables).
+     * @param[in] r number of rows of the dCGP.
+     * @param[in] c number of columns of the dCGP.
+     * @param[in] l number of levels-back allowed in the dCGP.
+     * @param[in] arity arity of the basis functions. Defaults to the smallest arity accepted by all the kernels (e.g. 2
+     * if pdiv_kernel is among them).
+     * @param[in] n_eph Number of ephemeral constants.
+     * @param[in] seed seed for the random number generator (initial expression and mutations depend on this).
+     */
+    expression_static(unsigned n = 1u,                  // n. inputs
+                      unsigned m = 1u,                  // n. outputs
+                      unsigned r = 1u,                  // n. rows
+                      unsigned c = 1u,                  // n. columns
+                      unsigned l = 1u,                  // n. levels-back
+                      unsigned arity = default_arity(), // basis functions' arity
+                      unsigned n_eph = 0u,              // number of ephemeral constants
+                      unsigned seed = dcgp::random_device::next())
+        : expression<T>(n, m, r, c, l, arity, kernels()(), n_eph, seed)
+    {
+    }
+
+    /// Evaluates the dCGP expression (using a workspace)
+    /**
+     * As expression::evaluate(), with the kernels called directly.
+     *
+     * @param[in] point pointer to the values (n minus the number of ephemeral constants) where the dCGP expression has
+     * to be computed.
+     * @param[out] out pointer to the m values where the outputs will be written.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate(const T *point, T *out, typename expression<T>::workspace &ws) const override
+    {
+        this->template evaluate_impl<static_dispatch>(point, out, ws);
+    }
+
+    /// Evaluates the dCGP expression on a batch of points
+    /**
+     * As expression::evaluate_batch(), with the kernels called directly.
+     *
+     * @param[in] points pointer to a column-major matrix of size (n minus the number of ephemeral constants) x N.
+     * @param[out] out pointer to a column-major matrix of size m x N where the outputs will be written.
+     * @param[in] N number of points.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate_batch(const T *points, T *out, unsigned N, typename expression<T>::workspace &ws) const override
+    {
+        this->template evaluate_batch_impl<static_dispatch>(points, out, N, ws);
+    }
+
+    /// Adds the losses of a number of points
+    /**
+     * As expression::accumulate_loss(), with the kernels called directly.
+     *
+     * @param[in] points the points.
+     * @param[in] labels the labels.
+     * @param[in] N number of points.
+     * @param[in] loss_e the loss type.
+     * @param[in,out] retval the loss each point loss is added to.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void accumulate_loss(const std::vector<T> *points, const std::vector<T> *labels, unsigned N,
+                         typename expression<T>::loss_type loss_e, T &retval,
+                         typename expression<T>::workspace &ws) const override
+    {
+        this->template accumulate_loss_impl<static_dispatch>(points, labels, N, loss_e, retval, ws);
+    }
+};
+
+} // end of namespace dcgp
+
+#endif // DCGP_EXPRESSION_STATIC_H
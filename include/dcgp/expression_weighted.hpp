@@ -2,8 +2,13 @@
 #define DCGP_EXPRESSION_WEIGHTED_H
 
 #include <audi/audi.hpp>
+#include <boost/serialization/access.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
 #include <initializer_list>
 #include <iostream>
+#include <numeric>
 #include <random>
 #include <sstream>
 #include <stdexcept>
@@ -25,7 +30,9 @@ namespace dcgp
  * value (numerical and symbolical) of the expression and its derivatives, as well
  * as to mutate the expression.
  *
- * @tparam T expression type. Can be double, or a gdual type.
+ * As dcgp::expression, it can be saved to (and restored from) a Boost archive, which also stores the weights.
+ *
+ * @tparam T expression type. Can be double, float, or a gdual type.
  */
 template <typename T>
 class expression_weighted : public expression<T>
@@ -34,8 +41,9 @@ class expression_weighted : public expression<T>
 private:
     // SFINAE dust
     template <typename U>
-    using functor_enabler = typename std::enable_if<
-        std::is_same<U, double>::value || is_gdual<T>::value || std::is_same<U, std::string>::value, int>::type;
+    using functor_enabler = typename std::enable_if<std::is_same<U, double>::value || std::is_same<U, float>::value
+                                                        || is_gdual<T>::value || std::is_same<U, std::string>::value,
+                                                    int>::type;
 
 public:
     /// Constructor
@@ -124,8 +132,25 @@ public:
             throw std::invalid_argument("Input size is incompatible");
         }
         std::vector<T> retval(this->get_m());
-        std::vector<T> node(this->get_n() + this->get_r() * this->get_c());
-        std::vector<T> function_in;
+        typename expression<T>::workspace ws;
+        evaluate(in.data(), retval.data(), ws);
+        return retval;
+    }
+
+    /// Evaluates the dCGP-weighted expression (using a workspace)
+    /**
+     * This evaluates the dCGP-weighted expression writing the outputs into a caller provided buffer and
+     * using the buffers of a caller provided workspace. This method overrides the base class method.
+     *
+     * @param[in] in pointer to the n values where the dCGP-weighted expression has to be computed.
+     * @param[out] out pointer to the m values where the outputs will be written.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate(const T *in, T *out, typename expression<T>::workspace &ws) const override
+    {
+        auto &node = ws.node;
+        auto &function_in = ws.function_in;
+        node.resize(this->get_n() + this->get_r() * this->get_c());
         for (auto node_id : this->get_active_nodes()) {
             if (node_id < this->get_n()) {
                 node[node_id] = in[node_id];
@@ -143,9 +168,73 @@ public:
             }
         }
         for (auto i = 0u; i < this->get_m(); ++i) {
-            retval[i] = node[this->get()[this->get().size() - this->get_m() + i]];
+            out[i] = node[this->get()[this->get().size() - this->get_m() + i]];
+        }
+    }
+
+    /// Evaluates the dCGP-weighted expression on a batch of points
+    /**
+     * This overrides the base class method. The points are evaluated one by one as the weights are not part of the
+     * tape interpreted by the base class.
+     *
+     * @param[in] points pointer to a column-major matrix of size n x N.
+     * @param[out] out pointer to a column-major matrix of size m x N where the outputs will be written.
+     * @param[in] N number of points.
+     * @param[in,out] ws the evaluation workspace.
+     */
+    void evaluate_batch(const T *points, T *out, unsigned N, typename expression<T>::workspace &ws) const override
+    {
+        for (auto k = 0u; k < N; ++k) {
+            evaluate(points + k * this->get_n(), out + k * this->get_m(), ws);
         }
-        return retval;
+    }
+
+    /// Accumulates the model loss over a batch of points
+    /**
+     * This overrides the base class method. The loss of each point is computed one by one as the weights are not part
+     * of the tape interpreted by the base class.
+     *
+     * @param[in] points pointer to the first of the \p N input points.
+     * @param[in] labels pointer to the first of the \p N labels.
+     * @param[in] N number of points.
+     * @param[in] loss_e the loss type.
+     * @param[in,out] retval the value the losses of the points are added to.
+     * @param[in,out] ws the evaluation workspace.
+     *
+     * @throw std::invalid_argument if the dimension of a point or of a label is wrong.
+     */
+    void accumulate_loss(const std::vector<T> *points, const std::vector<T> *labels, unsigned N,
+                         typename expression<T>::loss_type loss_e, T &retval,
+                         typename expression<T>::workspace &ws) const override
+    {
+        for (auto k = 0u; k < N; ++k) {
+            retval += this->loss(points[k], labels[k], loss_e, ws);
+        }
+    }
+
+    /// Updates a node cache
+    /**
+     * This overrides the base class method. The incremental evaluation is not available for dCGP-weighted expressions,
+     * as the weights are not part of the genes it compares.
+     *
+     * @throw std::invalid_argument always.
+     */
+    void update_node_cache(typename expression<T>::node_cache &) const override
+    {
+        throw std::invalid_argument("The incremental evaluation is not available for dCGP-weighted expressions");
+    }
+
+    /// Evaluates the dCGP-weighted expression incrementally on the dataset of a node cache
+    /**
+     * This overrides the base class method. The incremental evaluation is not available for dCGP-weighted expressions,
+     * as the weights are not part of the genes it compares.
+     *
+     * @throw std::invalid_argument always.
+     */
+    void evaluate_incremental(const typename expression<T>::node_cache &, T *,
+                              typename expression<T>::workspace &) const override
+    {
+        throw std::invalid_argument("The incremental evaluation is not available for dCGP-weighted expressions");
     }
 
     /// Evaluates the dCGP-weighted expression
@@ -315,10 +404,18 @@ public:
     void set_eph_val(const std::vector<T> &) = delete;
     void set_eph_symb(const std::vector<T> &) = delete;
 
+protected:
+    // Prints a node applying its weights to the inputs (see expression::print_node())
+    std::string print_node(unsigned node_id, std::vector<std::string> &function_in) const override
+    {
+        unsigned g_idx = this->get_gene_idx()[node_id];
+        return kernel_call(function_in, g_idx, node_id, g_idx - (node_id - this->get_n()));
+    }
+
         private :
         // For numeric computations
         template <typename U,
-                  typename std::enable_if<std::is_same<U, double>::value || is_gdual<U>::value, int>::type = 0>
+                  typename std::enable_if<std::is_floating_point<U>::value || is_gdual<U>::value, int>::type = 0>
         U kernel_call(std::vector<U> &function_in, unsigned idx, unsigned node_id, unsigned weight_idx) const
     {
         // Weights (we transform the inputs a,b,c,d,e in w_1 a, w_2 b, w_3 c, etc...)
@@ -339,6 +436,39 @@ public:
         return this->get_f()[this->get()[idx]](function_in);
     }
 
+    friend class boost::serialization::access;
+    // Archives the expression (see expression::save()) and the weights
+    template <typename Archive>
+    void save(Archive &ar, unsigned) const
+    {
+        ar << boost::serialization::base_object<expression<T>>(*this);
+        ar << m_weights;
+    }
+
+    // Restores an archived weighted expression, rebuilding the weights symbols
+    template <typename Archive>
+    void load(Archive &ar, unsigned)
+    {
+        std::vector<T> weights;
+        ar >> boost::serialization::base_object<expression<T>>(*this);
+        ar >> weights;
+        auto n_connections
+            = std::accumulate(this->get_arity().begin(), this->get_arity().end(), 0u) * this->get_r();
+        if (weights.size() != n_connections) {
+            throw std::invalid_argument("The archive contains " + std::to_string(weights.size())
+                                        + " weights, while the archived expression has "
+                                        + std::to_string(n_connections) + " connections");
+        }
+        m_weights = weights;
+        m_weights_symbols.clear();
+        for (auto node_id = this->get_n(); node_id < this->get_r() * this->get_c() + this->get_n(); ++node_id) {
+            for (auto j = 0u; j < this->_get_arity(node_id); ++j) {
+                m_weights_symbols.push_back("w" + std::to_string(node_id) + "_" + std::to_string(j));
+            }
+        }
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
     std::vector<T> m_weights;
     std::vector<std::string> m_weights_symbols;
 };
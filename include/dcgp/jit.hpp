@@ -0,0 +1,390 @@
+#ifndef DCGP_JIT_H
+#define DCGP_JIT_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <pwd.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <typeinfo>
+#include <unistd.h>
+#include <vector>
+
+#include <dcgp/c_export.hpp>
+#include <dcgp/expression.hpp>
+
+namespace dcgp
+{
+
+/// Native code compilation of a dCGP expression
+/**
+ * For expressions that are evaluated a very large number of times (e.g. a champion deployed in some
+ * application), interpreting the graph is the dominant cost. This class emits C++ source code for the active
+ * phenotype of an expression<double>, builds it with the system compiler into a shared object, loads it with
+ * \p dlopen and evaluates it with the same semantics as expression::operator(): each kernel is translated to the
+ * very same floating point operations, so that the results are identical.
+ *
+ * The shared objects are kept in an on-disk cache, keyed by a hash of the phenotype (see expression::get_phenotype()),
+ * so that an expression compiled once is never recompiled, also across different runs. The values of the ephemeral
+ * constants are passed at run time, hence changing them (e.g. after a gradient descent) does not trigger a
+ * recompilation either. The generated source is stored alongside the shared object and compared upon lookup, so
+ * that hash collisions are detected. As the cached shared objects are loaded into the process, the cache directory
+ * must be owned by the current user and not writable by the others, and only shared objects with the same properties
+ * are reused.
+ *
+ * Only the kernels of dcgp::kernel_set are supported. This class is available on POSIX systems only.
+ */
+class jit_expression
+{
+public:
+    /// Constructor
+    /**
+     * Compiles (or loads from the cache) the native code of a dCGP expression.
+     *
+     * @param[in] ex the expression. Its kernels must be among those of dcgp::kernel_set.
+     * @param[in] cache_dir the directory of the cache (created with mode 0700 if needed). Defaults to the value of the
+     * environment variable DCGP_JIT_CACHE or, if not set, to $XDG_CACHE_HOME/dcgp_jit or ~/.cache/dcgp_jit.
+     * @param[in] compiler the compiler command, split into words and run without a shell (e.g. "ccache c++").
+     * Defaults to the value of the environment variable DCGP_JIT_CXX or, if not set, to c++.
+     *
+     * @throw std::invalid_argument if \p ex is not a plain expression<double>, if it contains kernels that cannot
+     * be compiled or if \p compiler is empty.
+     * @throw std::runtime_error if \p cache_dir is not a directory owned by the current user and not writable by the
+     * others, or if the compilation or the loading of the shared object fails.
+     */
+    explicit jit_expression(const expression<double> &ex, const std::string &cache_dir = default_cache_dir(),
+                            const std::string &compiler = default_compiler())
+        : m_n_in(ex.get_n() - static_cast<unsigned>(ex.get_eph_val().size())), m_m(ex.get_m()),
+          m_eph_val(ex.get_eph_val()), m_source(source(ex)), m_cached(false)
+    {
+        std::vector<std::string> compiler_args;
+        std::istringstream words(compiler);
+        for (std::string word; words >> word;) {
+            compiler_args.push_back(word);
+        }
+        if (compiler_args.empty()) {
+            throw std::invalid_argument("The compiler command is empty");
+        }
+        make_dirs(cache_dir);
+        if (!is_private(cache_dir, true)) {
+            throw std::runtime_error("The cache directory " + cache_dir
+                                     + " must be a directory owned by the current user and not writable by the others");
+        }
+        std::ostringstream stem;
+        stem << cache_dir << "/dcgp_" << std::hex << structure_hash(ex) << "_" << std::hash<std::string>()(m_source);
+        m_library = stem.str() + ".so";
+        const std::string source_file = stem.str() + ".cpp";
+        // The shared object is reused only if the stored source is exactly the one we would compile
+        m_cached = is_private(m_library, false) && read_file(source_file) == m_source;
+        if (!m_cached) {
+            // We compile into temporary files and rename them, so that concurrent processes never see a partial file.
+            // Their names derive from a file created by mkstemp, hence they are unique also across threads.
+            std::string tmp = stem.str() + "_XXXXXX";
+            const int fd = ::mkstemp(&tmp[0]);
+            if (fd == -1) {
+                throw std::runtime_error("Could not create a temporary file in the cache directory " + cache_dir);
+            }
+            ::close(fd);
+            temp_files guard{{tmp, tmp + ".cpp", tmp + ".so", tmp + ".log"}};
+            write_file(tmp + ".cpp", m_source);
+            compiler_args.insert(compiler_args.end(),
+                                 {"-O2", "-fPIC", "-shared", "-ffp-contract=off", "-o", tmp + ".so", tmp + ".cpp"});
+            if (run(compiler_args, tmp + ".log") != 0) {
+                std::string command;
+                for (const auto &arg : compiler_args) {
+                    command += (command.empty() ? "" : " ") + arg;
+                }
+                throw std::runtime_error("The compilation of the expression failed (" + command + "):\n"
+                                         + read_file(tmp + ".log"));
+            }
+            // The shared object is moved first: a source without its shared object would be a valid cache entry
+            if (::chmod((tmp + ".so").c_str(), S_IRWXU) != 0
+                || std::rename((tmp + ".so").c_str(), m_library.c_str()) != 0
+                || std::rename((tmp + ".cpp").c_str(), source_file.c_str()) != 0) {
+                throw std::runtime_error("Could not move the compiled expression into the cache: " + m_library);
+            }
+        }
+        void *handle = ::dlopen(m_library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            throw std::runtime_error("Could not load the compiled expression: " + std::string(::dlerror()));
+        }
+        m_handle = std::shared_ptr<void>(handle, [](void *h) { ::dlclose(h); });
+        m_f = reinterpret_cast<function_type>(::dlsym(handle, "dcgp_jit_evaluate"));
+        if (!m_f) {
+            throw std::runtime_error("The compiled expression has no entry point: " + m_library);
+        }
+    }
+
+    /// Evaluates the compiled expression
+    /**
+     * Evaluates the compiled expression, returning the same values as expression::operator().
+     *
+     * @param[in] point an std::vector containing the values where the expression has to be computed.
+     *
+     * @return The value of the function (an std::vector)
+     *
+     * @throw std::invalid_argument if the size of \p point is not the number of inputs minus the number of
+     * ephemeral constants.
+     */
+    std::vector<double> operator()(const std::vector<double> &point) const
+    {
+        if (point.size() != m_n_in) {
+            throw std::invalid_argument("Input size is incompatible");
+        }
+        std::vector<double> retval(m_m);
+        m_f(point.data(), m_eph_val.data(), retval.data());
+        return retval;
+    }
+
+    /// Evaluates the compiled expression (unchecked)
+    /**
+     * Evaluates the compiled expression writing the outputs into a caller provided buffer. No allocation takes
+     * place and no checks are made on the sizes of the buffers.
+     *
+     * @param[in] point pointer to the values (n minus the number of ephemeral constants) where the expression has
+     * to be computed.
+     * @param[out] out pointer to the m values where the outputs will be written.
+     */
+    void evaluate(const double *point, double *out) const
+    {
+        m_f(point, m_eph_val.data(), out);
+    }
+
+    /// Gets the path of the shared object
+    /**
+     * @return the path of the shared object in the cache.
+     */
+    const std::string &get_library() const
+    {
+        return m_library;
+    }
+
+    /// Gets the generated source
+    /**
+     * @return the C++ source compiled into the shared object.
+     */
+    const std::string &get_source() const
+    {
+        return m_source;
+    }
+
+    /// Cache hit
+    /**
+     * @return true if the shared object was found in the cache, false if it was compiled.
+     */
+    bool cached() const
+    {
+        return m_cached;
+    }
+
+    /// Generates the source of an expression
+    /**
+     * Generates the C++ source code of the active phenotype of an expression. The source defines the function
+     * <tt>extern "C" void dcgp_jit_evaluate(const double *x, const double *c, double *out)</tt>, computing in
+     * \p out the m outputs from the inputs \p x and the values of the ephemeral constants \p c. The ephemeral
+     * constants are passed at run time rather than written in the source, so that the compiler cannot fold the
+     * kernels with a different rounding than that of the library.
+     *
+     * @param[in] ex the expression.
+     *
+     * @return the C++ source.
+     *
+     * @throw std::invalid_argument if \p ex is not a plain expression<double> or if it contains kernels that cannot
+     * be compiled.
+     */
+    static std::string source(const expression<double> &ex)
+    {
+        // Derived expressions (e.g. weighted ones) have a different semantics
+        if (typeid(ex) != typeid(expression<double>)) {
+            throw std::invalid_argument("Only expression<double> can be compiled, not its derived classes");
+        }
+        const auto &x = ex.get();
+        const auto n = ex.get_n();
+        const auto n_in = n - static_cast<unsigned>(ex.get_eph_val().size());
+        // The name of the variable holding the value of a node
+        auto var = [n, n_in](unsigned node_id) {
+            if (node_id < n_in) {
+                return "x[" + std::to_string(node_id) + "]";
+            } else if (node_id < n) {
+                return "c[" + std::to_string(node_id - n_in) + "]";
+            }
+            return "n" + std::to_string(node_id);
+        };
+        std::ostringstream ss;
+        ss << "// Generated by dcgp::jit_expression\n";
+        ss << "#include <math.h>\n\n";
+        ss << "extern \"C\" void dcgp_jit_evaluate(const double *x, const double *c, double *out)\n{\n";
+        ss << "    (void)x;\n    (void)c;\n";
+        // Active nodes are sorted, hence each node only depends on nodes already computed
+        for (auto node_id : ex.get_active_nodes()) {
+            if (node_id < n) {
+                continue;
+            }
+            const auto idx = ex.get_gene_idx()[node_id];
+            const auto arity = ex.get_arity(node_id);
+            std::vector<std::string> in;
+            for (auto j = 0u; j < arity; ++j) {
+                in.push_back(var(x[idx + 1u + j]));
+            }
+            detail::emit_c_kernel(ss, ex.get_f()[x[idx]].get_name(), var(node_id), in);
+        }
+        for (auto i = 0u; i < ex.get_m(); ++i) {
+            ss << "    out[" << i << "] = " << var(x[x.size() - ex.get_m() + i]) << ";\n";
+        }
+        ss << "}\n";
+        return ss.str();
+    }
+
+private:
+    using function_type = void (*)(const double *, const double *, double *);
+
+    static std::string default_cache_dir()
+    {
+        const char *dir = std::getenv("DCGP_JIT_CACHE");
+        if (dir) {
+            return dir;
+        }
+        const char *xdg = std::getenv("XDG_CACHE_HOME");
+        if (xdg && xdg[0] == '/') {
+            return std::string(xdg) + "/dcgp_jit";
+        }
+        const char *home = std::getenv("HOME");
+        if (!home || home[0] != '/') {
+            const passwd *pw = ::getpwuid(::geteuid());
+            home = pw ? pw->pw_dir : "/";
+        }
+        return std::string(home) + "/.cache/dcgp_jit";
+    }
+
+    static std::string default_compiler()
+    {
+        const char *cxx = std::getenv("DCGP_JIT_CXX");
+        return cxx ? cxx : "c++";
+    }
+
+    // Hashes the phenotype of an expression. Unlike expression::phenotype_hash(), the values of the ephemeral constants
+    // are not hashed, as the source does not depend on them.
+    static std::size_t structure_hash(const expression<double> &ex)
+    {
+        std::size_t seed = 0u;
+        for (auto gene : ex.get_phenotype()) {
+            seed ^= std::hash<unsigned>()(gene) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+
+    // Creates a directory and its parents (as mkdir -p), accessible by the current user only
+    static void make_dirs(const std::string &dir)
+    {
+        for (auto pos = dir.find('/', 1u);; pos = dir.find('/', pos + 1u)) {
+            const std::string partial = dir.substr(0u, pos);
+            if (::mkdir(partial.c_str(), S_IRWXU) != 0 && !file_exists(partial)) {
+                throw std::runtime_error("Could not create the directory " + partial);
+            }
+            if (pos == std::string::npos) {
+                break;
+            }
+        }
+    }
+
+    static bool file_exists(const std::string &path)
+    {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+
+    // Whether path is a directory (or a regular file) owned by the current user and not writable by the others.
+    // Symbolic links are not followed.
+    static bool is_private(const std::string &path, bool dir)
+    {
+        struct stat st;
+        if (::lstat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        return (dir ? S_ISDIR(st.st_mode) : S_ISREG(st.st_mode)) && st.st_uid == ::geteuid()
+               && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    }
+
+    // Runs a command without a shell, writing its output to log_file, and returns its exit status (-1 if it could
+    // not be run)
+    static int run(const std::vector<std::string> &args, const std::string &log_file)
+    {
+        std::vector<char *> argv;
+        for (const auto &arg : args) {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        const int log = ::open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        if (log == -1) {
+            return -1;
+        }
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::dup2(log, STDOUT_FILENO);
+            ::dup2(log, STDERR_FILENO);
+            ::execvp(argv[0], argv.data());
+            ::_exit(127);
+        }
+        ::close(log);
+        if (pid == -1) {
+            return -1;
+        }
+        int status;
+        while (::waitpid(pid, &status, 0) == -1) {
+            if (errno != EINTR) {
+                return -1;
+            }
+        }
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    // Removes the temporary files of a compilation on every exit path (those moved into the cache are gone already)
+    struct temp_files {
+        ~temp_files()
+        {
+            for (const auto &file : files) {
+                std::remove(file.c_str());
+            }
+        }
+        std::vector<std::string> files;
+    };
+
+    // Returns the content of a file (empty if it cannot be read)
+    static std::string read_file(const std::string &path)
+    {
+        std::ifstream f(path);
+        return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+    static void write_file(const std::string &path, const std::string &content)
+    {
+        std::ofstream f(path);
+        f << content;
+        if (!f) {
+            throw std::runtime_error("Could not write the file " + path);
+        }
+    }
+
+    unsigned m_n_in;
+    unsigned m_m;
+    std::vector<double> m_eph_val;
+    std::string m_source;
+    std::string m_library;
+    bool m_cached;
+    std::shared_ptr<void> m_handle;
+    function_type m_f;
+};
+
+} // namespace dcgp
+
+#endif // DCGP_JIT_H
@@ -4,7 +4,7 @@
 #include <functional> // std::function
 #include <iostream>
 #include <string>
-#include <utility> // std::forward
+#include <utility> // std::forward, std::move
 #include <vector>
 
 #include <dcgp/config.hpp>
@@ -12,6 +12,59 @@
 namespace dcgp
 {
 
+template <typename T>
+class kernel_registry;
+
+/// Opcodes of the built-in kernels
+/**
+ * Identifies the kernels of dcgp::kernel_set, so that they can be called directly rather than via an std::function.
+ * User defined kernels are dcgp::kernel_opcode::custom.
+ */
+enum class kernel_opcode {
+    /// A user defined kernel
+    custom,
+    /// my_sum
+    sum,
+    /// my_diff
+    diff,
+    /// my_mul
+    mul,
+    /// my_div
+    div,
+    /// my_pdiv
+    pdiv,
+    /// my_sig
+    sig,
+    /// my_tanh
+    tanh,
+    /// my_relu
+    relu,
+    /// my_elu
+    elu,
+    /// my_isru
+    isru,
+    /// my_sin
+    sin,
+    /// my_cos
+    cos,
+    /// my_log
+    log,
+    /// my_exp
+    exp,
+    /// my_gaussian
+    gaussian,
+    /// my_sqrt
+    sqrt,
+    /// my_sig_fast
+    sig_fast,
+    /// my_tanh_fast
+    tanh_fast,
+    /// my_exp_fast
+    exp_fast,
+    /// my_gaussian_fast
+    gaussian_fast
+};
+
 /// Basis function
 /**
  * This class represents the function defining the generic CGP node. To be constructed
@@ -53,6 +106,12 @@ public:
     using my_fun_type = std::function<T(const std::vector<T> &)>;
     /// Basic prototype of a kernel function returning its symbolic representation
     using my_print_fun_type = std::function<std::string(const std::vector<std::string> &)>;
+    /// Prototype of the unary entry point of a kernel function
+    using my_unary_fun_type = std::function<T(const T &)>;
+    /// Prototype of the binary entry point of a kernel function
+    using my_binary_fun_type = std::function<T(const T &, const T &)>;
+    /// Prototype of the batched entry point of a kernel function
+    using my_batch_fun_type = std::function<void(const std::vector<const T *> &, T *, unsigned)>;
 #endif
     /// Constructor
     /**
@@ -61,10 +120,39 @@ public:
      * @param[in] f any callable with prototype T(const std::vector<T>&)
      * @param[in] pf any callable with prototype std::string(const std::vector<std::string>&)
      * @param[in] name string containing the function name (ex. "sum")
+     * @param[in] op the opcode of the built-in kernel \p f is (see dcgp::kernel_set). Expressions call the built-in
+     * kernels directly, hence it must be left to dcgp::kernel_opcode::custom for any other function.
+     *
+     */
+    template <typename U, typename V>
+    kernel(U &&f, V &&pf, std::string name, kernel_opcode op = kernel_opcode::custom)
+        : m_f(std::forward<U>(f)), m_pf(std::forward<V>(pf)), m_name(name), m_op(op)
+    {
+    }
+
+    /// Constructor
+    /**
+     * Constructs a kernel with fixed-arity and batched entry points. The fixed-arity ones are called, instead of
+     * \p f, on one or two inputs which then need not be copied into an std::vector. The batched one, given
+     * pointers in[0], ..., in[arity - 1] to the values of each input over b points, writes the b kernel values
+     * to out, so that a whole block of points is processed by a single call. They must return the same values as
+     * \p f.
+     *
+     * @param[in] f any callable with prototype T(const std::vector<T>&)
+     * @param[in] pf any callable with prototype std::string(const std::vector<std::string>&)
+     * @param[in] name string containing the function name (ex. "sum")
+     * @param[in] f1 the unary entry point, returning f({a}) (can be empty)
+     * @param[in] f2 the binary entry point, returning f({a, b}) (can be empty)
+     * @param[in] fb the batched entry point, with prototype void(const std::vector<const T *> &in, T *out,
+     * unsigned b) (can be empty)
+     * @param[in] op the opcode of the built-in kernel \p f is (see the other constructor)
      *
      */
     template <typename U, typename V>
-    kernel(U &&f, V &&pf, std::string name) : m_f(std::forward<U>(f)), m_pf(std::forward<V>(pf)), m_name(name)
+    kernel(U &&f, V &&pf, std::string name, my_unary_fun_type f1, my_binary_fun_type f2,
+           my_batch_fun_type fb = nullptr, kernel_opcode op = kernel_opcode::custom)
+        : m_f(std::forward<U>(f)), m_pf(std::forward<V>(pf)), m_f1(std::move(f1)), m_f2(std::move(f2)),
+          m_fb(std::move(fb)), m_name(name), m_op(op)
     {
     }
 
@@ -93,6 +181,54 @@ public:
         return m_f(in);
     }
     /// Parenthesis operator
+    /**
+     * Evaluates the kernel on a single input, through its unary entry point if it has one
+     *
+     * @param[in] a the input
+     *
+     * @return the function value
+     */
+    T operator()(const T &a) const
+    {
+        return m_f1 ? m_f1(a) : m_f({a});
+    }
+    /// Parenthesis operator
+    /**
+     * Evaluates the kernel on two inputs, through its binary entry point if it has one
+     *
+     * @param[in] a the first input
+     * @param[in] b the second input
+     *
+     * @return the function value
+     */
+    T operator()(const T &a, const T &b) const
+    {
+        return m_f2 ? m_f2(a, b) : m_f({a, b});
+    }
+    /// Parenthesis operator
+    /**
+     * Evaluates the kernel over b points, through its batched entry point if it has one and point by point
+     * otherwise
+     *
+     * @param[in] in pointers to the b values of each input
+     * @param[out] out pointer to where the b kernel values will be written
+     * @param[in] b number of points
+     */
+    void operator()(const std::vector<const T *> &in, T *out, unsigned b) const
+    {
+        if (m_fb) {
+            m_fb(in, out, b);
+            return;
+        }
+        std::vector<T> point(in.size());
+        for (auto k = 0u; k < b; ++k) {
+            for (decltype(in.size()) j = 0u; j < in.size(); ++j) {
+                point[j] = in[j][k];
+            }
+            out[k] = m_f(point);
+        }
+    }
+    /// Parenthesis operator
     /**
      * Returns a symbolic representation of the operation made by \f$f\f$
      *
@@ -116,6 +252,57 @@ public:
         return m_name;
     }
 
+    /// Checks for a unary entry point
+    /**
+     * @return true if the kernel was constructed with a unary entry point
+     */
+    bool has_unary() const
+    {
+        return static_cast<bool>(m_f1);
+    }
+
+    /// Checks for a binary entry point
+    /**
+     * @return true if the kernel was constructed with a binary entry point
+     */
+    bool has_binary() const
+    {
+        return static_cast<bool>(m_f2);
+    }
+
+    /// Checks for a batched entry point
+    /**
+     * @return true if the kernel was constructed with a batched entry point
+     */
+    bool has_batch() const
+    {
+        return static_cast<bool>(m_fb);
+    }
+
+    /// Kernel opcode
+    /**
+     * Returns the opcode of the kernel
+     *
+     * @return the opcode (dcgp::kernel_opcode::custom for user defined kernels)
+     */
+    kernel_opcode get_opcode() const
+    {
+        return m_op;
+    }
+
+    /// Minimum number of inputs
+    /**
+     * Returns the minimum number of inputs the kernel accepts: the one it was registered with (see
+     * dcgp::kernel_registry::add()) for the kernels obtained from the registry, two for the protected division
+     * (which always reads two inputs) and one otherwise.
+     *
+     * @return the minimum number of inputs.
+     */
+    unsigned get_min_arity() const
+    {
+        return (m_op == kernel_opcode::pdiv && m_min_arity < 2u) ? 2u : m_min_arity;
+    }
+
     /// Overloaded stream operator
     /**
      * Will stream the function name
@@ -137,8 +324,21 @@ private:
     my_fun_type m_f;
     /// Its symbolic representation
     my_print_fun_type m_pf;
+    /// Its unary entry point
+    my_unary_fun_type m_f1;
+    /// Its binary entry point
+    my_binary_fun_type m_f2;
+    /// Its batched entry point
+    my_batch_fun_type m_fb;
     /// Its name
     std::string m_name;
+    /// Its opcode
+    kernel_opcode m_op;
+    /// The minimum number of inputs it was registered with
+    unsigned m_min_arity = 1u;
+
+    // The registry sets the minimum number of inputs of the kernels it holds
+    friend class kernel_registry<T>;
 };
 
 } // end of namespace dcgp
@@ -0,0 +1,202 @@
+#ifndef DCGP_KERNEL_REGISTRY_H
+#define DCGP_KERNEL_REGISTRY_H
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <dcgp/config.hpp>
+#include <dcgp/kernel.hpp>
+#include <dcgp/static_kernel_set.hpp>
+
+namespace dcgp
+{
+
+/// Global registry of the named kernels
+/**
+ * dcgp::kernel_set (and hence dcgpy and dcgp::symbolic_regression) resolves kernel names through this registry, which
+ * holds, for each type \p T, one entry per name. It is initialised with the built-in kernels (see dcgp::sum_kernel),
+ * and users can add their own, so that a custom (e.g. hand-optimised) kernel can be constructed by name everywhere
+ * a built-in one can:
+ *
+ * @code
+ * kernel<double> cube(my_cube, print_my_cube, "cube", my_cube_unary, my_cube_binary, my_cube_batch);
+ * kernel_registry<double>::instance().add(cube);
+ * kernel_set<double> ks({"sum", "cube"});
+ * @endcode
+ *
+ * All methods are thread-safe.
+ *
+ * @tparam T The type of the kernels output (and inputs)
+ */
+template <typename T>
+class kernel_registry
+{
+public:
+    /// A registered kernel
+    struct entry {
+        /// The kernel (function, print function, fixed-arity and batched entry points)
+        kernel<T> k;
+        /// The name of the kernel replacing this one where derivatives are computed (e.g. "div" for "pdiv")
+        std::string differentiable;
+        /// The minimum number of inputs (see expression::expression)
+        unsigned min_arity;
+    };
+
+    /// The registry
+    /**
+     * Returns the registry of the kernels of type \p T, creating it (with the built-in kernels) at the first call.
+     *
+     * @return a reference to the registry.
+     */
+    static kernel_registry &instance()
+    {
+        static kernel_registry registry;
+        return registry;
+    }
+
+    /// Registers a kernel
+    /**
+     * Registers a kernel under its name (kernel::get_name()).
+     *
+     * @param[in] k the kernel.
+     * @param[in] differentiable the name of the kernel to be used in place of this one where derivatives are computed
+     * (e.g. by dcgp::symbolic_regression). Empty means the kernel itself.
+     * @param[in] min_arity the minimum number of inputs the kernel accepts. Expressions with a smaller arity cannot
+     * be constructed with it.
+     *
+     * @throw std::invalid_argument if a kernel with the same name is already registered or if \p min_arity is zero.
+     */
+    void add(const kernel<T> &k, const std::string &differentiable = "", unsigned min_arity = 1u)
+    {
+        if (min_arity == 0u) {
+            throw std::invalid_argument("The minimum arity of the kernel " + k.get_name() + " must be at least one");
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.count(k.get_name())) {
+            throw std::invalid_argument("A kernel called " + k.get_name() + " is already registered");
+        }
+        // The kernels resolved from the registry carry their minimum arity (see kernel::get_min_arity())
+        kernel<T> registered(k);
+        registered.m_min_arity = min_arity;
+        m_entries.emplace(k.get_name(),
+                          entry{registered, differentiable.empty() ? k.get_name() : differentiable, min_arity});
+    }
+
+    /// Unregisters a kernel
+    /**
+     * Removes a kernel from the registry. Kernel sets and expressions already constructed with it are not affected.
+     *
+     * @param[in] name the kernel name.
+     *
+     * @throw std::invalid_argument if no kernel called \p name is registered.
+     */
+    void remove(const std::string &name)
+    {
+        // The kernel is destroyed outside of the lock, as its functions may hold resources of their own
+        typename std::map<std::string, entry>::node_type removed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            removed = m_entries.extract(name);
+        }
+        if (removed.empty()) {
+            throw std::invalid_argument("Unimplemented function " + name + " for this type");
+        }
+    }
+
+    /// Checks whether a kernel is registered
+    /**
+     * @param[in] name the kernel name.
+     *
+     * @return true if a kernel called \p name is registered.
+     */
+    bool contains(const std::string &name) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.count(name) > 0u;
+    }
+
+    /// Gets a registered kernel
+    /**
+     * @param[in] name the kernel name.
+     *
+     * @return a copy of the entry registered as \p name.
+     *
+     * @throw std::invalid_argument if no kernel called \p name is registered.
+     */
+    entry get(const std::string &name) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(name);
+        if (it == m_entries.end()) {
+            throw std::invalid_argument("Unimplemented function " + name + " for this type");
+        }
+        return it->second;
+    }
+
+    /// Names of the registered kernels
+    /**
+     * @return the names of all registered kernels, in alphabetical order.
+     */
+    std::vector<std::string> names() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<std::string> retval;
+        for (const auto &item : m_entries) {
+            retval.push_back(item.first);
+        }
+        return retval;
+    }
+
+    // The registry cannot be copied
+    kernel_registry(const kernel_registry &) = delete;
+    kernel_registry &operator=(const kernel_registry &) = delete;
+
+private:
+    // Registers the built-in kernels
+    kernel_registry()
+    {
+        add(sum_kernel::get<T>());
+        add(diff_kernel::get<T>());
+        add(mul_kernel::get<T>());
+        add(div_kernel::get<T>());
+        add(sig_kernel::get<T>());
+        add(tanh_kernel::get<T>());
+        add(relu_kernel::get<T>());
+        add(elu_kernel::get<T>());
+        add(isru_kernel::get<T>());
+        add(sin_kernel::get<T>());
+        add(cos_kernel::get<T>());
+        add(log_kernel::get<T>());
+        add(exp_kernel::get<T>());
+        add(gaussian_kernel::get<T>());
+        add(sqrt_kernel::get<T>());
+        add_floating_point();
+    }
+
+    // pdiv and the approximate kernels are only available when T is double or float
+    template <typename U = T, typename std::enable_if<std::is_floating_point<U>::value, int>::type = 0>
+    void add_floating_point()
+    {
+        add(pdiv_kernel::get<U>(), "div", 2u);
+        add(sig_fast_kernel::get<U>(), "sig");
+        add(tanh_fast_kernel::get<U>(), "tanh");
+        add(exp_fast_kernel::get<U>(), "exp");
+        add(gaussian_fast_kernel::get<U>(), "gaussian");
+    }
+
+    template <typename U = T, typename std::enable_if<!std::is_floating_point<U>::value, int>::type = 0>
+    void add_floating_point()
+    {
+    }
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, entry> m_entries;
+};
+
+} // end of namespace dcgp
+
+#endif // DCGP_KERNEL_REGISTRY_H
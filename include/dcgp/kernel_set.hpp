@@ -2,11 +2,13 @@
 #define DCGP_kernel_set_H
 
 #include <audi/audi.hpp>
-#include <type_traits>
+#include <string>
 #include <vector>
 
 #include <dcgp/config.hpp>
 #include <dcgp/kernel.hpp>
+#include <dcgp/kernel_registry.hpp>
+#include <dcgp/static_kernel_set.hpp>
 #include <dcgp/wrapped_functions.hpp>
 
 namespace dcgp
@@ -45,8 +47,7 @@ public:
 
     /// Adds a kernel to the set
     /**
-     * Constructs a kernel<T> given a string containing the function name, and
-     * inserts it into the std::vector
+     * Inserts the kernel registered as \p kernel_name (see dcgp::kernel_registry) into the std::vector
      *
      * @param[in] kernel_name a string containing the function name
      *
@@ -54,41 +55,7 @@ public:
      */
     void push_back(std::string kernel_name)
     {
-        if (kernel_name == "sum")
-            m_kernels.emplace_back(my_sum<T>, print_my_sum, kernel_name);
-        else if (kernel_name == "diff")
-            m_kernels.emplace_back(my_diff<T>, print_my_diff, kernel_name);
-        else if (kernel_name == "mul")
-            m_kernels.emplace_back(my_mul<T>, print_my_mul, kernel_name);
-        else if (kernel_name == "div")
-            m_kernels.emplace_back(my_div<T>, print_my_div, kernel_name);
-        //  pdiv is only available when class type is double
-        else if (kernel_name == "pdiv" && std::is_same<T, double>::value)
-            m_kernels.emplace_back(my_pdiv<T>, print_my_pdiv, kernel_name);
-        else if (kernel_name == "sig")
-            m_kernels.emplace_back(my_sig<T>, print_my_sig, kernel_name);
-        else if (kernel_name == "tanh")
-            m_kernels.emplace_back(my_tanh<T>, print_my_tanh, kernel_name);
-        else if (kernel_name == "ReLu")
-            m_kernels.emplace_back(my_relu<T>, print_my_relu, kernel_name);
-        else if (kernel_name == "ELU")
-            m_kernels.emplace_back(my_elu<T>, print_my_elu, kernel_name);
-        else if (kernel_name == "ISRU")
-            m_kernels.emplace_back(my_isru<T>, print_my_isru, kernel_name);
-        else if (kernel_name == "sin")
-            m_kernels.emplace_back(my_sin<T>, print_my_sin, kernel_name);
-        else if (kernel_name == "cos")
-            m_kernels.emplace_back(my_cos<T>, print_my_cos, kernel_name);
-        else if (kernel_name == "log")
-            m_kernels.emplace_back(my_log<T>, print_my_log, kernel_name);
-        else if (kernel_name == "exp")
-            m_kernels.emplace_back(my_exp<T>, print_my_exp, kernel_name);
-        else if (kernel_name == "gaussian")
-            m_kernels.emplace_back(my_gaussian<T>, print_my_gaussian, kernel_name);
-        else if (kernel_name == "sqrt")
-            m_kernels.emplace_back(my_sqrt<T>, print_my_sqrt, kernel_name);
-        else
-            throw std::invalid_argument("Unimplemented function " + kernel_name + " for this type");
+        m_kernels.push_back(kernel_registry<T>::instance().get(kernel_name).k);
     }
 
     /// Adds a kernel to the set
@@ -0,0 +1,138 @@
+#ifndef DCGP_PHENOTYPE_CACHE_H
+#define DCGP_PHENOTYPE_CACHE_H
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dcgp
+{
+
+/// A bounded cache of values computed on phenotypes
+/**
+ * Distinct chromosomes often share the same phenotype (they differ only in inactive genes) and evolutionary
+ * strategies keep proposing phenotypes that were already evaluated. This class stores values (e.g. the loss)
+ * computed on a phenotype, keyed by expression::phenotype_hash(). The full phenotype and the ephemeral constants
+ * values are stored too, so that hash collisions are detected and never return a wrong value.
+ *
+ * At most \p capacity entries are kept, the least recently used one being evicted first. All methods are
+ * thread-safe, so that a single cache can be shared by several copies of a problem evaluated concurrently.
+ *
+ * @tparam V the type of the cached values.
+ */
+template <typename V>
+class phenotype_cache
+{
+public:
+    /// Constructor
+    /**
+     * Constructs an empty cache.
+     *
+     * @param[in] capacity maximum number of entries stored. A zero capacity disables the cache.
+     */
+    explicit phenotype_cache(std::size_t capacity = 1024u) : m_capacity(capacity) {}
+
+    /// Looks up a phenotype
+    /**
+     * Looks up the value stored for a phenotype and, if found, marks it as the most recently used.
+     *
+     * @param[in] hash the phenotype hash (see expression::phenotype_hash()).
+     * @param[in] phenotype the phenotype (see expression::get_phenotype()).
+     * @param[in] eph_val the values of the ephemeral constants.
+     * @param[out] value the cached value, untouched if the phenotype is not in the cache.
+     *
+     * @return true if the phenotype was found.
+     */
+    bool find(std::size_t hash, const std::vector<unsigned> &phenotype, const std::vector<double> &eph_val,
+              V &value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_map.find(hash);
+        if (it == m_map.end() || it->second->phenotype != phenotype || it->second->eph_val != eph_val) {
+            return false;
+        }
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        value = it->second->value;
+        return true;
+    }
+
+    /// Stores a value
+    /**
+     * Stores the value computed for a phenotype, replacing any value stored under the same hash and evicting
+     * the least recently used entry if the cache is full.
+     *
+     * @param[in] hash the phenotype hash (see expression::phenotype_hash()).
+     * @param[in] phenotype the phenotype (see expression::get_phenotype()).
+     * @param[in] eph_val the values of the ephemeral constants.
+     * @param[in] value the value to store.
+     */
+    void insert(std::size_t hash, const std::vector<unsigned> &phenotype, const std::vector<double> &eph_val,
+                const V &value)
+    {
+        if (m_capacity == 0u) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_map.find(hash);
+        if (it != m_map.end()) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            it->second->phenotype = phenotype;
+            it->second->eph_val = eph_val;
+            it->second->value = value;
+            return;
+        }
+        if (m_entries.size() == m_capacity) {
+            m_map.erase(m_entries.back().hash);
+            m_entries.pop_back();
+        }
+        m_entries.push_front(entry{hash, phenotype, eph_val, value});
+        m_map.emplace(hash, m_entries.begin());
+    }
+
+    /// Number of entries
+    /**
+     * @return the number of entries currently stored.
+     */
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+    /// Capacity
+    /**
+     * @return the maximum number of entries stored.
+     */
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /// Clears the cache
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_map.clear();
+        m_entries.clear();
+    }
+
+private:
+    struct entry {
+        std::size_t hash;
+        std::vector<unsigned> phenotype;
+        std::vector<double> eph_val;
+        V value;
+    };
+
+    std::size_t m_capacity;
+    // Most recently used first
+    std::list<entry> m_entries;
+    std::unordered_map<std::size_t, typename std::list<entry>::iterator> m_map;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace dcgp
+#endif // DCGP_PHENOTYPE_CACHE_H
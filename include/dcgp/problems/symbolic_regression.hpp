@@ -3,6 +3,7 @@
 #include <audi/gdual.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/range/algorithm/transform.hpp>
+#include <memory>
 #include <numeric> // std::accumulate
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
@@ -11,7 +12,9 @@
 #include <vector>
 
 #include <dcgp/expression.hpp>
+#include <dcgp/kernel_registry.hpp>
 #include <dcgp/kernel_set.hpp>
+#include <dcgp/phenotype_cache.hpp>
 #include <dcgp/rng.hpp>
 
 namespace dcgp
@@ -32,6 +35,9 @@ namespace dcgp
  * The symbolic regression problem can be instantiated both as a single and a two-objectives problem. In the second
  * case, aside the Mean Squared Error, the formula complexity will be considered as an objective.
  *
+ * Fitness, gradient and hessians are cached by phenotype (see dcgp::phenotype_cache), so that chromosomes
+ * differing only in inactive genes are evaluated on the data only once. Copies of the problem share the cache.
+ *
  */
 class symbolic_regression
 {
@@ -44,7 +50,7 @@ public:
      */
     symbolic_regression()
         : m_points(1), m_labels(1), m_r(1), m_c(1), m_l(1), m_arity(2), m_f(kernel_set<double>({"sum"})()), m_n_eph(0),
-          m_multi_objective(true), m_parallel_batches(0u)
+          m_multi_objective(true), m_parallel_batches(0u), m_incremental(false), m_cache(std::make_shared<phenotype_cache<cache_entry>>())
     {
     }
 
@@ -61,7 +67,10 @@ public:
      * @param[in] f function set. An std::vector of dcgp::kernel<expression::type>.
      * @param[in] n_eph number of ephemeral constants.
      * @param[in] multi_objective when true, it will consider the model complexity as a second objective.
-     * @param[in] parallel_batches number of parallel batches.
+     * @param[in] parallel_batches when non zero, the loss is evaluated in parallel (any data size is allowed).
+     * @param[in] incremental when true (and \p parallel_batches is zero), the loss is evaluated reusing the values of
+     * the nodes of the chromosome evaluated last (see expression::node_cache). The result is the same, but one column of
+     * data size values is kept for each input, ephemeral constant and active node.
      *
      * @throws std::invalid_argument if points and labels are not consistent.
      * @throws std::invalid_argument if the CGP related parameters (i.e. *r*, *c*, etc...) are malformed.
@@ -75,10 +84,12 @@ public:
                         = kernel_set<double>({"sum", "diff", "mul", "pdiv"})(), // functions
                         unsigned n_eph = 0u,                                    // number of ephemeral constants
                         bool multi_objective = false,  // when true the fitness also returns the formula complexity
-                        unsigned parallel_batches = 0u // number of parallel batches
+                        unsigned parallel_batches = 0u, // number of parallel batches
+                        bool incremental = false        // when true the node values are reused among fitness calls
                         )
         : m_points(points), m_labels(labels), m_r(r), m_c(c), m_l(l), m_arity(arity), m_f(f), m_n_eph(n_eph),
-          m_multi_objective(multi_objective), m_parallel_batches(parallel_batches)
+          m_multi_objective(multi_objective), m_parallel_batches(parallel_batches), m_incremental(incremental),
+          m_cache(std::make_shared<phenotype_cache<cache_entry>>())
     {
         unsigned n;
         unsigned m;
@@ -91,13 +102,12 @@ public:
         kernel_set<audi::gdual_d> f_g;
         for (const auto &ker : f) {
             auto name = ker.get_name();
-            // If protected division is used in the cgp the unprotected one will be used in the dCGP
-            // as to keep derivative sanity
-            if (name.compare("pdiv") == 0) {
-                f_g.push_back("div");
-            } else {
-                f_g.push_back(ker.get_name());
+            // Kernels such as the protected division are replaced in the dCGP by the one registered for
+            // derivatives (e.g. the unprotected division) as to keep derivative sanity
+            if (kernel_registry<double>::instance().contains(name)) {
+                name = kernel_registry<double>::instance().get(name).differentiable;
             }
+            f_g.push_back(name);
         }
         m_dcgp = expression<audi::gdual_d>(n, m, m_r, m_c, m_l, m_arity, f_g(), m_n_eph, seed);
         // We initialize the dpoints/dduals
@@ -152,11 +162,19 @@ public:
         std::vector<double> retval(1u + m_multi_objective, 0);
         // Here we set the CGP member from the chromosome
         set_cgp(x);
-        if (x == m_cache_fitness.first) {
-            retval[0] = m_cache_fitness.second[0];
+        // We look for the phenotype in the cache
+        auto hash = m_cgp.phenotype_hash();
+        auto phenotype = m_cgp.get_phenotype();
+        cache_entry entry;
+        m_cache->find(hash, phenotype, m_cgp.get_eph_val(), entry);
+        if (entry.fitness.size() == retval.size()) {
+            return entry.fitness;
+        }
+        if (m_incremental && m_parallel_batches == 0u) {
+            // We compute the MSE loss reusing the node values of the previously evaluated chromosome.
+            retval[0] = incremental_mse();
         } else {
-            // And we compute the MSE loss splitting the data in n batches.
-            // TODO: make this work also when m_parallel_batches does not divide exactly the data size.
+            // We compute the MSE loss (in parallel if m_parallel_batches > 0).
             retval[0] = m_cgp.loss(m_points, m_labels, "MSE", m_parallel_batches);
         }
         // In the multiobjective case we compute the formula complexity
@@ -166,24 +184,62 @@ public:
             // the shortest string among pretty and prettier. That is among the raw cgp expression
             // and the result of constructing a symengine expression out of it (which carries out some
             // basic simplifications but that may results in rare occasions in a longer string).
-            std::vector<std::string> pretty = m_cgp(m_symbols);
-            double l_pretty = std::accumulate(pretty.begin(), pretty.end(), 0., [](double a, std::string b) {
-                return a + static_cast<double>(b.length());
-            });
-            double l_prettier = 0.;
-            for (decltype(pretty.size()) i = 0u; i < pretty.size(); ++i) {
-                SymEngine::Expression prettier(pretty[i]);
-                pagmo::stream(ss, prettier);
-                auto string = ss.str();
-                // We remove whitespaces too
-                l_prettier += static_cast<double>(string.length() - static_cast<decltype(string.length())>(std::count(string.begin(), string.end(), ' ')));
+            // The length of pretty is computed without building it, as it can grow exponentially with
+            // the depth of the graph, and past max_prettier_length the formula is not simplified.
+            std::vector<double> lengths = m_cgp.symbolic_length(m_symbols);
+            double l_pretty = std::accumulate(lengths.begin(), lengths.end(), 0.);
+            double l_prettier = l_pretty;
+            if (l_pretty <= max_prettier_length) {
+                std::vector<std::string> pretty = m_cgp(m_symbols);
+                l_prettier = 0.;
+                for (decltype(pretty.size()) i = 0u; i < pretty.size(); ++i) {
+                    SymEngine::Expression prettier(pretty[i]);
+                    pagmo::stream(ss, prettier);
+                    auto string = ss.str();
+                    // We remove whitespaces too
+                    l_prettier += static_cast<double>(string.length() - static_cast<decltype(string.length())>(std::count(string.begin(), string.end(), ' ')));
+                }
             }
             // Here we define the formula complexity
             retval[1] = std::min(l_pretty, l_prettier);
         }
+        entry.fitness = retval;
+        m_cache->insert(hash, phenotype, m_cgp.get_eph_val(), entry);
         return retval;
     }
 
+    /// Single precision loss
+    /**
+     * Computes the MSE loss of a decision vector in single precision, on a copy of the data stored as floats. With
+     * respect to the fitness, this halves the memory traffic and doubles the width of the vectorized kernels, while
+     * being accurate enough to rank candidate models (e.g. when screening many of them on a large dataset). The
+     * result is not cached.
+     *
+     * The single precision copies of the data and of the inner CGP are only built at the first call, so that problems
+     * never evaluated in single precision do not pay for them. The copy of the data is shared (read only) by the copies
+     * of the problem made afterwards.
+     *
+     * @param x the decision vector.
+     *
+     * @return the MSE loss of \p x, computed in single precision.
+     *
+     * @throws std::invalid_argument if a kernel of the problem is not available for float (e.g. a user kernel
+     * registered only for double).
+     */
+    double float_loss(const pagmo::vector_double &x) const
+    {
+        if (!m_fdata) {
+            init_float();
+        }
+        std::vector<unsigned> xu(x.size() - m_n_eph);
+        std::transform(x.data() + m_n_eph, x.data() + x.size(), xu.data(),
+                       [](double a) { return boost::numeric_cast<unsigned>(a); });
+        m_fcgp.set(xu);
+        std::vector<float> eph_val(x.data(), x.data() + m_n_eph);
+        m_fcgp.set_eph_val(eph_val);
+        return m_fcgp.loss(m_fdata->points, m_fdata->labels, "MSE", m_parallel_batches);
+    }
+
     /// Gradient computation
     /**
      * Computes the gradient of the loss with respect to the ephemeral constants (i.e. the continuous part of the
@@ -196,6 +252,14 @@ public:
     pagmo::vector_double gradient(const pagmo::vector_double &x) const
     {
         std::vector<double> retval(m_n_eph, 0);
+        // We look for the phenotype in the cache
+        set_cgp(x);
+        auto hash = m_cgp.phenotype_hash();
+        auto phenotype = m_cgp.get_phenotype();
+        cache_entry entry;
+        if (m_cache->find(hash, phenotype, m_cgp.get_eph_val(), entry) && entry.gradient.size() == m_n_eph) {
+            return entry.gradient;
+        }
         // The chromosome has a floating point part (the ephemeral constants) and an integer part (the encoded CGP).
         // 1 - We extract the integer part and represent it as an unsigned vector to set the CGP expression.
         std::vector<unsigned> xu(x.size() - m_n_eph);
@@ -208,13 +272,9 @@ public:
             eph_val.emplace_back(x[i], m_dcgp.get_eph_symb()[i], 1u); // Only first derivative is needed
         }
         m_dcgp.set_eph_val(eph_val);
-        // 3 - We compute the MSE loss splitting the data in n batches.
-        // TODO: make this work also when m_parallel_batches does not divide exactly the data size.
+        // 3 - We compute the MSE loss (in parallel if m_parallel_batches > 0).
         auto loss = m_dcgp.loss(m_dpoints, m_dlabels, "MSE", m_parallel_batches);
-        // Now we extract fitness and gradient and store the values in th caches or in the return value
-        m_cache_fitness.first = x;
-        m_cache_fitness.second.resize(get_nobj());
-        m_cache_fitness.second[0] = loss.constant_cf();
+        // Now we extract the gradient and store the values in the cache and in the return value
         loss.extend_symbol_set(m_deph_symb);
         if (!(loss.get_order() == 0u)) { // this happens when input terminals of the eph constants are inactive
                                          // (gradient is then zero)
@@ -224,6 +284,8 @@ public:
                 retval[i] = loss.get_derivative(coeff);
             }
         }
+        entry.gradient = retval;
+        m_cache->insert(hash, phenotype, m_cgp.get_eph_val(), entry);
         return retval;
     }
 
@@ -263,10 +325,16 @@ public:
         for (const auto &item : hs) {
             retval.emplace_back(item.size(), 0.);
         }
+        // We look for the phenotype in the cache
+        set_cgp(x);
+        auto hash = m_cgp.phenotype_hash();
+        auto phenotype = m_cgp.get_phenotype();
+        cache_entry entry;
+        if (m_cache->find(hash, phenotype, m_cgp.get_eph_val(), entry) && entry.hessians.size() == retval.size()) {
+            return entry.hessians;
+        }
         // Initializing the gradient to zeros.
-        m_cache_gradient.first = x;
-        m_cache_gradient.second.clear();
-        m_cache_gradient.second.resize(m_n_eph, 0.);
+        pagmo::vector_double gradient(m_n_eph, 0.);
 
         // The chromosome has a floating point part (the ephemeral constants) and an integer part (the encoded CGP).
         // 1 - We extract the integer part and represent it as an unsigned vector to set the CGP expression.
@@ -286,10 +354,7 @@ public:
         // We make sure all symbols are in so that we get zeros when querying for a variable not in the gdual
         loss.extend_symbol_set(m_deph_symb);
 
-        // Now we extract fitness, gradient and hessians from the gdual and store the values (retval or cache)
-        m_cache_fitness.first = x;
-        m_cache_fitness.second.resize(get_nobj());
-        m_cache_fitness.second[0] = loss.constant_cf();
+        // Now we extract gradient and hessians from the gdual and store the values (retval and cache)
         // We compute the gradient and the hessian only if
         // the loss depends on at least one ephemeral constant.
         // Otherwise the initialization values will be returned, that is zeros.
@@ -298,7 +363,7 @@ public:
             for (decltype(m_n_eph) i = 0u; i < m_n_eph; ++i) {
                 std::vector<unsigned> coeff(m_n_eph, 0.);
                 coeff[i] = 1.;
-                m_cache_gradient.second[i] = loss.get_derivative(coeff);
+                gradient[i] = loss.get_derivative(coeff);
             }
             // hessian (we return it)
             for (decltype(hd) i = 0u; i < hd; ++i) {
@@ -308,6 +373,9 @@ public:
                 retval[0][i] = loss.get_derivative(coeff);
             }
         }
+        entry.gradient = gradient;
+        entry.hessians = retval;
+        m_cache->insert(hash, phenotype, m_cgp.get_eph_val(), entry);
         return retval;
     }
 
@@ -413,6 +481,33 @@ public:
         return ss.str();
     }
 
+    /// Human-readable representation of a decision vector (with shared subexpressions).
+    /**
+     * A human readable representation of the chromosome is here obtained by calling
+     * expression::symbolic_dag() assuming as inputs variables names \f$x_1, x_2, ...\f$ and
+     * as ephemeral constants names \f$c_1, c_2, ...\f$. Unlike pretty(), its length is linear in
+     * the number of active nodes, which makes it suitable for logging deep graphs.
+     *
+     * @param[in] x a valid chromosome.
+     *
+     * @return a string containing the bindings of the active nodes and of the outputs (e.g. "t3 = (x0*x1); y0 = t3").
+     */
+    std::string pretty_dag(const pagmo::vector_double &x) const
+    {
+        // Here we set the CGP data member from the chromosome
+        set_cgp(x);
+
+        std::vector<std::string> symbols;
+        for (decltype(m_points[0].size()) i = 0u; i < m_points[0].size(); ++i) {
+            symbols.push_back("x" + std::to_string(i));
+        }
+        std::string retval;
+        for (const auto &binding : m_cgp.symbolic_dag(symbols)) {
+            retval += (retval.empty() ? "" : "; ") + binding;
+        }
+        return retval;
+    }
+
     /// Human-readable representation of a decision vector.
     /**
      * A human readable representation of the chromosome is here obtained by using symengine
@@ -464,6 +559,18 @@ public:
    // }
 
 private:
+    // Past this length (in characters) the formula is not simplified by SymEngine when computing its complexity
+    static constexpr double max_prettier_length = 10000.;
+
+    // The values cached for a phenotype. An empty vector means not computed yet. The fitness is only written by
+    // fitness(), as the loss computed in gradient() and hessians() uses the differentiable surrogates of the kernels
+    // (e.g. div for pdiv) and may thus differ.
+    struct cache_entry {
+        pagmo::vector_double fitness;
+        pagmo::vector_double gradient;
+        std::vector<pagmo::vector_double> hessians;
+    };
+
     // This setter can be marked const as m_cgp is mutable
     void set_cgp(const pagmo::vector_double &x) const
     {
@@ -477,6 +584,56 @@ private:
         m_cgp.set_eph_val(eph_val);
     }
 
+    // Computes the MSE loss of m_cgp on the data. The node cache keeps the values of the nodes of the chromosome
+    // evaluated last, so that only the nodes downstream of the genes that differ from it are recomputed. Successive
+    // calls (e.g. on the mutants of a same parent) are thus much cheaper than a full evaluation. The arithmetic
+    // is that of expression::loss (without parallelism), so that the result is identical.
+    double incremental_mse() const
+    {
+        if (m_node_cache.nc.column.empty()) {
+            std::vector<double> points;
+            points.reserve(m_points.size() * m_points[0].size());
+            for (const auto &point : m_points) {
+                points.insert(points.end(), point.begin(), point.end());
+            }
+            m_cgp.init_node_cache(points.data(), static_cast<unsigned>(m_points.size()), m_node_cache.nc);
+        } else {
+            m_cgp.update_node_cache(m_node_cache.nc);
+        }
+        const auto &x = m_cgp.get();
+        auto m = m_cgp.get_m();
+        double retval = 0.;
+        for (decltype(m_points.size()) k = 0u; k < m_points.size(); ++k) {
+            double err = 0.;
+            for (auto i = 0u; i < m; ++i) {
+                auto diff = m_node_cache.nc.column[x[x.size() - m + i]][k] - m_labels[k][i];
+                err += diff * diff;
+            }
+            err /= static_cast<double>(m);
+            retval += err;
+        }
+        retval /= static_cast<unsigned>(m_points.size());
+        return retval;
+    }
+
+    // Builds the single precision copies of the inner cgp and of the data
+    void init_float() const
+    {
+        kernel_set<float> f_f;
+        for (const auto &ker : m_f) {
+            f_f.push_back(ker.get_name());
+        }
+        m_fcgp = expression<float>(m_cgp.get_n() - m_n_eph, m_cgp.get_m(), m_r, m_c, m_l, m_arity, f_f(), m_n_eph);
+        auto fdata = std::make_shared<float_data>();
+        for (const auto &point : m_points) {
+            fdata->points.emplace_back(point.begin(), point.end());
+        }
+        for (const auto &label : m_labels) {
+            fdata->labels.emplace_back(label.begin(), label.end());
+        }
+        m_fdata = std::move(fdata);
+    }
+
     void sanity_checks(unsigned &n, unsigned &m) const
     {
         // 1 - We check that points is not an empty vector.
@@ -510,6 +667,12 @@ private:
         if (m_f.size() == 0) throw std::invalid_argument("Number of basis functions is 0");
     }
 
+    // The data stored in single precision (never modified once built, hence shared by the copies of the problem)
+    struct float_data {
+        std::vector<std::vector<float>> points;
+        std::vector<std::vector<float>> labels;
+    };
+
     std::vector<std::vector<double>> m_points;
     std::vector<std::vector<double>> m_labels;
     std::vector<std::vector<audi::gdual_d>> m_dpoints;
@@ -525,14 +688,34 @@ private:
     unsigned m_n_eph;
     bool m_multi_objective;
     unsigned m_parallel_batches;
+    bool m_incremental;
     // The fact that this is mutable may hamper the performances of the bfe as the thread safetly level
     // of the UDP in pagmo will force copies of the UDP to be made in all threads. This can in principle be
     // avoided, but likely resulting in prepature optimization. (see https://github.com/darioizzo/dcgp/pull/42)
     mutable expression<double> m_cgp;
     // TODO: this should be vectorized gduals
     mutable expression<audi::gdual_d> m_dcgp;
-    mutable std::pair<pagmo::vector_double, pagmo::vector_double> m_cache_fitness;
-    mutable std::pair<pagmo::vector_double, pagmo::vector_double> m_cache_gradient;
+    // The single precision copies of m_cgp and of the data, used by float_loss and built at its first call
+    mutable expression<float> m_fcgp;
+    mutable std::shared_ptr<const float_data> m_fdata;
+    // A node cache which is not copied: the copies of the problem (e.g. those made by pagmo populations, islands and
+    // the bfe) start with an empty one, so that they are cheap and the memory is only used where fitness is called.
+    struct node_cache_holder {
+        node_cache_holder() = default;
+        node_cache_holder(const node_cache_holder &) {}
+        node_cache_holder(node_cache_holder &&) = default;
+        node_cache_holder &operator=(const node_cache_holder &)
+        {
+            nc = expression<double>::node_cache{};
+            return *this;
+        }
+        node_cache_holder &operator=(node_cache_holder &&) = default;
+        expression<double>::node_cache nc;
+    };
+    // The values of the nodes of the chromosome evaluated last, over m_points (only used when m_incremental is true)
+    mutable node_cache_holder m_node_cache;
+    // Shared among copies of the problem (e.g. those made by the bfe), it is thread-safe.
+    std::shared_ptr<phenotype_cache<cache_entry>> m_cache;
 }; // namespace dcgp
 } // namespace dcgp
 #endif
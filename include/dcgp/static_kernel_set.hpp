@@ -0,0 +1,887 @@
+#ifndef DCGP_STATIC_KERNEL_SET_H
+#define DCGP_STATIC_KERNEL_SET_H
+
+#include <algorithm>
+#include <audi/audi.hpp>
+#include <cmath>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <dcgp/config.hpp>
+#include <dcgp/kernel.hpp>
+#include <dcgp/wrapped_functions.hpp>
+
+namespace dcgp
+{
+
+namespace detail
+{
+
+// Left fold of in(first), ..., in(arity - 1)
+template <typename T, typename In, typename Op>
+inline T fold(In in, unsigned first, unsigned arity, Op op)
+{
+    T retval(in(first));
+    for (auto j = first + 1u; j < arity; ++j) {
+        op(retval, in(j));
+    }
+    return retval;
+}
+
+// Left fold of row(first), ..., row(arity - 1) over a block of b points
+template <typename T, typename Row, typename Op>
+inline void fold_block(Row row, T *res, unsigned b, unsigned first, unsigned arity, Op op)
+{
+    const T *in = row(first);
+    std::copy(in, in + b, res);
+    for (auto j = first + 1u; j < arity; ++j) {
+        in = row(j);
+        for (auto k = 0u; k < b; ++k) {
+            op(res[k], in[k]);
+        }
+    }
+}
+
+struct add_op {
+    template <typename T>
+    void operator()(T &a, const T &b) const
+    {
+        a += b;
+    }
+};
+
+struct sub_op {
+    template <typename T>
+    void operator()(T &a, const T &b) const
+    {
+        a -= b;
+    }
+};
+
+struct mul_op {
+    template <typename T>
+    void operator()(T &a, const T &b) const
+    {
+        a *= b;
+    }
+};
+
+struct div_op {
+    template <typename T>
+    void operator()(T &a, const T &b) const
+    {
+        a /= b;
+    }
+};
+
+// Kernels folding all their inputs with Op (e.g. sum)
+template <typename Op>
+struct fold_kernel {
+    template <typename T, typename In>
+    static T eval(In in, unsigned arity)
+    {
+        return fold<T>(in, 0u, arity, Op{});
+    }
+    template <typename T, typename Row>
+    static void run(Row row, T *res, unsigned b, unsigned arity)
+    {
+        fold_block(row, res, b, 0u, arity, Op{});
+    }
+};
+
+// Kernels applying F to the sum of their inputs (e.g. sig)
+template <typename F>
+struct activation_kernel {
+    template <typename T, typename In>
+    static T eval(In in, unsigned arity)
+    {
+        return F{}(fold<T>(in, 0u, arity, add_op{}));
+    }
+    template <typename T, typename Row>
+    static void run(Row row, T *res, unsigned b, unsigned arity)
+    {
+        fold_block(row, res, b, 0u, arity, add_op{});
+        for (auto k = 0u; k < b; ++k) {
+            res[k] = F{}(res[k]);
+        }
+    }
+};
+
+// Kernels applying F to their first input, discarding the others (e.g. sin)
+template <typename F>
+struct unary_kernel {
+    template <typename T, typename In>
+    static T eval(In in, unsigned)
+    {
+        return F{}(T(in(0u)));
+    }
+    template <typename T, typename Row>
+    static void run(Row row, T *res, unsigned b, unsigned)
+    {
+        const T *in = row(0u);
+        for (auto k = 0u; k < b; ++k) {
+            res[k] = F{}(in[k]);
+        }
+    }
+};
+
+// The functions below are those of wrapped_functions.hpp, written on a single value
+
+struct sig_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return T(1.) / (T(1.) + audi::exp(-x));
+    }
+};
+
+struct tanh_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return audi::tanh(x);
+    }
+};
+
+struct relu_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return (x < 0) ? T(0.) : x;
+    }
+};
+
+struct elu_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return (x < 0) ? audi::exp(x) - T(1.) : x;
+    }
+};
+
+struct isru_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return x / (audi::sqrt(1 + x * x));
+    }
+};
+
+struct sin_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        using std::sin;
+        return sin(x);
+    }
+};
+
+struct cos_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        using std::cos;
+        return cos(x);
+    }
+};
+
+struct log_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return audi::log(x);
+    }
+};
+
+struct exp_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return audi::exp(x);
+    }
+};
+
+struct gaussian_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return audi::exp(-x * x);
+    }
+};
+
+struct sqrt_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return audi::sqrt(x);
+    }
+};
+
+// The approximate functions of wrapped_functions.hpp
+
+struct sig_fast_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return my_sig_fast_unary<T>(x);
+    }
+};
+
+struct tanh_fast_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return my_tanh_fast_unary<T>(x);
+    }
+};
+
+struct exp_fast_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return my_exp_fast_unary<T>(x);
+    }
+};
+
+struct gaussian_fast_f {
+    template <typename T>
+    T operator()(const T &x) const
+    {
+        return my_gaussian_fast_unary<T>(x);
+    }
+};
+
+} // namespace detail
+
+// Defined below
+template <typename T, typename Row>
+inline bool run_builtin_kernel(kernel_opcode op, Row row, T *res, unsigned b, unsigned arity);
+
+/// Batched entry point of a built-in kernel
+/**
+ * Returns the batched entry point (see dcgp::kernel) of the built-in kernel with a given opcode, which runs the
+ * vectorized loops of run_builtin_kernel() and falls back to calling \p f point by point where there are none
+ * (pdiv with less than two inputs).
+ *
+ * @param[in] op the kernel opcode.
+ * @param[in] f the kernel function.
+ *
+ * @return the batched entry point, or an empty function if \p T is not a floating point type.
+ */
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline typename kernel<T>::my_batch_fun_type builtin_batch_kernel(kernel_opcode op,
+                                                                  typename kernel<T>::my_fun_type f)
+{
+    return [op, f](const std::vector<const T *> &in, T *out, unsigned b) {
+        const auto arity = static_cast<unsigned>(in.size());
+        if (!run_builtin_kernel(op, [&in](unsigned j) { return in[j]; }, out, b, arity)) {
+            std::vector<T> point(arity);
+            for (auto k = 0u; k < b; ++k) {
+                for (auto j = 0u; j < arity; ++j) {
+                    point[j] = in[j][k];
+                }
+                out[k] = f(point);
+            }
+        }
+    };
+}
+
+// Only floating point types have vectorized kernels
+template <typename T, typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
+inline typename kernel<T>::my_batch_fun_type builtin_batch_kernel(kernel_opcode, typename kernel<T>::my_fun_type)
+{
+    return nullptr;
+}
+
+/// Static kernels
+/**
+ * Each of the following types describes, at compile time, one of the kernels of dcgp::kernel_set and can be used as
+ * a template argument of dcgp::static_kernel_set. They provide:
+ *
+ * - name(): the kernel name (as in dcgp::kernel_set).
+ * - get<T>(): the corresponding dcgp::kernel<T> (tagged with its dcgp::kernel_opcode).
+ * - eval<T>(in, arity): the kernel value on in(0), ..., in(arity - 1), where in is any callable returning the inputs.
+ * - run<T>(row, res, b, arity): the kernel values over b points, row(j) pointing to the b values of the input j.
+ *
+ * User defined types providing the same static members can be used as well.
+ */
+struct sum_kernel : detail::fold_kernel<detail::add_op> {
+    static std::string name()
+    {
+        return "sum";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_sum<T>, print_my_sum, name(), my_sum_unary<T>, my_sum_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::sum, my_sum<T>), kernel_opcode::sum);
+    }
+};
+
+/// Static diff kernel (see dcgp::sum_kernel)
+struct diff_kernel : detail::fold_kernel<detail::sub_op> {
+    static std::string name()
+    {
+        return "diff";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_diff<T>, print_my_diff, name(), my_diff_unary<T>, my_diff_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::diff, my_diff<T>), kernel_opcode::diff);
+    }
+};
+
+/// Static mul kernel (see dcgp::sum_kernel)
+struct mul_kernel : detail::fold_kernel<detail::mul_op> {
+    static std::string name()
+    {
+        return "mul";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_mul<T>, print_my_mul, name(), my_mul_unary<T>, my_mul_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::mul, my_mul<T>), kernel_opcode::mul);
+    }
+};
+
+/// Static div kernel (see dcgp::sum_kernel)
+struct div_kernel : detail::fold_kernel<detail::div_op> {
+    static std::string name()
+    {
+        return "div";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_div<T>, print_my_div, name(), my_div_unary<T>, my_div_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::div, my_div<T>), kernel_opcode::div);
+    }
+};
+
+/// Static pdiv kernel (see dcgp::sum_kernel)
+struct pdiv_kernel {
+    static std::string name()
+    {
+        return "pdiv";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_pdiv<T>, print_my_pdiv, name(), nullptr, my_pdiv_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::pdiv, my_pdiv<T>), kernel_opcode::pdiv);
+    }
+    template <typename T, typename In>
+    static T eval(In in, unsigned arity)
+    {
+        // As in my_pdiv, the first input is divided by the product of all the others
+        T retval = in(0u) / detail::fold<T>(in, 1u, arity, detail::mul_op{});
+        return std::isfinite(retval) ? retval : T(1.);
+    }
+    template <typename T, typename Row>
+    static void run(Row row, T *res, unsigned b, unsigned arity)
+    {
+        detail::fold_block(row, res, b, 1u, arity, detail::mul_op{});
+        const T *first = row(0u);
+        for (auto k = 0u; k < b; ++k) {
+            res[k] = first[k] / res[k];
+            res[k] = std::isfinite(res[k]) ? res[k] : T(1.);
+        }
+    }
+};
+
+/// Static sig kernel (see dcgp::sum_kernel)
+struct sig_kernel : detail::activation_kernel<detail::sig_f> {
+    static std::string name()
+    {
+        return "sig";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_sig<T>, print_my_sig, name(), my_sig_unary<T>, my_sig_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::sig, my_sig<T>), kernel_opcode::sig);
+    }
+};
+
+/// Static tanh kernel (see dcgp::sum_kernel)
+struct tanh_kernel : detail::activation_kernel<detail::tanh_f> {
+    static std::string name()
+    {
+        return "tanh";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_tanh<T>, print_my_tanh, name(), my_tanh_unary<T>, my_tanh_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::tanh, my_tanh<T>), kernel_opcode::tanh);
+    }
+};
+
+/// Static ReLu kernel (see dcgp::sum_kernel)
+struct relu_kernel : detail::activation_kernel<detail::relu_f> {
+    static std::string name()
+    {
+        return "ReLu";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_relu<T>, print_my_relu, name(), my_relu_unary<T>, my_relu_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::relu, my_relu<T>), kernel_opcode::relu);
+    }
+};
+
+/// Static ELU kernel (see dcgp::sum_kernel)
+struct elu_kernel : detail::activation_kernel<detail::elu_f> {
+    static std::string name()
+    {
+        return "ELU";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_elu<T>, print_my_elu, name(), my_elu_unary<T>, my_elu_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::elu, my_elu<T>), kernel_opcode::elu);
+    }
+};
+
+/// Static ISRU kernel (see dcgp::sum_kernel)
+struct isru_kernel : detail::activation_kernel<detail::isru_f> {
+    static std::string name()
+    {
+        return "ISRU";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_isru<T>, print_my_isru, name(), my_isru_unary<T>, my_isru_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::isru, my_isru<T>), kernel_opcode::isru);
+    }
+};
+
+/// Static sin kernel (see dcgp::sum_kernel)
+struct sin_kernel : detail::unary_kernel<detail::sin_f> {
+    static std::string name()
+    {
+        return "sin";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_sin<T>, print_my_sin, name(), my_sin_unary<T>, my_sin_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::sin, my_sin<T>), kernel_opcode::sin);
+    }
+};
+
+/// Static cos kernel (see dcgp::sum_kernel)
+struct cos_kernel : detail::unary_kernel<detail::cos_f> {
+    static std::string name()
+    {
+        return "cos";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_cos<T>, print_my_cos, name(), my_cos_unary<T>, my_cos_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::cos, my_cos<T>), kernel_opcode::cos);
+    }
+};
+
+/// Static log kernel (see dcgp::sum_kernel)
+struct log_kernel : detail::unary_kernel<detail::log_f> {
+    static std::string name()
+    {
+        return "log";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_log<T>, print_my_log, name(), my_log_unary<T>, my_log_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::log, my_log<T>), kernel_opcode::log);
+    }
+};
+
+/// Static exp kernel (see dcgp::sum_kernel)
+struct exp_kernel : detail::unary_kernel<detail::exp_f> {
+    static std::string name()
+    {
+        return "exp";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_exp<T>, print_my_exp, name(), my_exp_unary<T>, my_exp_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::exp, my_exp<T>), kernel_opcode::exp);
+    }
+};
+
+/// Static gaussian kernel (see dcgp::sum_kernel)
+struct gaussian_kernel : detail::unary_kernel<detail::gaussian_f> {
+    static std::string name()
+    {
+        return "gaussian";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_gaussian<T>, print_my_gaussian, name(), my_gaussian_unary<T>, my_gaussian_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::gaussian, my_gaussian<T>), kernel_opcode::gaussian);
+    }
+};
+
+/// Static sqrt kernel (see dcgp::sum_kernel)
+struct sqrt_kernel : detail::unary_kernel<detail::sqrt_f> {
+    static std::string name()
+    {
+        return "sqrt";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_sqrt<T>, print_my_sqrt, name(), my_sqrt_unary<T>, my_sqrt_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::sqrt, my_sqrt<T>), kernel_opcode::sqrt);
+    }
+};
+
+/// Static approximate sig kernel (see dcgp::sum_kernel and dcgp::my_sig_fast)
+struct sig_fast_kernel : detail::activation_kernel<detail::sig_fast_f> {
+    static std::string name()
+    {
+        return "sig_fast";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_sig_fast<T>, print_my_sig, name(), my_sig_fast_unary<T>, my_sig_fast_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::sig_fast, my_sig_fast<T>), kernel_opcode::sig_fast);
+    }
+};
+
+/// Static approximate tanh kernel (see dcgp::sum_kernel and dcgp::my_tanh_fast)
+struct tanh_fast_kernel : detail::activation_kernel<detail::tanh_fast_f> {
+    static std::string name()
+    {
+        return "tanh_fast";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_tanh_fast<T>, print_my_tanh, name(), my_tanh_fast_unary<T>, my_tanh_fast_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::tanh_fast, my_tanh_fast<T>),
+                         kernel_opcode::tanh_fast);
+    }
+};
+
+/// Static approximate exp kernel (see dcgp::sum_kernel and dcgp::my_exp_fast)
+struct exp_fast_kernel : detail::unary_kernel<detail::exp_fast_f> {
+    static std::string name()
+    {
+        return "exp_fast";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_exp_fast<T>, print_my_exp, name(), my_exp_fast_unary<T>, my_exp_fast_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::exp_fast, my_exp_fast<T>), kernel_opcode::exp_fast);
+    }
+};
+
+/// Static approximate gaussian kernel (see dcgp::sum_kernel and dcgp::my_gaussian_fast)
+struct gaussian_fast_kernel : detail::unary_kernel<detail::gaussian_fast_f> {
+    static std::string name()
+    {
+        return "gaussian_fast";
+    }
+    template <typename T>
+    static kernel<T> get()
+    {
+        return kernel<T>(my_gaussian_fast<T>, print_my_gaussian, name(), my_gaussian_fast_unary<T>,
+                         my_gaussian_fast_binary<T>,
+                         builtin_batch_kernel<T>(kernel_opcode::gaussian_fast, my_gaussian_fast<T>),
+                         kernel_opcode::gaussian_fast);
+    }
+};
+
+/// Calls a built-in kernel
+/**
+ * Calls the built-in kernel with a given opcode on in(0), ..., in(arity - 1), selecting it with a switch rather than
+ * going through an std::function.
+ *
+ * @param[in] op the kernel opcode.
+ * @param[in] in a callable returning the inputs.
+ * @param[in] arity the number of inputs.
+ * @param[out] retval the kernel value.
+ *
+ * @return false if \p op is dcgp::kernel_opcode::custom (or if pdiv has less than two inputs), in which case
+ * \p retval is untouched, true otherwise.
+ */
+template <typename T, typename In>
+inline bool call_builtin_kernel(kernel_opcode op, In in, unsigned arity, T &retval)
+{
+    switch (op) {
+        case kernel_opcode::sum:
+            retval = sum_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::diff:
+            retval = diff_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::mul:
+            retval = mul_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::div:
+            retval = div_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::pdiv:
+            // my_pdiv requires two inputs at least
+            if (arity < 2u) {
+                return false;
+            }
+            retval = pdiv_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::sig:
+            retval = sig_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::tanh:
+            retval = tanh_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::relu:
+            retval = relu_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::elu:
+            retval = elu_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::isru:
+            retval = isru_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::sin:
+            retval = sin_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::cos:
+            retval = cos_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::log:
+            retval = log_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::exp:
+            retval = exp_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::gaussian:
+            retval = gaussian_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::sqrt:
+            retval = sqrt_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::sig_fast:
+            retval = sig_fast_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::tanh_fast:
+            retval = tanh_fast_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::exp_fast:
+            retval = exp_fast_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::gaussian_fast:
+            retval = gaussian_fast_kernel::eval<T>(in, arity);
+            return true;
+        case kernel_opcode::custom:
+            break;
+    }
+    return false;
+}
+
+/// Calls a built-in kernel over a number of points
+/**
+ * Calls the built-in kernel with a given opcode over b points, selecting it with a switch rather than going
+ * through an std::function.
+ *
+ * @param[in] op the kernel opcode.
+ * @param[in] row a callable returning, for each input j, a pointer to its b values.
+ * @param[out] res pointer to where the b kernel values will be written.
+ * @param[in] b number of points.
+ * @param[in] arity the number of inputs.
+ *
+ * @return false if \p op is dcgp::kernel_opcode::custom (or if pdiv has less than two inputs), in which case
+ * nothing is written, true otherwise.
+ */
+template <typename T, typename Row>
+inline bool run_builtin_kernel(kernel_opcode op, Row row, T *res, unsigned b, unsigned arity)
+{
+    switch (op) {
+        case kernel_opcode::sum:
+            sum_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::diff:
+            diff_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::mul:
+            mul_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::div:
+            div_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::pdiv:
+            if (arity < 2u) {
+                return false;
+            }
+            pdiv_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::sig:
+            sig_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::tanh:
+            tanh_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::relu:
+            relu_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::elu:
+            elu_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::isru:
+            isru_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::sin:
+            sin_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::cos:
+            cos_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::log:
+            log_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::exp:
+            exp_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::gaussian:
+            gaussian_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::sqrt:
+            sqrt_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::sig_fast:
+            sig_fast_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::tanh_fast:
+            tanh_fast_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::exp_fast:
+            exp_fast_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::gaussian_fast:
+            gaussian_fast_kernel::run<T>(row, res, b, arity);
+            return true;
+        case kernel_opcode::custom:
+            break;
+    }
+    return false;
+}
+
+/// Compile-time function set
+/**
+ * The counterpart of dcgp::kernel_set for a set of kernels known at compile time, such as dcgp::sum_kernel,
+ * dcgp::mul_kernel, etc. Its parenthesis operator returns the std::vector<kernel<T>> needed to construct a
+ * dcgp::expression<T>, while its static methods call the kernel with a given id (its position in \p Kernels)
+ * without going through an std::function, so that the kernel bodies can be inlined. It is used by
+ * dcgp::expression_static.
+ *
+ * @tparam T The type of the functions output (and inputs)
+ * @tparam Kernels The kernels
+ */
+template <typename T, typename... Kernels>
+class static_kernel_set
+{
+    static_assert(sizeof...(Kernels) > 0u, "A static kernel set cannot be empty");
+
+public:
+    /// Overloaded function call operator
+    /**
+     * Returns the std::vector containing the kernels
+     */
+    std::vector<dcgp::kernel<T>> operator()() const
+    {
+        return {Kernels::template get<T>()...};
+    }
+
+    /// Number of kernels
+    static constexpr unsigned size()
+    {
+        return sizeof...(Kernels);
+    }
+
+    /// Calls a kernel
+    /**
+     * Calls the kernel with a given id on in(0), ..., in(arity - 1).
+     *
+     * @param[in] id the kernel id (its position in the set). Must be smaller than static_kernel_set::size().
+     * @param[in] in a callable returning the inputs.
+     * @param[in] arity the number of inputs.
+     *
+     * @return the kernel value.
+     */
+    template <typename In>
+    static T call(unsigned id, In in, unsigned arity)
+    {
+        return call_impl<0u>(id, in, arity);
+    }
+
+    /// Calls a kernel over a number of points
+    /**
+     * Calls the kernel with a given id over b points.
+     *
+     * @param[in] id the kernel id (its position in the set). Must be smaller than static_kernel_set::size().
+     * @param[in] row a callable returning, for each input j, a pointer to its b values.
+     * @param[out] res pointer to where the b kernel values will be written.
+     * @param[in] b number of points.
+     * @param[in] arity the number of inputs.
+     */
+    template <typename Row>
+    static void run(unsigned id, Row row, T *res, unsigned b, unsigned arity)
+    {
+        run_impl<0u>(id, row, res, b, arity);
+    }
+
+private:
+    template <unsigned I>
+    using kernel_type = typename std::tuple_element<I, std::tuple<Kernels...>>::type;
+
+    // The id is compared to each kernel index in turn, which compilers turn into a jump table
+    template <unsigned I, typename In, typename std::enable_if<(I + 1u < sizeof...(Kernels)), int>::type = 0>
+    static T call_impl(unsigned id, In in, unsigned arity)
+    {
+        if (id == I) {
+            return kernel_type<I>::template eval<T>(in, arity);
+        }
+        return call_impl<I + 1u>(id, in, arity);
+    }
+
+    // The last kernel needs no comparison
+    template <unsigned I, typename In, typename std::enable_if<(I + 1u == sizeof...(Kernels)), int>::type = 0>
+    static T call_impl(unsigned, In in, unsigned arity)
+    {
+        return kernel_type<I>::template eval<T>(in, arity);
+    }
+
+    template <unsigned I, typename Row, typename std::enable_if<(I + 1u < sizeof...(Kernels)), int>::type = 0>
+    static void run_impl(unsigned id, Row row, T *res, unsigned b, unsigned arity)
+    {
+        if (id == I) {
+            kernel_type<I>::template run<T>(row, res, b, arity);
+        } else {
+            run_impl<I + 1u>(id, row, res, b, arity);
+        }
+    }
+
+    template <unsigned I, typename Row, typename std::enable_if<(I + 1u == sizeof...(Kernels)), int>::type = 0>
+    static void run_impl(unsigned, Row row, T *res, unsigned b, unsigned arity)
+    {
+        kernel_type<I>::template run<T>(row, res, b, arity);
+    }
+};
+
+} // end of namespace dcgp
+
+#endif // DCGP_STATIC_KERNEL_SET_H
@@ -4,6 +4,9 @@
 #include <audi/audi.hpp>
 #include <audi/functions.hpp>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -16,9 +19,10 @@ namespace dcgp
 
 // SFINAE dust (to hide under the carpet). Its used to enable the templated
 // version of the various functions that can construct a kernel object. Only for
-// double and a gdual type Complex could also be allowed.
+// double, float and a gdual type Complex could also be allowed.
 template <typename T>
-using f_enabler = typename std::enable_if<std::is_same<T, double>::value || is_gdual<T>::value, int>::type;
+using f_enabler = typename std::enable_if<
+    std::is_same<T, double>::value || std::is_same<T, float>::value || is_gdual<T>::value, int>::type;
 
 /*--------------------------------------------------------------------------
  *                              N-ARITY FUNCTIONS
@@ -81,8 +85,8 @@ inline std::string print_my_div(const std::vector<std::string> &in)
     return "(" + retval + ")";
 }
 
-// Protected divide function (double overload):
-template <typename T, typename std::enable_if<std::is_same<T, double>::value, int>::type = 0>
+// Protected divide function (double and float overload):
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
 inline T my_pdiv(const std::vector<T> &in)
 {
     T retval(in[0]);
@@ -98,12 +102,12 @@ inline T my_pdiv(const std::vector<T> &in)
         return retval;
     }
 
-    return 1.;
+    return T(1.);
 }
 
 // Protected divide function (gdual overload):
 // this will throw a compiler error when used.
-// The pdiv is only available as a double type, for use in CGP.
+// The pdiv is only available as a double (or float) type, for use in CGP.
 // Because the gradients created when using gdual are mathematically invalid.
 template <typename T, typename std::enable_if<is_gdual<T>::value, int>::type = 0>
 inline T my_pdiv(const std::vector<T> &)
@@ -133,7 +137,7 @@ inline T my_sig(const std::vector<T> &in)
     for (auto i = 1u; i < in.size(); ++i) {
         retval += in[i];
     }
-    return 1. / (1. + audi::exp(-retval));
+    return T(1.) / (T(1.) + audi::exp(-retval));
 }
 
 inline std::string print_my_sig(const std::vector<std::string> &in)
@@ -165,8 +169,8 @@ inline std::string print_my_tanh(const std::vector<std::string> &in)
     return "tanh(" + retval + ")";
 }
 
-// ReLu function (double overload):
-template <typename T, typename std::enable_if<std::is_same<T, double>::value, int>::type = 0>
+// ReLu function (double and float overload):
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
 inline T my_relu(const std::vector<T> &in)
 {
     T retval(in[0]);
@@ -198,8 +202,8 @@ inline std::string print_my_relu(const std::vector<std::string> &in)
     return "ReLu(" + retval + ")";
 }
 
-// Exponential linear unit (ELU) function (double overload):
-template <typename T, typename std::enable_if<std::is_same<T, double>::value, int>::type = 0>
+// Exponential linear unit (ELU) function (double and float overload):
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
 inline T my_elu(const std::vector<T> &in)
 {
     T retval(in[0]);
@@ -277,6 +281,7 @@ inline std::string print_my_sum(const std::vector<std::string> &in)
 template <typename T, f_enabler<T> = 0>
 inline T my_sin(const std::vector<T> &in)
 {
+    using std::sin;
     return sin(in[0]);
 }
 
@@ -289,6 +294,7 @@ inline std::string print_my_sin(const std::vector<std::string> &in)
 template <typename T, f_enabler<T> = 0>
 inline T my_cos(const std::vector<T> &in)
 {
+    using std::cos;
     return cos(in[0]);
 }
 
@@ -348,6 +354,378 @@ inline std::string print_my_sqrt(const std::vector<std::string> &in)
     return "sqrt(" + in[0] + ")";
 }
 
+/*--------------------------------------------------------------------------
+ *                            FIXED-ARITY FUNCTIONS
+ *------------------------------------------------------------------------**/
+// The functions above called on one (unary) or two (binary) inputs, which are passed by reference rather than in an
+// std::vector. They are the fixed-arity entry points of the kernels of dcgp::kernel_set and return the same values.
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sum_unary(const T &a)
+{
+    return a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sum_binary(const T &a, const T &b)
+{
+    return a + b;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_diff_unary(const T &a)
+{
+    return a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_diff_binary(const T &a, const T &b)
+{
+    return a - b;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_mul_unary(const T &a)
+{
+    return a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_mul_binary(const T &a, const T &b)
+{
+    return a * b;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_div_unary(const T &a)
+{
+    return a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_div_binary(const T &a, const T &b)
+{
+    return a / b;
+}
+
+// Protected divide function (double and float overload). There is no unary version, as my_pdiv requires two
+// inputs at least.
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_pdiv_binary(const T &a, const T &b)
+{
+    T retval(a / b);
+    if (std::isfinite(retval)) {
+        return retval;
+    }
+    return T(1.);
+}
+
+// Protected divide function (gdual overload), see my_pdiv.
+template <typename T, typename std::enable_if<is_gdual<T>::value, int>::type = 0>
+inline T my_pdiv_binary(const T &, const T &)
+{
+    throw std::invalid_argument("The protected division is not supported for gdual types.");
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sig_unary(const T &a)
+{
+    return T(1.) / (T(1.) + audi::exp(-a));
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sig_binary(const T &a, const T &b)
+{
+    return my_sig_unary<T>(a + b);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_tanh_unary(const T &a)
+{
+    return audi::tanh(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_tanh_binary(const T &a, const T &b)
+{
+    return my_tanh_unary<T>(a + b);
+}
+
+// ReLu function (double and float overload):
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_relu_unary(const T &a)
+{
+    return (a < 0) ? T(0.) : a;
+}
+
+// ReLu function (gdual overload):
+template <typename T, typename std::enable_if<is_gdual<T>::value, int>::type = 0>
+inline T my_relu_unary(const T &a)
+{
+    return (a.constant_cf() < T(0.).constant_cf()) ? T(0.) : a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_relu_binary(const T &a, const T &b)
+{
+    return my_relu_unary<T>(a + b);
+}
+
+// Exponential linear unit (ELU) function (double and float overload):
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_elu_unary(const T &a)
+{
+    return (a < 0) ? audi::exp(a) - T(1.) : a;
+}
+
+// Exponential linear unit (ELU) function (gdual overload):
+template <typename T, typename std::enable_if<is_gdual<T>::value, int>::type = 0>
+inline T my_elu_unary(const T &a)
+{
+    return (a.constant_cf() < T(0.).constant_cf()) ? audi::exp(a) - T(1.) : a;
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_elu_binary(const T &a, const T &b)
+{
+    return my_elu_unary<T>(a + b);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_isru_unary(const T &a)
+{
+    return a / (audi::sqrt(1 + a * a));
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_isru_binary(const T &a, const T &b)
+{
+    return my_isru_unary<T>(a + b);
+}
+
+// The unary functions discard their second input
+template <typename T, f_enabler<T> = 0>
+inline T my_sin_unary(const T &a)
+{
+    using std::sin;
+    return sin(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sin_binary(const T &a, const T &)
+{
+    return my_sin_unary<T>(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_cos_unary(const T &a)
+{
+    using std::cos;
+    return cos(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_cos_binary(const T &a, const T &)
+{
+    return my_cos_unary<T>(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_log_unary(const T &a)
+{
+    return audi::log(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_log_binary(const T &a, const T &)
+{
+    return my_log_unary<T>(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_exp_unary(const T &a)
+{
+    return audi::exp(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_exp_binary(const T &a, const T &)
+{
+    return my_exp_unary<T>(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_gaussian_unary(const T &a)
+{
+    return audi::exp(-a * a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_gaussian_binary(const T &a, const T &)
+{
+    return my_gaussian_unary<T>(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sqrt_unary(const T &a)
+{
+    return audi::sqrt(a);
+}
+
+template <typename T, f_enabler<T> = 0>
+inline T my_sqrt_binary(const T &a, const T &)
+{
+    return my_sqrt_unary<T>(a);
+}
+
+
+/*--------------------------------------------------------------------------
+ *                           APPROXIMATE FUNCTIONS
+ *------------------------------------------------------------------------**/
+// Faster versions of exp, gaussian, sig and tanh, computed in double without calls to libm. Their selections only
+// pick precomputed values, so that the loops applying them to a block of points are vectorized (when compiling for
+// AVX2 or later, e.g. with -march=native). They are only available for double and float, and their relative error,
+// before the final rounding to T, is below 1e-8 (3e-8 for tanh). Results below the smallest normal double lose
+// their relative accuracy gradually, as for any subnormal number.
+
+namespace detail
+{
+
+// exp(x) for double. The argument is reduced as x = n ln2 + r, with |r| <= ln2 / 2, e^r is computed with its Taylor
+// polynomial of degree 7 (whose relative error is below 7.3e-9) and 2^n is built from its bits, as the product of two
+// powers of two so that overflows and underflows happen in the last multiplication.
+inline double fast_exp(double x)
+{
+    // Beyond these bounds the result is +inf or 0 anyway. NaNs go through and propagate to the result
+    double xc = (x < -746.) ? -746. : x;
+    xc = (xc > 710.) ? 710. : xc;
+    // n = round(x / ln2), adding and subtracting 1.5 * 2^52 (t then holds n in its lowest bits)
+    const double shifter = 6755399441055744.;
+    const double t = xc * 1.4426950408889634 + shifter;
+    const double n = t - shifter;
+    // ln2 is split in two parts, the first one having enough trailing zeros for n * ln2_hi to be exact
+    const double r = (xc - n * 6.93147180369123816490e-01) - n * 1.90821492927058770002e-10;
+    double p = 1. / 5040.;
+    p = p * r + 1. / 720.;
+    p = p * r + 1. / 120.;
+    p = p * r + 1. / 24.;
+    p = p * r + 1. / 6.;
+    p = p * r + 1. / 2.;
+    p = p * r + 1.;
+    p = p * r + 1.;
+    // 2^n = 2^n1 * 2^(n - n1), with n1 = floor(n / 2). n and n1 are offset by 2048 and 1024, so that only unsigned
+    // operations are needed
+    std::uint64_t bits;
+    std::memcpy(&bits, &t, sizeof(double));
+    const std::uint64_t n_off = bits - 0x4338000000000000ULL + 2048u;
+    const std::uint64_t n1_off = n_off >> 1;
+    const std::uint64_t bits1 = (n1_off - 1u) << 52, bits2 = (n_off - n1_off - 1u) << 52;
+    double scale1, scale2;
+    std::memcpy(&scale1, &bits1, sizeof(double));
+    std::memcpy(&scale2, &bits2, sizeof(double));
+    return p * scale1 * scale2;
+}
+
+// tanh(x) for double, as 1 - 2 / (e^2x + 1). Close to zero, where this would lose its relative accuracy, the Taylor
+// polynomial of degree 9 is used instead. Both are computed and blended, the polynomial on an argument clamped so
+// that it stays finite.
+inline double fast_tanh(double x)
+{
+    const double x2 = x * x;
+    const double xs = (x2 < 1.) ? x : 0.;
+    const double xs2 = xs * xs;
+    const double small = xs + xs * xs2 * (-1. / 3. + xs2 * (2. / 15. + xs2 * (-17. / 315. + xs2 * (62. / 2835.))));
+    const double large = 1. - 2. / (fast_exp(2. * x) + 1.);
+    const double w = (x2 < 0.015625) ? 1. : 0.;
+    return large + w * (small - large);
+}
+
+} // namespace detail
+
+// exponential (unary, approximate)
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_exp_fast(const std::vector<T> &in)
+{
+    return static_cast<T>(detail::fast_exp(in[0]));
+}
+
+// gaussian (unary, approximate)
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_gaussian_fast(const std::vector<T> &in)
+{
+    return static_cast<T>(detail::fast_exp(-static_cast<double>(in[0]) * in[0]));
+}
+
+// sigmoid function (approximate)
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_sig_fast_unary(const T &a)
+{
+    return static_cast<T>(1. / (1. + detail::fast_exp(-static_cast<double>(a))));
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_sig_fast(const std::vector<T> &in)
+{
+    T retval(in[0]);
+    for (auto i = 1u; i < in.size(); ++i) {
+        retval += in[i];
+    }
+    return my_sig_fast_unary<T>(retval);
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_sig_fast_binary(const T &a, const T &b)
+{
+    return my_sig_fast_unary<T>(a + b);
+}
+
+// tanh function (approximate)
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_tanh_fast_unary(const T &a)
+{
+    return static_cast<T>(detail::fast_tanh(a));
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_tanh_fast(const std::vector<T> &in)
+{
+    T retval(in[0]);
+    for (auto i = 1u; i < in.size(); ++i) {
+        retval += in[i];
+    }
+    return my_tanh_fast_unary<T>(retval);
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_tanh_fast_binary(const T &a, const T &b)
+{
+    return my_tanh_fast_unary<T>(a + b);
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_exp_fast_unary(const T &a)
+{
+    return static_cast<T>(detail::fast_exp(a));
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_exp_fast_binary(const T &a, const T &)
+{
+    return my_exp_fast_unary<T>(a);
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_gaussian_fast_unary(const T &a)
+{
+    return static_cast<T>(detail::fast_exp(-static_cast<double>(a) * a));
+}
+
+template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+inline T my_gaussian_fast_binary(const T &a, const T &)
+{
+    return my_gaussian_fast_unary<T>(a);
+}
+
 } // namespace dcgp
 
 #endif // DCGP_WRAPPED_FUNCTIONS_H
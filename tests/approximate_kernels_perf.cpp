@@ -0,0 +1,88 @@
+#define BOOST_TEST_MODULE dcgp_approximate_kernels_perf
+#include <algorithm>
+#include <audi/audi.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/timer/timer.hpp>
+#include <iostream>
+#include <random>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_ann.hpp>
+#include <dcgp/kernel_set.hpp>
+
+void perform_evaluations(unsigned int in, unsigned int out, unsigned int rows, unsigned int columns,
+                         unsigned int levels_back, unsigned int arity, unsigned int N,
+                         std::vector<dcgp::kernel<double>> kernel_set)
+{
+    // Random numbers engine
+    std::default_random_engine re(123);
+    // Instatiate the expression
+    dcgp::expression<double> ex(in, out, rows, columns, levels_back, arity, kernel_set, 0u, 123u);
+    // We create the input data upfront and we do not time it (a column-major in x N matrix).
+    std::vector<double> points(in * N);
+    for (auto &item : points) {
+        item = std::uniform_real_distribution<double>(-1, 1)(re);
+    }
+    std::vector<double> outputs(out * N);
+    dcgp::expression<double>::workspace ws;
+
+    std::cout << "Performing " << N << " batch evaluations, in:" << in << " out:" << out << " rows:" << rows
+              << " columns:" << columns << ": ";
+    {
+        boost::timer::auto_cpu_timer t;
+        ex.evaluate_batch(points.data(), outputs.data(), N, ws);
+    }
+}
+
+void perform_sgd(unsigned int rows, unsigned int columns, unsigned int levels_back, const std::vector<unsigned> &arity,
+                 unsigned int N, unsigned bs, std::vector<dcgp::kernel<double>> kernel_set)
+{
+    // Dimensions in and out are fixed
+    unsigned in = 3u;
+    unsigned out = 2u;
+    // Random numbers
+    std::mt19937 gen{123u};
+    std::normal_distribution<> norm(0., 1.);
+
+    // Instatiate the expression
+    dcgp::expression_ann<double> ex(in, out, rows, columns, levels_back, arity, kernel_set, 123);
+    // We create the input data upfront and we do not time it.
+    ex.randomise_weights(0., 1., 123u);
+    ex.randomise_biases(0., 1., 123u);
+    std::vector<std::vector<double>> data(N, std::vector<double>(in, 0.));
+    std::vector<std::vector<double>> label(N, std::vector<double>(out, 0.));
+    for (auto &item : data) {
+        std::generate(item.begin(), item.end(), [&norm, &gen]() { return norm(gen); });
+    }
+    for (auto i = 0u; i < label.size(); ++i) {
+        label[i][0] = 1. / 5. * std::cos(data[i][0] + data[i][1] + data[i][2]) - data[i][0] * data[i][1];
+        label[i][1] = data[i][0] * data[i][1] * data[i][2];
+    }
+
+    std::cout << "One epoch of sgd:  rows:" << rows << " columns:" << columns << ": ";
+    {
+        boost::timer::auto_cpu_timer t;
+        ex.sgd(data, label, 0.01, bs, "MSE", 0u);
+    }
+}
+
+/// This test is passed whenever it completes. It compares the exact kernels with their approximations
+BOOST_AUTO_TEST_CASE(approximate_kernels_speed)
+{
+    unsigned int N = 100000;
+    dcgp::kernel_set<double> exact({"sum", "mul", "sig", "tanh", "exp", "gaussian"});
+    dcgp::kernel_set<double> fast({"sum", "mul", "sig_fast", "tanh_fast", "exp_fast", "gaussian_fast"});
+    for (const auto &set : {exact, fast}) {
+        audi::print("Function set ", set(), "\n");
+        perform_evaluations(2, 4, 10, 10, 11, 2, N, set());
+        perform_evaluations(1, 1, 3, 100, 101, 3, N, set());
+    }
+
+    dcgp::kernel_set<double> exact_ann({"sig", "tanh"});
+    dcgp::kernel_set<double> fast_ann({"sig_fast", "tanh_fast"});
+    for (const auto &set : {exact_ann, fast_ann}) {
+        audi::print("\nFunction set ", set(), "\n");
+        perform_sgd(50, 3, 1, {3, 50, 20}, 8192u, 32u, set());
+        perform_sgd(10, 10, 1, std::vector<unsigned>(10, 10), 8192u, 32u, set());
+    }
+}
@@ -0,0 +1,85 @@
+#define BOOST_TEST_MODULE dcgp_batch_evaluation_perf
+#include <audi/audi.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/timer/timer.hpp>
+#include <iostream>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/kernel_set.hpp>
+
+void perform_evaluations(unsigned int in, unsigned int out, unsigned int rows, unsigned int columns,
+                         unsigned int levels_back, unsigned int arity, unsigned int N,
+                         std::vector<dcgp::kernel<double>> kernel_set)
+{
+    // Random numbers engine
+    std::default_random_engine re(123);
+    // Instatiate the expression
+    dcgp::expression<double> ex(in, out, rows, columns, levels_back, arity, kernel_set, 0u, 123u);
+    // We create the input data upfront and we do not time it (a column-major in x N matrix).
+    std::vector<double> points(in * N);
+    for (auto &item : points) {
+        item = std::uniform_real_distribution<double>(-1, 1)(re);
+    }
+    std::vector<double> outputs(out * N);
+    dcgp::expression<double>::workspace ws;
+
+    std::cout << "Performing " << N << " evaluations, in:" << in << " out:" << out << " rows:" << rows
+              << " columns:" << columns << std::endl;
+    std::cout << "Point by point: ";
+    {
+        boost::timer::auto_cpu_timer t;
+        for (auto i = 0u; i < N; ++i) {
+            ex.evaluate(points.data() + i * in, outputs.data() + i * out, ws);
+        }
+    }
+    std::cout << "Batch: ";
+    {
+        boost::timer::auto_cpu_timer t;
+        ex.evaluate_batch(points.data(), outputs.data(), N, ws);
+    }
+    // Ten mutants of ex, as generated by an evolutionary strategy
+    std::vector<dcgp::expression<double>> mutants(10u, ex);
+    for (auto &mutant : mutants) {
+        mutant.mutate_active(2u);
+    }
+    std::cout << "Ten mutants, batch: ";
+    {
+        boost::timer::auto_cpu_timer t;
+        for (const auto &mutant : mutants) {
+            mutant.evaluate_batch(points.data(), outputs.data(), N, ws);
+        }
+    }
+    std::cout << "Ten mutants, incremental: ";
+    {
+        boost::timer::auto_cpu_timer t;
+        dcgp::expression<double>::node_cache nc;
+        ex.init_node_cache(points.data(), N, nc);
+        for (const auto &mutant : mutants) {
+            mutant.evaluate_incremental(nc, outputs.data(), ws);
+        }
+    }
+}
+
+/// This test is passed whenever it completes. It compares the scalar, the batch and the incremental evaluation
+BOOST_AUTO_TEST_CASE(batch_evaluation_speed)
+{
+    unsigned int N = 100000;
+
+    dcgp::kernel_set<double> kernel_set1({"sum", "diff", "mul", "div"});
+    audi::stream(std::cout, "Function set ", kernel_set1(), "\n");
+    perform_evaluations(2, 4, 2, 3, 4, 4, N, kernel_set1());
+    perform_evaluations(2, 4, 10, 10, 11, 5, N, kernel_set1());
+    perform_evaluations(2, 4, 20, 20, 21, 6, N, kernel_set1());
+    perform_evaluations(1, 1, 1, 100, 101, 7, N, kernel_set1());
+    perform_evaluations(1, 1, 2, 100, 101, 8, N, kernel_set1());
+    perform_evaluations(1, 1, 3, 100, 101, 9, N, kernel_set1());
+
+    dcgp::kernel_set<double> kernel_set2({"sum", "mul", "sig"});
+    audi::stream(std::cout, "\nFunction set ", kernel_set2(), "\n");
+    perform_evaluations(2, 4, 2, 3, 4, 4, N, kernel_set2());
+    perform_evaluations(2, 4, 10, 10, 11, 5, N, kernel_set2());
+    perform_evaluations(2, 4, 20, 20, 21, 6, N, kernel_set2());
+    perform_evaluations(1, 1, 1, 100, 101, 7, N, kernel_set2());
+    perform_evaluations(1, 1, 2, 100, 101, 8, N, kernel_set2());
+    perform_evaluations(1, 1, 3, 100, 101, 9, N, kernel_set2());
+}
@@ -0,0 +1,159 @@
+#define BOOST_TEST_MODULE dcgp_c_export_test
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <dlfcn.h>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include <dcgp/c_export.hpp>
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_ann.hpp>
+#include <dcgp/expression_weighted.hpp>
+#include <dcgp/kernel_set.hpp>
+
+#include "temp_dir.hpp"
+
+using namespace dcgp;
+
+using function_type = void (*)(const double *, double *);
+
+// A compiled export. The library is closed when the last copy goes out of scope.
+struct compiled {
+    std::shared_ptr<void> handle;
+    function_type f;
+};
+
+// Runs a command without a shell and returns its exit status (-1 if it could not be run)
+int run(std::vector<std::string> args)
+{
+    std::vector<char *> argv;
+    for (auto &arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        ::execvp(argv[0], argv.data());
+        ::_exit(127);
+    }
+    int status = 0;
+    if (pid == -1 || ::waitpid(pid, &status, 0) == -1) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Compiles the exported source with the C compiler and loads the function called name
+compiled compile(const std::string &source, const std::string &name)
+{
+    // The files are removed once loaded
+    temp_dir tmp;
+    const std::string stem = tmp.path() + "/" + name;
+    std::ofstream(stem + ".c") << source;
+    BOOST_REQUIRE_EQUAL(run({"cc", "-std=c99", "-Wall", "-Werror", "-O2", "-fPIC", "-shared", "-ffp-contract=off", "-o",
+                             stem + ".so", stem + ".c", "-lm"}),
+                        0);
+    void *handle = ::dlopen((stem + ".so").c_str(), RTLD_NOW | RTLD_LOCAL);
+    BOOST_REQUIRE(handle);
+    compiled retval{std::shared_ptr<void>(handle, [](void *h) { ::dlclose(h); }), nullptr};
+    retval.f = reinterpret_cast<function_type>(::dlsym(handle, name.c_str()));
+    BOOST_REQUIRE(retval.f);
+    return retval;
+}
+
+// Equality that also holds for two NaNs and allows for the compile time evaluation of the kernels on the constants
+bool close(double a, double b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b)) || std::abs(a - b) <= 1e-14 * std::abs(b);
+}
+
+// Checks that the exported function computes the same values as the expression
+template <typename Expression>
+void check_export(const Expression &ex, const std::string &name)
+{
+    auto lib = compile(c_source(ex, name), name);
+    std::mt19937 rng(32u);
+    std::uniform_real_distribution<double> dist(-3., 3.);
+    std::vector<double> point(ex.get_n() - ex.get_eph_val().size()), out(ex.get_m());
+    for (auto k = 0u; k < 100u; ++k) {
+        for (auto &item : point) {
+            item = dist(rng);
+        }
+        auto expected = ex(point);
+        lib.f(point.data(), out.data());
+        for (auto i = 0u; i < out.size(); ++i) {
+            BOOST_CHECK(close(out[i], expected[i]));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expression_test)
+{
+    kernel_set<double> all({"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU", "ISRU", "sin", "cos",
+                            "log", "exp", "gaussian", "sqrt", "sig_fast", "tanh_fast", "exp_fast", "gaussian_fast"});
+    for (auto seed = 0u; seed < 20u; ++seed) {
+        // With and without ephemeral constants
+        expression<double> ex(3, 2, 3, 10, 11, 2 + seed % 2u, all(), seed % 3u, seed);
+        if (seed % 3u) {
+            ex.set_eph_val(std::vector<double>(seed % 3u, -1.25 + 0.1 * seed));
+        }
+        check_export(ex, "model_" + std::to_string(seed));
+    }
+    // Only the active nodes are exported
+    expression<double> ex(1, 1, 1, 3, 4, 2, kernel_set<double>({"sum", "sin"})(), 0u, 23u);
+    ex.set({0, 0, 0, 1, 0, 0, 1, 0, 0, 1});
+    auto source = c_source(ex);
+    BOOST_CHECK(source.find("n1 ") != std::string::npos);
+    BOOST_CHECK(source.find("n2 ") == std::string::npos);
+    BOOST_CHECK(source.find("n3 ") == std::string::npos);
+    BOOST_CHECK(source.find("void dcgp_expression(const double *x, double *out)") != std::string::npos);
+    // The approximate kernels only bring in their helpers when used
+    BOOST_CHECK(source.find("_fast_exp") == std::string::npos);
+    // Kernels other than those of the kernel_set cannot be exported
+    kernel<double> custom([](const std::vector<double> &in) { return in[0]; },
+                          [](const std::vector<std::string> &in) { return in[0]; }, "custom");
+    BOOST_CHECK_THROW(c_source(expression<double>(1, 1, 1, 5, 6, 2, {custom}, 0u, 23u)), std::invalid_argument);
+    // Nor with invalid names
+    BOOST_CHECK_THROW(c_source(ex, "my model"), std::invalid_argument);
+    BOOST_CHECK_THROW(c_source(ex, "0model"), std::invalid_argument);
+    BOOST_CHECK_THROW(c_source(ex, ""), std::invalid_argument);
+    // Derived expressions are exported by their own overload only
+    expression_weighted<double> weighted(2, 1, 1, 5, 6, 2, all(), 23u);
+    BOOST_CHECK_THROW(c_source(static_cast<const expression<double> &>(weighted)), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(expression_weighted_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "pdiv", "sin", "exp", "tanh_fast"});
+    for (auto seed = 0u; seed < 10u; ++seed) {
+        expression_weighted<double> ex(3, 2, 3, 10, 11, 2 + seed % 2u, basic_set(), seed);
+        std::vector<double> weights(ex.get_weights().size());
+        std::normal_distribution<double> dist(0., 1.);
+        std::mt19937 rng(seed);
+        for (auto &w : weights) {
+            w = dist(rng);
+        }
+        // Unit weights are not written
+        weights[0] = 1.;
+        ex.set_weights(weights);
+        check_export(ex, "weighted_" + std::to_string(seed));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expression_ann_test)
+{
+    kernel_set<double> ann_set({"sig", "tanh", "ReLu", "ELU", "ISRU", "sum", "sig_fast", "tanh_fast"});
+    for (auto seed = 0u; seed < 10u; ++seed) {
+        expression_ann<double> ex(3, 2, 10, 3, 1, {3, 10, 10}, ann_set(), seed);
+        ex.randomise_weights(0., 1., seed);
+        ex.randomise_biases(0., 1., seed);
+        ex.mutate_active(5u);
+        check_export(ex, "ann_" + std::to_string(seed));
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef DCGP_CHECKPOINT_H
+#define DCGP_CHECKPOINT_H
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <pagmo/population.hpp>
+#include <pagmo/problem.hpp>
+#include <stdexcept>
+#include <string>
+
+namespace dcgp
+{
+
+// A unique file name in the temporary directory. The file (and the temporary file of a checkpoint being written) is
+// removed when going out of scope.
+class temp_file
+{
+public:
+    temp_file()
+        : m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("dcgp_test_%%%%-%%%%-%%%%"))
+                     .string())
+    {
+    }
+    ~temp_file()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove(m_path, ec);
+        boost::filesystem::remove(m_path + ".tmp", ec);
+    }
+    temp_file(const temp_file &) = delete;
+    temp_file &operator=(const temp_file &) = delete;
+    const std::string &path() const
+    {
+        return m_path;
+    }
+
+private:
+    std::string m_path;
+};
+
+// Checks that an evolution checkpointed every interval generations, and one resumed from its last checkpoint into a
+// different population, end as the uninterrupted one. make_uda() returns the algorithm.
+template <typename F>
+void check_checkpoint(F make_uda, const pagmo::problem &prob, pagmo::population::size_type pop_size,
+                      unsigned interval)
+{
+    temp_file checkpoint;
+    auto uda1 = make_uda();
+    uda1.set_verbosity(1u);
+    auto pop1 = uda1.evolve(pagmo::population{prob, pop_size, 23u});
+
+    auto uda2 = make_uda();
+    uda2.set_verbosity(1u);
+    uda2.set_checkpoint(checkpoint.path(), interval);
+    auto pop2 = uda2.evolve(pagmo::population{prob, pop_size, 23u});
+    BOOST_CHECK(pop2.get_x() == pop1.get_x());
+    BOOST_CHECK(uda2.get_log() == uda1.get_log());
+
+    auto uda3 = make_uda();
+    uda3.set_verbosity(1u);
+    uda3.set_checkpoint(checkpoint.path(), interval);
+    auto pop3 = uda3.resume(pagmo::population{prob, pop_size, 32u});
+    BOOST_CHECK(pop3.get_x() == pop1.get_x());
+    BOOST_CHECK(uda3.get_log() == uda1.get_log());
+
+    // Resuming needs a checkpoint matching the population
+    BOOST_CHECK_THROW(decltype(uda1){}.resume(pop1), std::invalid_argument);
+    BOOST_CHECK_THROW(uda3.resume(pagmo::population{prob, pop_size + 1u, 23u}), std::invalid_argument);
+    BOOST_CHECK_THROW(uda3.set_checkpoint("", 1u), std::invalid_argument);
+}
+
+} // end of namespace dcgp
+
+#endif
@@ -9,6 +9,35 @@
 
 using gdual_d = audi::gdual_d;
 
+// This evaluates the expression decoding the chromosome at each call, as done before the introduction of the tape.
+// It is used as a reference to measure the speedup obtained by the tape interpreter in expression::operator().
+std::vector<double> decode_and_evaluate(const dcgp::expression<double> &ex, const std::vector<double> &point)
+{
+    auto n = ex.get_n();
+    auto m = ex.get_m();
+    const auto &x = ex.get();
+    std::vector<double> retval(m);
+    std::vector<double> node(n + ex.get_r() * ex.get_c());
+    std::vector<double> function_in;
+    for (auto node_id : ex.get_active_nodes()) {
+        if (node_id < n) {
+            node[node_id] = point[node_id];
+        } else {
+            unsigned arity = ex.get_arity(node_id);
+            function_in.resize(arity);
+            unsigned idx = ex.get_gene_idx()[node_id];
+            for (auto j = 0u; j < arity; ++j) {
+                function_in[j] = node[x[idx + j + 1u]];
+            }
+            node[node_id] = ex.get_f()[x[idx]](function_in);
+        }
+    }
+    for (auto i = 0u; i < m; ++i) {
+        retval[i] = node[x[x.size() - m + i]];
+    }
+    return retval;
+}
+
 void perform_evaluations(unsigned int in, unsigned int out, unsigned int rows, unsigned int columns,
                          unsigned int levels_back, unsigned int arity, unsigned int N,
                          std::vector<dcgp::kernel<double>> kernel_set)
@@ -29,6 +58,14 @@ void perform_evaluations(unsigned int in, unsigned int out, unsigned int rows, u
 
     std::cout << "Performing " << N << " evaluations, in:" << in << " out:" << out << " rows:" << rows
               << " columns:" << columns << std::endl;
+    std::cout << "Decoding the chromosome at each call: ";
+    {
+        boost::timer::auto_cpu_timer t;
+        for (auto i = 0u; i < N; ++i) {
+            decode_and_evaluate(ex, in_num[i]);
+        }
+    }
+    std::cout << "Interpreting the tape: ";
     {
         boost::timer::auto_cpu_timer t;
         for (auto i = 0u; i < N; ++i) {
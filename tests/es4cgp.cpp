@@ -9,6 +9,8 @@
 #include <dcgp/algorithms/es4cgp.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 
+#include "checkpoint.hpp"
+
 using namespace dcgp;
 
 BOOST_AUTO_TEST_CASE(construction_test)
@@ -63,6 +65,39 @@ BOOST_AUTO_TEST_CASE(evolve_test)
     BOOST_CHECK(uda1.get_log() == uda2.get_log());
 }
 
+BOOST_AUTO_TEST_CASE(fixed_constants_test)
+{
+    // Without learning the constants, all mutants carry those of the initial champion
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    pagmo::problem prob{symbolic_regression({{1., 2.}, {0.3, -0.32}}, {{3. / 2.}, {0.02 / 0.32}}, 1u, 10u, 11u, 2u,
+                                            basic_set(), 2u, false)};
+    pagmo::population pop{prob, 5u, 23u};
+    auto best_x = pop.get_x()[pop.best_idx()];
+    pagmo::vector_double eph_val(best_x.begin(), best_x.begin() + 2);
+    BOOST_CHECK(eph_val != pagmo::vector_double(2u, 0.));
+    auto new_pop = es4cgp{10u, 2u, 0., false, 23u}.evolve(pop);
+    auto n_replaced = 0u;
+    for (decltype(pop.size()) i = 0u; i < pop.size(); ++i) {
+        const auto &x = new_pop.get_x()[i];
+        if (x != pop.get_x()[i]) {
+            BOOST_CHECK(pagmo::vector_double(x.begin(), x.begin() + 2) == eph_val);
+            ++n_replaced;
+        }
+    }
+    BOOST_CHECK(n_replaced > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(checkpoint_test)
+{
+    pagmo::problem prob{symbolic_regression({{1., 2.}, {0.3, -0.32}}, {{3. / 2.}, {0.02 / 0.32}})};
+    check_checkpoint([]() { return es4cgp{20u, 2u, 0., true, 23u}; }, prob, 5u, 7u);
+    es4cgp uda;
+    uda.set_checkpoint("es4cgp_checkpoint.bin", 7u);
+    BOOST_CHECK(uda.get_checkpoint_interval() == 7u);
+    BOOST_CHECK(uda.get_checkpoint_file() == "es4cgp_checkpoint.bin");
+    BOOST_CHECK(uda.get_extra_info().find("es4cgp_checkpoint.bin") != std::string::npos);
+}
+
 BOOST_AUTO_TEST_CASE(trivial_methods_test)
 {
     es4cgp uda{10u, 2u, 1e-4, true, 23u};
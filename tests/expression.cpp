@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <audi/gdual.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <limits>
 #include <pagmo/io.hpp>
 #include <random>
 #include <string>
@@ -87,6 +89,12 @@ BOOST_AUTO_TEST_CASE(construction)
     BOOST_CHECK_THROW(expression<double>(2, 4, 2, 3, 4, 1, empty_set(), 0u, rd()), std::invalid_argument);
     BOOST_CHECK_THROW(expression<double>(2, 4, 2, 3, 4, arity_wrong, basic_set(), 0u, rd()), std::invalid_argument);
     BOOST_CHECK_THROW(expression<double>(2, 4, 2, 3, 4, {3, 0, 1}, basic_set(), 0u, rd()), std::invalid_argument);
+    // Kernels needing more inputs than some nodes have (pdiv reads two)
+    BOOST_CHECK_THROW(expression<double>(2, 4, 2, 3, 4, 1, kernel_set<double>({"sum", "pdiv"})(), 0u, rd()),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(expression<double>(2, 4, 2, 3, 4, arity, kernel_set<double>({"pdiv"})(), 0u, rd()),
+                      std::invalid_argument);
+    BOOST_CHECK_NO_THROW(expression<double>(2, 4, 2, 3, 4, {3, 2, 2}, kernel_set<double>({"pdiv"})(), 0u, rd()));
 
     // Easy getters
     expression<double> ex(2, 4, 2, 3, 4, arity, basic_set(), 0u, rd());
@@ -102,6 +110,20 @@ BOOST_AUTO_TEST_CASE(construction)
     BOOST_CHECK(ex.get_l() == 4u);
     BOOST_CHECK(ex.get_f().size() == 4u);
     BOOST_CHECK(ex.get_arity() == arity);
+
+    // Copies share the kernels, bounds and gene positions, but not the chromosome
+    expression<double> ex2(ex);
+    BOOST_CHECK(&ex2.get_f() == &ex.get_f());
+    BOOST_CHECK(&ex2.get_lb() == &ex.get_lb());
+    BOOST_CHECK(&ex2.get_gene_idx() == &ex.get_gene_idx());
+    auto x = ex.get();
+    ex2.mutate(std::vector<unsigned>{0u, 1u, 2u, 3u});
+    BOOST_CHECK(ex2.get() != x);
+    BOOST_CHECK(ex.get() == x);
+    expression<double> ex3(2, 4, 2, 3, 4, arity, basic_set(), 0u, rd());
+    ex3 = ex;
+    BOOST_CHECK(&ex3.get_f() == &ex.get_f());
+    BOOST_CHECK(ex3.get() == ex.get());
 }
 
 BOOST_AUTO_TEST_CASE(compute)
@@ -122,6 +144,9 @@ BOOST_AUTO_TEST_CASE(compute)
     CHECK_EQUAL_V(ex1({2., -3.}), std::vector<double>({6, -6, -18, 0}));
     CHECK_EQUAL_V(ex1({1., -1.}), std::vector<double>({2, -1, -1, 0}));
     CHECK_CLOSE_V(ex1({-.123, 2.345}), std::vector<double>({-4.69, -0.288435, 0.676380075, 0}), 1e-8);
+    // Changing a function gene must be reflected in the evaluation (node 7 goes from mul to sum)
+    ex1.set_f_gene(7u, 0u);
+    CHECK_EQUAL_V(ex1({2., -3.}), std::vector<double>({6, -6, -3, 0}));
 
     /// Testing over a single row program
     dcgp::expression<double> ex2(4, 1, 1, 10, 10, 2, basic_set(), 0u, rd());
@@ -131,6 +156,318 @@ BOOST_AUTO_TEST_CASE(compute)
     CHECK_EQUAL_V(ex2({-1., 1., -1., 1.}), std::vector<double>({1}));
 }
 
+BOOST_AUTO_TEST_CASE(evaluate_with_workspace)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "sig"});
+    // The same workspace is reused across evaluations and chromosome changes
+    expression<double>::workspace ws;
+    std::vector<double> out(3);
+    for (auto seed = 0u; seed < 20u; ++seed) {
+        expression<double> ex(3, 3, 4, 5, 6, 2, basic_set(), 1u, seed);
+        ex.set_eph_val({0.5});
+        for (auto i = 0u; i < 10u; ++i) {
+            ex.mutate_active(3);
+            std::vector<double> point = {0.1 * i, -0.3, 1.2};
+            ex.evaluate(point.data(), out.data(), ws);
+            CHECK_EQUAL_V(out, ex(point));
+            BOOST_CHECK_EQUAL(ex.loss(point, out, expression<double>::loss_type::MSE, ws), 0.);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(evaluate_batch)
+{
+    // Vectorized kernels only, a mix and non vectorized kernels only
+    std::vector<kernel_set<double>> sets = {kernel_set<double>({"sum", "diff", "mul", "div", "pdiv"}),
+                                            kernel_set<double>({"sum", "mul", "pdiv", "sig", "sin"}),
+                                            kernel_set<double>({"sig", "tanh", "cos"})};
+    std::mt19937 gen(32u);
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+    expression<double>::workspace ws;
+    for (const auto &set : sets) {
+        for (auto seed = 0u; seed < 10u; ++seed) {
+            expression<double> ex(2, 3, 3, 6, 7, {2, 3, 2, 2, 4, 2}, set(), 1u, seed);
+            ex.set_eph_val({0.3});
+            // A number of points that is not a multiple of the block size
+            for (auto N : {1u, 64u, 150u}) {
+                std::vector<double> points(2u * N), out(3u * N);
+                std::generate(points.begin(), points.end(), [&]() { return uniform(gen); });
+                ex.evaluate_batch(points.data(), out.data(), N, ws);
+                for (auto k = 0u; k < N; ++k) {
+                    auto ground_truth = ex({points[2u * k], points[2u * k + 1u]});
+                    CHECK_EQUAL_V(std::vector<double>(out.begin() + 3u * k, out.begin() + 3u * k + 3u), ground_truth);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(builtin_kernels)
+{
+    // The kernels of a kernel_set carry their opcode
+    kernel_set<double> set({"sum", "ReLu", "gaussian"});
+    BOOST_CHECK(set()[0].get_opcode() == kernel_opcode::sum);
+    BOOST_CHECK(set()[1].get_opcode() == kernel_opcode::relu);
+    BOOST_CHECK(set()[2].get_opcode() == kernel_opcode::gaussian);
+    // A user defined kernel is called through its std::function, whatever its name
+    kernel<double> fake_sum(my_mul<double>, print_my_mul, "sum");
+    BOOST_CHECK(fake_sum.get_opcode() == kernel_opcode::custom);
+    expression<double> ex(2, 1, 1, 1, 1, 2, {fake_sum}, 0u, 23u);
+    ex.set({0, 0, 1, 2});
+    CHECK_EQUAL_V(ex({3., 2.}), std::vector<double>{6.});
+    std::vector<double> points = {3., 2., 4., 5.}, out(2);
+    expression<double>::workspace ws;
+    ex.evaluate_batch(points.data(), out.data(), 2u, ws);
+    CHECK_EQUAL_V(out, (std::vector<double>{6., 20.}));
+}
+
+BOOST_AUTO_TEST_CASE(fixed_arity_kernels)
+{
+    // The binary entry point of a user defined kernel is called when the arity is two
+    unsigned calls = 0u;
+    kernel<double> add(my_sum<double>, print_my_sum, "add", nullptr, [&calls](const double &a, const double &b) {
+        ++calls;
+        return a + b;
+    });
+    BOOST_CHECK(!add.has_unary());
+    BOOST_CHECK(add.has_binary());
+    BOOST_CHECK_EQUAL(add(3.), 3.);
+    expression<double> ex(2, 1, 1, 1, 1, 2, {add}, 0u, 23u);
+    ex.set({0, 0, 1, 2});
+    CHECK_EQUAL_V(ex({3., 2.}), std::vector<double>{5.});
+    std::vector<double> points = {3., 2., 4., 5.}, out(2);
+    expression<double>::workspace ws;
+    ex.evaluate_batch(points.data(), out.data(), 2u, ws);
+    CHECK_EQUAL_V(out, (std::vector<double>{5., 9.}));
+    BOOST_CHECK_EQUAL(calls, 3u);
+    // Other arities go through the std::function
+    expression<double> ex3(2, 1, 1, 1, 1, 3, {add}, 0u, 23u);
+    ex3.set({0, 0, 1, 1, 2});
+    CHECK_EQUAL_V(ex3({3., 2.}), std::vector<double>{7.});
+    BOOST_CHECK_EQUAL(calls, 3u);
+    // The built-in kernels have both entry points, also for gduals
+    kernel_set<gdual_d> set({"sum", "diff", "mul", "div", "sig", "tanh", "ReLu", "ELU", "ISRU", "sin", "cos", "log",
+                             "exp", "gaussian", "sqrt"});
+    gdual_d x(0.3, "x", 2), y(0.7, "y", 2);
+    for (const auto &f : set()) {
+        BOOST_CHECK(f.has_unary() && f.has_binary());
+        BOOST_CHECK(f(x) == f(std::vector<gdual_d>{x}));
+        BOOST_CHECK(f(x, y) == f(std::vector<gdual_d>{x, y}));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batched_kernels)
+{
+    // The batched entry points of the built-in kernels return the same values as the kernel functions
+    kernel_set<double> set({"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU", "ISRU", "sin", "cos",
+                            "log", "exp", "gaussian", "sqrt", "exp_fast", "gaussian_fast", "sig_fast", "tanh_fast"});
+    std::vector<double> x = {0.3, -1.2, 0., 2.5}, y = {0.7, 0.4, 0., -1.}, z = {1.1, 0., -0.5, 2.};
+    for (const auto &f : set()) {
+        BOOST_CHECK(f.has_batch());
+        for (auto rows : {std::vector<const double *>{x.data()}, std::vector<const double *>{x.data(), y.data()},
+                          std::vector<const double *>{x.data(), y.data(), z.data()}}) {
+            // pdiv requires two inputs at least
+            if (f.get_name() == "pdiv" && rows.size() < 2u) {
+                continue;
+            }
+            std::vector<double> out(4);
+            f(rows, out.data(), 4u);
+            for (auto k = 0u; k < 4u; ++k) {
+                std::vector<double> point;
+                for (auto row : rows) {
+                    point.push_back(row[k]);
+                }
+                auto expected = f(point);
+                BOOST_CHECK(out[k] == expected || (std::isnan(out[k]) && std::isnan(expected)));
+            }
+        }
+    }
+    // A kernel without a batched entry point is called point by point
+    kernel<double> mul(my_mul<double>, print_my_mul, "mul");
+    BOOST_CHECK(!mul.has_batch());
+    std::vector<double> out(4);
+    mul({x.data(), y.data()}, out.data(), 4u);
+    CHECK_EQUAL_V(out, (std::vector<double>{0.3 * 0.7, -1.2 * 0.4, 0., -2.5}));
+    // The batched entry point of a user defined kernel is called once per block of points
+    unsigned calls = 0u;
+    kernel<double> add(my_sum<double>, print_my_sum, "add", nullptr, nullptr,
+                       [&calls](const std::vector<const double *> &in, double *res, unsigned b) {
+                           ++calls;
+                           for (auto k = 0u; k < b; ++k) {
+                               res[k] = my_sum<double>({in[0][k], in[1][k]});
+                           }
+                       });
+    expression<double> ex(2, 1, 1, 1, 1, 2, {add}, 0u, 23u);
+    ex.set({0, 0, 1, 2});
+    const unsigned N = expression<double>::batch_block_size + 10u;
+    std::vector<double> points(2u * N), res(N);
+    for (auto k = 0u; k < 2u * N; ++k) {
+        points[k] = k;
+    }
+    expression<double>::workspace ws;
+    ex.evaluate_batch(points.data(), res.data(), N, ws);
+    BOOST_CHECK_EQUAL(calls, 2u);
+    for (auto k = 0u; k < N; ++k) {
+        BOOST_CHECK_EQUAL(res[k], 4. * k + 1.);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(single_precision)
+{
+    kernel_set<float> set_f({"sum", "diff", "mul", "pdiv", "sig", "sin"});
+    kernel_set<double> set_d({"sum", "diff", "mul", "pdiv", "sig", "sin"});
+    std::mt19937 gen(32u);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    expression<float>::workspace ws;
+    for (auto seed = 0u; seed < 10u; ++seed) {
+        expression<float> ex_f(2, 3, 3, 6, 7, {2, 3, 2, 2, 4, 2}, set_f(), 1u, seed);
+        expression<double> ex_d(2, 3, 3, 6, 7, {2, 3, 2, 2, 4, 2}, set_d(), 1u, seed);
+        BOOST_CHECK(ex_f.get() == ex_d.get());
+        ex_f.set_eph_val({0.3f});
+        ex_d.set_eph_val({static_cast<double>(0.3f)});
+        std::vector<float> points(2u * 150u), out(3u * 150u);
+        std::generate(points.begin(), points.end(), [&]() { return uniform(gen); });
+        ex_f.evaluate_batch(points.data(), out.data(), 150u, ws);
+        for (auto k = 0u; k < 150u; ++k) {
+            // The batch evaluation is identical to the scalar one
+            auto ground_truth = ex_f({points[2u * k], points[2u * k + 1u]});
+            CHECK_EQUAL_V(std::vector<float>(out.begin() + 3u * k, out.begin() + 3u * k + 3u), ground_truth);
+            // and close to the double precision one (pdiv may hide a division by a tiny number)
+            auto out_d = ex_d({points[2u * k], points[2u * k + 1u]});
+            for (auto i = 0u; i < 3u; ++i) {
+                if (std::abs(out_d[i]) < 1e3) {
+                    BOOST_CHECK_SMALL(out[3u * k + i] - out_d[i], 1e-3 * (1. + std::abs(out_d[i])));
+                }
+            }
+        }
+    }
+    // The loss
+    expression<float> ex(2, 2, 2, 2, 3, 2, kernel_set<float>({"sum", "diff", "mul", "div"})(), 0u, 23u);
+    // 2xy, 2x
+    ex.set({0, 1, 1, 0, 0, 0, 2, 0, 2, 2, 0, 2, 4, 3});
+    BOOST_CHECK_EQUAL(ex.loss({{1.f, 1.f}, {1.f, 0.f}}, {{2.f, 2.f}, {0.f, 0.f}}, "MSE", 0u), 1.f);
+    BOOST_CHECK_EQUAL(ex.loss({{1.f, 1.f}, {1.f, 0.f}}, {{2.f, 2.f}, {0.f, 0.f}}, "MSE", 1u), 1.f);
+    BOOST_CHECK_CLOSE(ex.loss({1.f, 1.f}, {0.5f, 0.5f}, expression<float>::loss_type::CE), 0.693147f, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(incremental_evaluation)
+{
+    std::vector<kernel_set<double>> sets = {kernel_set<double>({"sum", "diff", "mul", "pdiv"}),
+                                            kernel_set<double>({"sum", "mul", "pdiv", "sig", "sin"})};
+    std::mt19937 gen(32u);
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+    expression<double>::workspace ws;
+    const unsigned N = 100u;
+    std::vector<double> points(2u * N), out(3u * N), ground_truth(3u * N);
+    std::generate(points.begin(), points.end(), [&]() { return uniform(gen); });
+    for (const auto &set : sets) {
+        for (auto seed = 0u; seed < 10u; ++seed) {
+            expression<double> parent(2, 3, 3, 6, 7, {2, 3, 2, 2, 4, 2}, set(), 1u, seed);
+            expression<double>::node_cache nc;
+            parent.init_node_cache(points.data(), N, nc);
+            for (auto i = 0u; i < 20u; ++i) {
+                // Mutants of the parent are evaluated reusing its node values
+                auto mutant = parent;
+                mutant.mutate_active(1u + i % 3u);
+                if (i % 5u == 0u) {
+                    mutant.set_eph_val({uniform(gen)});
+                }
+                mutant.evaluate_incremental(nc, out.data(), ws);
+                mutant.evaluate_batch(points.data(), ground_truth.data(), N, ws);
+                CHECK_EQUAL_V(out, ground_truth);
+                // From time to time a mutant becomes the new parent
+                if (i % 4u == 0u) {
+                    parent = mutant;
+                    parent.update_node_cache(nc);
+                    parent.evaluate_incremental(nc, out.data(), ws);
+                    CHECK_EQUAL_V(out, ground_truth);
+                }
+            }
+        }
+    }
+    // The node cache must come from an expression with the same structure
+    expression<double> ex(2, 3, 3, 6, 7, 2, sets[0](), 1u, 23u), other(2, 3, 3, 5, 6, 2, sets[0](), 1u, 23u);
+    expression<double>::node_cache nc;
+    BOOST_CHECK_THROW(ex.evaluate_incremental(nc, out.data(), ws), std::invalid_argument);
+    other.init_node_cache(points.data(), N, nc);
+    BOOST_CHECK_THROW(ex.evaluate_incremental(nc, out.data(), ws), std::invalid_argument);
+    BOOST_CHECK_THROW(ex.update_node_cache(nc), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(constant_folding)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    // One input x and two ephemeral constants c1, c2: (c1 + c2) * x, with c1 + c2 folded
+    expression<double> ex(1, 1, 1, 3, 4, 2, basic_set(), 2u, 23u);
+    ex.set({0, 1, 2, 2, 3, 0, 1, 3, 3, 4});
+    ex.set_eph_val({1., 2.});
+    expression<double>::workspace ws;
+    std::vector<double> points = {2., -1., 0.5}, out(3u);
+    CHECK_EQUAL_V(ex({2.}), std::vector<double>({6.}));
+    ex.evaluate_batch(points.data(), out.data(), 3u, ws);
+    CHECK_EQUAL_V(out, std::vector<double>({6., -3., 1.5}));
+    // The folded constants follow the ephemeral constants ...
+    ex.set_eph_val({3., 4.});
+    CHECK_EQUAL_V(ex({2.}), std::vector<double>({14.}));
+    ex.evaluate_batch(points.data(), out.data(), 3u, ws);
+    CHECK_EQUAL_V(out, std::vector<double>({14., -7., 3.5}));
+    // ... and the function genes of the folded nodes
+    ex.set_f_gene(3u, 2u);
+    CHECK_EQUAL_V(ex({2.}), std::vector<double>({24.}));
+    // The symbolic representation is not folded
+    BOOST_CHECK_EQUAL(ex({"x"})[0], "((c1*c2)*x)");
+}
+
+BOOST_AUTO_TEST_CASE(symbolic_dag)
+{
+    kernel_set<double> sum_mul({"sum", "mul"});
+    expression<double> ex(2, 1, 1, 3, 4, 2, sum_mul(), 0u, 23u);
+    ex.set({1, 0, 1, 0, 2, 2, 0, 0, 0, 3});
+    CHECK_EQUAL_V(ex({"x", "y"}), std::vector<std::string>{"((x*y)+(x*y))"});
+    CHECK_EQUAL_V(ex.symbolic_dag({"x", "y"}), (std::vector<std::string>{"t2 = (x*y)", "t3 = (t2+t2)", "y0 = t3"}));
+    CHECK_EQUAL_V(ex.symbolic_length({"x", "y"}), std::vector<double>{13.});
+    BOOST_CHECK_THROW(ex.symbolic_dag({"x"}), std::invalid_argument);
+    BOOST_CHECK_THROW(ex.symbolic_length({"x"}), std::invalid_argument);
+    // An output connected to an input
+    ex.set({1, 0, 1, 0, 2, 2, 0, 0, 0, 1});
+    CHECK_EQUAL_V(ex.symbolic_dag({"x", "y"}), std::vector<std::string>{"y0 = y"});
+    // Ephemeral constants keep their symbols
+    expression<double> ex_eph(1, 1, 1, 1, 1, 2, sum_mul(), 1u, 23u);
+    ex_eph.set({1, 0, 1, 2});
+    CHECK_EQUAL_V(ex_eph.symbolic_dag({"x"}), (std::vector<std::string>{"t2 = (x*c1)", "y0 = t2"}));
+    // The size of the bindings is linear in the depth, that of the inlined representation exponential
+    kernel_set<double> sum({"sum"});
+    expression<double> deep(1, 1, 1, 100, 1, 2, sum(), 0u, 23u);
+    std::vector<unsigned> x;
+    for (auto i = 0u; i < 100u; ++i) {
+        x.insert(x.end(), {0u, i, i});
+    }
+    x.push_back(100u);
+    deep.set(x);
+    auto dag = deep.symbolic_dag({"x"});
+    BOOST_CHECK_EQUAL(dag.size(), 101u);
+    BOOST_CHECK_EQUAL(dag[99], "t100 = (t99+t99)");
+    BOOST_CHECK_EQUAL(dag[100], "y0 = t100");
+    // (each level doubles the length and adds three characters)
+    BOOST_CHECK_CLOSE(deep.symbolic_length({"x"})[0], 4. * std::pow(2., 100.) - 3., 1e-10);
+    // The lengths are those of the inlined representation, also for kernels printing an input more than once
+    kernel<double> square(my_mul<double>, [](const std::vector<std::string> &in) { return in[0] + "*" + in[0]; },
+                          "square");
+    auto kernels = kernel_set<double>({"sum", "diff", "mul", "div", "sig", "ISRU", "gaussian"})();
+    kernels.push_back(square);
+    for (auto seed = 0u; seed < 100u; ++seed) {
+        expression<double> random_ex(2, 3, 3, 6, 7, 3, kernels, 2u, seed);
+        auto symbolic = random_ex({"x", "yy"});
+        auto lengths = random_ex.symbolic_length({"x", "yy"});
+        for (auto i = 0u; i < 3u; ++i) {
+            BOOST_CHECK_EQUAL(lengths[i], static_cast<double>(symbolic[i].length()));
+        }
+        const auto &active = random_ex.get_active_nodes();
+        auto n_active = std::count_if(active.begin(), active.end(), [](unsigned node_id) { return node_id >= 4u; });
+        BOOST_CHECK_EQUAL(random_ex.symbolic_dag({"x", "yy"}).size(), static_cast<std::size_t>(n_active) + 3u);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(check_bounds)
 {
     // Random seed
@@ -275,6 +612,96 @@ BOOST_AUTO_TEST_CASE(mutate)
     }
 }
 
+BOOST_AUTO_TEST_CASE(neutral_mutations)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    expression<double> ex(2, 4, 2, 3, 4, 2, basic_set(), 0u, 23u);
+    ex.set({0, 0, 1, 1, 0, 0, 1, 3, 1, 2, 0, 1, 0, 4, 4, 2, 5, 4, 2, 5, 7, 3});
+    // Node 6 (genes 12, 13, 14) is inactive: mutating its genes is neutral
+    for (auto idx : {12u, 13u, 14u}) {
+        auto active_genes = ex.get_active_genes();
+        BOOST_CHECK(!ex.mutate(idx));
+        CHECK_EQUAL_V(active_genes, ex.get_active_genes());
+        CHECK_EQUAL_V(ex({1., -1.}), std::vector<double>({0, -1, -1, 0}));
+    }
+    // Node 7 (genes 15, 16, 17) is active: mutating its function gene changes the phenotype,
+    // not the active genes
+    auto active_genes = ex.get_active_genes();
+    BOOST_CHECK(ex.mutate(15u));
+    CHECK_EQUAL_V(active_genes, ex.get_active_genes());
+    auto x = ex.get();
+    expression<double> ex2(2, 4, 2, 3, 4, 2, basic_set(), 0u, 23u);
+    ex2.set(x);
+    CHECK_EQUAL_V(ex({1., -1.}), ex2({1., -1.}));
+    CHECK_EQUAL_V(ex({0.3, 2.}), ex2({0.3, 2.}));
+    // Output genes are always active
+    BOOST_CHECK(ex.mutate_ogene());
+    // Mutating only genes that cannot change is neutral
+    expression<double> ex3(1, 1, 1, 1, 1, 1, kernel_set<double>({"sum"})(), 0u, 23u);
+    BOOST_CHECK(!ex3.mutate_active(3u));
+    BOOST_CHECK(!ex3.mutate_random(3u));
+}
+
+BOOST_AUTO_TEST_CASE(incremental_active_nodes)
+{
+    // The active nodes and genes maintained incrementally after mutations must be those
+    // obtained rebuilding them from scratch
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    std::vector<expression<double>> exs = {expression<double>(3, 3, 2, 20, 21, 2, basic_set(), 0u, 23u),
+                                           expression<double>(1, 1, 2, 100, 101, 3, basic_set(), 2u, 23u),
+                                           expression<double>(4, 2, 10, 10, 3, {1, 2, 3, 4, 1, 2, 3, 4, 1, 2},
+                                                              basic_set(), 0u, 23u)};
+    for (auto &ex : exs) {
+        auto check = [&ex]() {
+            auto ex2 = ex;
+            ex2.set(ex.get());
+            CHECK_EQUAL_V(ex.get_active_nodes(), ex2.get_active_nodes());
+            CHECK_EQUAL_V(ex.get_active_genes(), ex2.get_active_genes());
+        };
+        for (auto i = 0u; i < 200u; ++i) {
+            ex.mutate_active(1 + i % 5);
+            check();
+            ex.mutate_random(1 + i % 3);
+            check();
+            ex.mutate({i % static_cast<unsigned>(ex.get().size()), (7u * i) % static_cast<unsigned>(ex.get().size())});
+            check();
+            ex.mutate_ogene();
+            check();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(phenotype_hash)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    expression<double> ex(2, 4, 2, 3, 4, 2, basic_set(), 0u, 23u);
+    // Node 6 (genes 12, 13, 14) is inactive
+    ex.set({0, 0, 1, 1, 0, 0, 1, 3, 1, 2, 0, 1, 0, 4, 4, 2, 5, 4, 2, 5, 7, 3});
+    auto hash = ex.phenotype_hash();
+    auto phenotype = ex.get_phenotype();
+    CHECK_EQUAL_V(phenotype,
+                  std::vector<unsigned>({2, 0, 0, 1, 3, 1, 0, 0, 4, 1, 3, 1, 5, 2, 0, 1, 7, 2, 5, 4, 2, 5, 7, 3}));
+    // Changing inactive genes does not change the phenotype
+    for (auto idx : {12u, 13u, 14u}) {
+        BOOST_CHECK(!ex.mutate(idx));
+        BOOST_CHECK_EQUAL(ex.phenotype_hash(), hash);
+        CHECK_EQUAL_V(ex.get_phenotype(), phenotype);
+    }
+    // Changing active genes does
+    auto ex2 = ex;
+    ex2.set_f_gene(7u, 1u);
+    BOOST_CHECK(ex2.phenotype_hash() != hash);
+    // The hash does not depend on the history of the expression
+    expression<double> ex3(2, 4, 2, 3, 4, 2, basic_set(), 0u, 32u);
+    ex3.set(ex.get());
+    BOOST_CHECK_EQUAL(ex3.phenotype_hash(), hash);
+    // The values of the ephemeral constants are part of the hash
+    expression<double> ex4(1, 1, 2, 3, 4, 2, basic_set(), 1u, 23u);
+    hash = ex4.phenotype_hash();
+    ex4.set_eph_val({2.});
+    BOOST_CHECK(ex4.phenotype_hash() != hash);
+}
+
 BOOST_AUTO_TEST_CASE(loss)
 {
     // Random seed
@@ -330,6 +757,75 @@ BOOST_AUTO_TEST_CASE(loss)
         BOOST_CHECK_CLOSE(ex.loss(in, out, "MSE", true), ex.loss(in, out, "MSE", false), 1e-8);
         BOOST_CHECK_CLOSE(ex.loss(in, out, "CE", true), ex.loss(in, out, "CE", false), 1e-8);
     }
+    // The batch loss, reduced from the output nodes of blocks of points, matches the loss of the single points
+    {
+        auto in = std::vector<std::vector<double>>(150, {0., 0.});
+        auto out = std::vector<std::vector<double>>(150, {0., 0.});
+        std::generate(in.begin(), in.end(), [&mersenne_engine, &dist]() {
+            return std::vector<double>{dist(mersenne_engine), dist(mersenne_engine)};
+        });
+        std::generate(out.begin(), out.end(), [&mersenne_engine, &dist]() {
+            return std::vector<double>{dist(mersenne_engine), dist(mersenne_engine)};
+        });
+        for (auto loss_e : {expression<double>::loss_type::MSE, expression<double>::loss_type::CE}) {
+            double sum = 0.;
+            for (auto i = 0u; i < in.size(); ++i) {
+                sum += ex.loss(in[i], out[i], loss_e);
+            }
+            BOOST_CHECK_EQUAL(ex.loss(in, out, loss_e == expression<double>::loss_type::MSE ? "MSE" : "CE"),
+                              sum / 150.);
+        }
+        in[100] = {1.};
+        BOOST_CHECK_THROW(ex.loss(in, out, "MSE"), std::invalid_argument);
+    }
+    // The parallel loss accepts any data size and is reproducible
+    for (auto n : {1u, 63u, 1001u, 20011u}) {
+        auto in = std::vector<std::vector<double>>(n, {0., 0.});
+        auto out = std::vector<std::vector<double>>(n, {0., 0.});
+        std::generate(in.begin(), in.end(), [&mersenne_engine, &dist]() {
+            return std::vector<double>{dist(mersenne_engine), dist(mersenne_engine)};
+        });
+        std::generate(out.begin(), out.end(), [&mersenne_engine, &dist]() {
+            return std::vector<double>{dist(mersenne_engine), dist(mersenne_engine)};
+        });
+        auto loss_p = ex.loss(in, out, "MSE", 7u);
+        BOOST_CHECK_CLOSE(loss_p, ex.loss(in, out, "MSE", 0u), 1e-8);
+        for (auto i = 0u; i < 10u; ++i) {
+            BOOST_CHECK_EQUAL(ex.loss(in, out, "MSE", 7u), loss_p);
+            BOOST_CHECK_EQUAL(ex.loss(in, out, "MSE", 3u), loss_p);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bounded_loss)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    expression<double> ex(2, 2, 2, 2, 3, 2, basic_set(), 0u, 23u);
+    // 2xy, 2x
+    ex.set({0, 1, 1, 0, 0, 0, 2, 0, 2, 2, 0, 2, 4, 3});
+    std::mt19937 gen(23u);
+    std::uniform_real_distribution<double> dist{-1., 1.};
+    std::vector<std::vector<double>> in(100, {0., 0.}), out(100, {0., 0.});
+    for (auto i = 0u; i < in.size(); ++i) {
+        in[i] = {dist(gen), dist(gen)};
+        out[i] = {dist(gen), dist(gen)};
+    }
+    auto loss = ex.loss(in, out, "MSE");
+    // When the bound is not exceeded the loss is returned
+    BOOST_CHECK_EQUAL(ex.bounded_loss(in, out, "MSE", std::numeric_limits<double>::infinity()), loss);
+    BOOST_CHECK_EQUAL(ex.bounded_loss(in, out, "MSE", loss), loss);
+    BOOST_CHECK_CLOSE(ex.bounded_loss(in, out, "MSE", 2. * loss, 7u), loss, 1e-12);
+    BOOST_CHECK_CLOSE(ex.bounded_loss(in, out, "MSE", 2. * loss, 1000u), loss, 1e-12);
+    // Otherwise a lower bound of the loss, larger than the bound
+    for (auto stride : {1u, 7u}) {
+        auto partial = ex.bounded_loss(in, out, "MSE", 0.5 * loss, stride);
+        BOOST_CHECK(partial > 0.5 * loss);
+        BOOST_CHECK(partial <= loss);
+    }
+    // The sanity checks
+    BOOST_CHECK_THROW(ex.bounded_loss(in, out, "MSE", loss, 0u), std::invalid_argument);
+    BOOST_CHECK_THROW(ex.bounded_loss(in, out, "MAE", loss), std::invalid_argument);
+    BOOST_CHECK_THROW(ex.bounded_loss(in, {{1., 2.}}, "MSE", loss), std::invalid_argument);
 }
 
 BOOST_AUTO_TEST_CASE(ephemeral_constants_test)
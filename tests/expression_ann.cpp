@@ -5,6 +5,7 @@
 #include <audi/io.hpp>
 #include <boost/test/unit_test.hpp>
 #include <stdexcept>
+#include <type_traits>
 
 #include <dcgp/expression_ann.hpp>
 #include <dcgp/kernel_set.hpp>
@@ -12,7 +13,7 @@ using namespace dcgp;
 
 void test_against_numerical_derivatives(unsigned n, unsigned m, unsigned r, unsigned c, unsigned lb,
                                         std::vector<unsigned> arity, unsigned seed,
-                                        expression_ann::loss_type loss_e)
+                                        expression_ann<double>::loss_type loss_e)
 {
     std::mt19937 gen(seed);
     // Random distributions
@@ -21,7 +22,7 @@ void test_against_numerical_derivatives(unsigned n, unsigned m, unsigned r, unsi
     // Kernel functions
     kernel_set<double> ann_set({"sig", "tanh", "ReLu", "ELU", "ISRU", "sum"});
     // a random dCGPANN
-    expression_ann ex(n, m, r, c, lb, arity, ann_set(), random_seed(gen));
+    expression_ann<double> ex(n, m, r, c, lb, arity, ann_set(), random_seed(gen));
     // Since weights and biases are, by default, set to ones, we randomize them
     ex.randomise_weights(0, 1., random_seed(gen));
     ex.randomise_biases(0, 1., random_seed(gen));
@@ -33,7 +34,7 @@ void test_against_numerical_derivatives(unsigned n, unsigned m, unsigned r, unsi
     auto in = std::vector<double>(ex.get_n(), norm(gen));
     // Output value desired (supervised signal)
     auto out = std::vector<double>(ex.get_m(), norm(gen));
-    if (loss_e == expression_ann::loss_type::CE) {
+    if (loss_e == expression_ann<double>::loss_type::CE) {
         // we normalize to probabilities
         double cumout = std::accumulate(out.begin(), out.end(), 0.);
         std::transform(out.begin(), out.end(), out.begin(), [cumout](double x) { return x / cumout; });
@@ -164,20 +165,26 @@ BOOST_AUTO_TEST_CASE(construction)
     std::random_device rd;
     // Kernel functions
     kernel_set<double> ann_set({"tanh"});
-    expression_ann ex(1, 1, 1, 2, 1, 1, ann_set(), rd());
+    expression_ann<double> ex(1, 1, 1, 2, 1, 1, ann_set(), rd());
     // We test that all weights are set to 1 and biases to 0
     auto ws = ex.get_weights();
     auto bs = ex.get_biases();
     BOOST_CHECK(std::all_of(ws.begin(), ws.end(), [](unsigned el) { return el == 1u; }));
     BOOST_CHECK(std::all_of(bs.begin(), bs.end(), [](unsigned el) { return el == 0u; }));
+    // The expression type defaults to double
+    BOOST_CHECK((std::is_same<expression_ann<>, expression_ann<double>>::value));
+    BOOST_CHECK((std::is_same<expression_ann<>::loss_type, expression<double>::loss_type>::value));
 
     kernel_set<double> ann_set_malformed1({"tanh", "sin"});
     kernel_set<double> ann_set_malformed2({"cos", "sig"});
     kernel_set<double> ann_set_malformed3({"ReLu", "diff"});
 
-    BOOST_CHECK_THROW((expression_ann{1, 1, 1, 2, 1, 1, ann_set_malformed1(), rd()}), std::invalid_argument);
-    BOOST_CHECK_THROW((expression_ann{1, 1, 1, 2, 1, 1, ann_set_malformed2(), rd()}), std::invalid_argument);
-    BOOST_CHECK_THROW((expression_ann{1, 1, 1, 2, 1, 1, ann_set_malformed3(), rd()}), std::invalid_argument);
+    BOOST_CHECK_THROW((expression_ann<double>{1, 1, 1, 2, 1, 1, ann_set_malformed1(), rd()}), std::invalid_argument);
+    BOOST_CHECK_THROW((expression_ann<double>{1, 1, 1, 2, 1, 1, ann_set_malformed2(), rd()}), std::invalid_argument);
+    BOOST_CHECK_THROW((expression_ann<double>{1, 1, 1, 2, 1, 1, ann_set_malformed3(), rd()}), std::invalid_argument);
+    // Kernels are recognised by their opcode, not by their name
+    kernel<double> fake_sig(my_sin<double>, print_my_sin, "sig");
+    BOOST_CHECK_THROW((expression_ann<double>{1, 1, 1, 2, 1, 1, {fake_sig}, rd()}), std::invalid_argument);
 }
 
 BOOST_AUTO_TEST_CASE(parenthesis)
@@ -188,7 +195,7 @@ BOOST_AUTO_TEST_CASE(parenthesis)
         std::random_device rd;
         // Kernel functions
         kernel_set<double> ann_set({"tanh"});
-        expression_ann ex(1, 1, 1, 2, 1, 1, ann_set(), rd());
+        expression_ann<double> ex(1, 1, 1, 2, 1, 1, ann_set(), rd());
         ex.set_weights({0.1, 0.2});
         ex.set_biases({0.3, 0.4});
         auto res = ex({0.23})[0];
@@ -201,7 +208,7 @@ BOOST_AUTO_TEST_CASE(parenthesis)
         std::random_device rd;
         // Kernel functions
         kernel_set<double> ann_set({"tanh"});
-        expression_ann ex(1, 1, 1, 2, 1, 2, ann_set(), rd());
+        expression_ann<double> ex(1, 1, 1, 2, 1, 2, ann_set(), rd());
         ex.set_weights({0.1, 0.2, 0.3, 0.4});
         ex.set_biases({0.5, 0.6});
         auto res = ex({0.23})[0];
@@ -215,7 +222,7 @@ BOOST_AUTO_TEST_CASE(parenthesis)
         std::random_device rd;
         // Kernel functions
         kernel_set<double> ann_set({"tanh"});
-        expression_ann ex(1, 1, 2, 2, 1, 2, ann_set(), rd());
+        expression_ann<double> ex(1, 1, 2, 2, 1, 2, ann_set(), rd());
         ex.set_weights({0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8});
         ex.set_biases({0.9, 1.1, 1.2, 1.3});
         ex.set({0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 1, 2, 3});
@@ -228,6 +235,40 @@ BOOST_AUTO_TEST_CASE(parenthesis)
     }
 }
 
+BOOST_AUTO_TEST_CASE(single_precision)
+{
+    // A single precision dCGP-ANN computes the same as a double precision one (up to rounding)
+    expression_ann<float> ex_f(3, 2, 10, 5, 2, {3, 3, 3, 3, 3}, kernel_set<float>({"sig", "tanh", "ReLu"})(), 32u);
+    expression_ann<double> ex_d(3, 2, 10, 5, 2, {3, 3, 3, 3, 3}, kernel_set<double>({"sig", "tanh", "ReLu"})(), 32u);
+    BOOST_CHECK(ex_f.get() == ex_d.get());
+    ex_f.randomise_weights(0.f, 0.5f, 23u);
+    ex_f.randomise_biases(0.f, 0.5f, 23u);
+    ex_d.set_weights(std::vector<double>(ex_f.get_weights().begin(), ex_f.get_weights().end()));
+    ex_d.set_biases(std::vector<double>(ex_f.get_biases().begin(), ex_f.get_biases().end()));
+    std::vector<std::vector<float>> points_f = {{0.1f, -0.2f, 0.3f}, {0.5f, 0.1f, -0.7f}};
+    std::vector<std::vector<float>> labels_f = {{0.2f, 0.1f}, {-0.3f, 0.4f}};
+    std::vector<std::vector<double>> points_d = {{0.1f, -0.2f, 0.3f}, {0.5f, 0.1f, -0.7f}};
+    std::vector<std::vector<double>> labels_d = {{0.2f, 0.1f}, {-0.3f, 0.4f}};
+    for (auto i = 0u; i < 2u; ++i) {
+        auto out_f = ex_f(points_f[i]);
+        auto out_d = ex_d(points_d[i]);
+        BOOST_CHECK_CLOSE(out_f[0], out_d[0], 1e-3);
+        BOOST_CHECK_CLOSE(out_f[1], out_d[1], 1e-3);
+    }
+    auto res_f = ex_f.d_loss(points_f, labels_f, expression_ann<float>::loss_type::MSE);
+    auto res_d = ex_d.d_loss(points_d, labels_d, expression_ann<double>::loss_type::MSE);
+    BOOST_CHECK_CLOSE(std::get<0>(res_f), std::get<0>(res_d), 1e-3);
+    for (auto i = 0u; i < std::get<1>(res_f).size(); ++i) {
+        BOOST_CHECK_SMALL(std::get<1>(res_f)[i] - std::get<1>(res_d)[i], 1e-5);
+    }
+    // Training reduces the loss
+    auto loss_start = ex_f.loss(points_f, labels_f, "MSE");
+    for (auto i = 0u; i < 10u; ++i) {
+        ex_f.sgd(points_f, labels_f, 0.1f, 2u, "MSE", 0u, false);
+    }
+    BOOST_CHECK(ex_f.loss(points_f, labels_f, "MSE") < loss_start);
+}
+
 BOOST_AUTO_TEST_CASE(sgd)
 {
     audi::print("Calling Stochastic Gradient Descent\n");
@@ -239,7 +280,7 @@ BOOST_AUTO_TEST_CASE(sgd)
 
     // Kernel functions
     kernel_set<double> ann_set({"sig", "tanh", "ReLu"});
-    expression_ann ex(3, 2, 100, 3, 1, 10, ann_set(), rd());
+    expression_ann<double> ex(3, 2, 100, 3, 1, 10, ann_set(), rd());
     ex.randomise_weights();
     ex.randomise_biases();
     std::vector<std::vector<double>> data(200, {0., 0., 0.});
@@ -265,7 +306,7 @@ BOOST_AUTO_TEST_CASE(sgd)
 BOOST_AUTO_TEST_CASE(d_loss)
 {
     audi::print("Testing against numerical derivatives\n");
-    using loss_t = expression_ann::loss_type;
+    using loss_t = expression_ann<double>::loss_type;
 
     // Random distributions
     std::mt19937 gen(std::random_device{}());
@@ -312,7 +353,7 @@ BOOST_AUTO_TEST_CASE(n_active_weights)
     // Kernel functions
     kernel_set<double> ann_set({"sig", "tanh", "ReLu"});
     {
-        expression_ann ex(2, 2, 2, 2, 5, 2, ann_set(), rd());
+        expression_ann<double> ex(2, 2, 2, 2, 5, 2, ann_set(), rd());
         ex.set({0, 0, 1, 0, 0, 1, 0, 2, 3, 0, 2, 3, 4, 5});
         BOOST_CHECK(ex.n_active_weights() == 8u);
         BOOST_CHECK(ex.n_active_weights(false) == 8u);
@@ -322,4 +363,107 @@ BOOST_AUTO_TEST_CASE(n_active_weights)
         BOOST_CHECK(ex.n_active_weights(false) == 8u);
         BOOST_CHECK(ex.n_active_weights(true) == 7u);
     }
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(d_loss_after_mutations)
+{
+    // The backpropagation data must be kept up to date by the mutation methods of the base class
+    using loss_t = expression_ann<double>::loss_type;
+    kernel_set<double> ann_set({"sig", "tanh", "ReLu", "sum"});
+    expression_ann<double> ex(3, 2, 10, 5, 2, {3, 3, 3, 3, 3}, ann_set(), 32u);
+    ex.randomise_weights(0, 1., 33u);
+    ex.randomise_biases(0, 1., 34u);
+    std::vector<std::vector<double>> data = {{0.1, -0.2, 0.3}, {-1., 0.5, 0.2}};
+    std::vector<std::vector<double>> label = {{0.1, 0.2}, {-0.3, 0.4}};
+    for (auto i = 0u; i < 50u; ++i) {
+        ex.mutate_active(3u);
+        // A copy with the data structures rebuilt from scratch
+        auto ex2 = ex;
+        ex2.set(ex.get());
+        auto res = ex.d_loss(data, label, loss_t::MSE);
+        auto res2 = ex2.d_loss(data, label, loss_t::MSE);
+        BOOST_CHECK_EQUAL(std::get<0>(res), std::get<0>(res2));
+        BOOST_CHECK(std::get<1>(res) == std::get<1>(res2));
+        BOOST_CHECK(std::get<2>(res) == std::get<2>(res2));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(approximate_kernels)
+{
+    // A dCGP-ANN with the approximate kernels computes the same as the exact one (up to the approximation error)
+    using loss_t = expression_ann<double>::loss_type;
+    expression_ann<double> ex(3, 2, 10, 5, 2, {3, 3, 3, 3, 3}, kernel_set<double>({"sig", "tanh", "ReLu"})(), 32u);
+    expression_ann<double> ex_fast(3, 2, 10, 5, 2, {3, 3, 3, 3, 3},
+                                   kernel_set<double>({"sig_fast", "tanh_fast", "ReLu"})(), 32u);
+    BOOST_CHECK(ex.get() == ex_fast.get());
+    ex.randomise_weights(0., 1., 33u);
+    ex.randomise_biases(0., 1., 34u);
+    ex_fast.set_weights(ex.get_weights());
+    ex_fast.set_biases(ex.get_biases());
+    std::vector<std::vector<double>> data = {{0.1, -0.2, 0.3}, {-1., 0.5, 0.2}, {2., -3., 0.7}};
+    std::vector<std::vector<double>> label = {{0.1, 0.2}, {-0.3, 0.4}, {0.5, -0.6}};
+    for (const auto &point : data) {
+        auto out = ex(point);
+        auto out_fast = ex_fast(point);
+        BOOST_CHECK_SMALL(out[0] - out_fast[0], 1e-7);
+        BOOST_CHECK_SMALL(out[1] - out_fast[1], 1e-7);
+    }
+    auto res = ex.d_loss(data, label, loss_t::MSE);
+    auto res_fast = ex_fast.d_loss(data, label, loss_t::MSE);
+    BOOST_CHECK_SMALL(std::get<0>(res) - std::get<0>(res_fast), 1e-7);
+    for (auto i = 0u; i < std::get<1>(res).size(); ++i) {
+        BOOST_CHECK_SMALL(std::get<1>(res)[i] - std::get<1>(res_fast)[i], 1e-6);
+    }
+    for (auto i = 0u; i < std::get<2>(res).size(); ++i) {
+        BOOST_CHECK_SMALL(std::get<2>(res)[i] - std::get<2>(res_fast)[i], 1e-6);
+    }
+    // The approximate nonlinearities can be set on the outputs
+    auto output_f = [&ex_fast]() {
+        return ex_fast.get_f()[ex_fast.get()[ex_fast.get_gene_idx()[ex_fast.get().back()]]].get_name();
+    };
+    ex_fast.set_output_f("tanh_fast");
+    BOOST_CHECK_EQUAL(output_f(), "tanh_fast");
+    ex_fast.set_output_f("sig_fast");
+    BOOST_CHECK_EQUAL(output_f(), "sig_fast");
+    BOOST_CHECK_THROW(ex.set_output_f("sig_fast"), std::invalid_argument);
+    // The derivatives are correct
+    expression_ann<double> ex_mixed(2, 2, 2, 2, 5, 2, kernel_set<double>({"sig_fast", "tanh_fast", "sig"})(), 23u);
+    ex_mixed.set({0, 0, 1, 1, 0, 1, 0, 2, 3, 1, 2, 3, 4, 5});
+    ex_mixed.randomise_weights(0., 1., 35u);
+    ex_mixed.randomise_biases(0., 1., 36u);
+    std::vector<std::vector<double>> data2 = {{0.3, -0.4}};
+    std::vector<std::vector<double>> label2 = {{0.1, 0.2}};
+    auto d = ex_mixed.d_loss(data2, label2, loss_t::MSE);
+    const double h = 1e-6;
+    auto biases = ex_mixed.get_biases();
+    for (auto i = 0u; i < biases.size(); ++i) {
+        auto b = biases;
+        b[i] += h;
+        ex_mixed.set_biases(b);
+        auto lp = ex_mixed.loss(data2, label2, "MSE");
+        b[i] -= 2 * h;
+        ex_mixed.set_biases(b);
+        auto lm = ex_mixed.loss(data2, label2, "MSE");
+        BOOST_CHECK_SMALL(std::get<2>(d)[i] - (lp - lm) / (2 * h), 1e-5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(symbolic_dag)
+{
+    // The nodes are printed with their weights and biases
+    kernel_set<double> ann_set({"tanh"});
+    expression_ann<double> ex(1, 1, 1, 2, 1, 1, ann_set(), 23u);
+    auto dag = ex.symbolic_dag({"x"});
+    BOOST_CHECK_EQUAL(dag.size(), 3u);
+    BOOST_CHECK_EQUAL(dag[0], "t1 = tanh(b1+w1_0*x)");
+    BOOST_CHECK_EQUAL(dag[1], "t2 = tanh(b2+w2_0*t1)");
+    BOOST_CHECK_EQUAL(dag[2], "y0 = t2");
+    // The lengths are those of the inlined representation
+    expression_ann<double> ex2(3, 2, 10, 5, 2, {3, 3, 3, 3, 3}, kernel_set<double>({"sig", "tanh", "ReLu"})(), 32u);
+    for (auto i = 0u; i < 20u; ++i) {
+        auto symbolic = ex2({"x", "y", "z"});
+        auto lengths = ex2.symbolic_length({"x", "y", "z"});
+        BOOST_CHECK_EQUAL(lengths[0], static_cast<double>(symbolic[0].length()));
+        BOOST_CHECK_EQUAL(lengths[1], static_cast<double>(symbolic[1].length()));
+        ex2.mutate_active(3u);
+    }
+}
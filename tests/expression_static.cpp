@@ -0,0 +1,101 @@
+#define BOOST_TEST_MODULE dcgp_expression_static_test
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_static.hpp>
+#include <dcgp/kernel_set.hpp>
+#include <dcgp/static_kernel_set.hpp>
+
+using namespace dcgp;
+
+// Equality that also holds for two NaNs
+template <typename T>
+bool same(T a, T b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// Checks that a static expression and the dynamic one with the same kernels compute the same values
+template <typename T, typename... Kernels>
+void check_same_values(const std::vector<std::string> &names, unsigned arity, unsigned n_eph)
+{
+    kernel_set<T> ks(names);
+    std::mt19937 rng(32u);
+    std::uniform_real_distribution<T> dist(-3., 3.);
+    for (auto seed = 0u; seed < 10u; ++seed) {
+        expression_static<T, Kernels...> st(3, 2, 3, 10, 11, arity, n_eph, seed);
+        expression<T> ex(3, 2, 3, 10, 11, arity, ks(), n_eph, seed);
+        // The kernel ids are the same
+        BOOST_CHECK(st.get() == ex.get());
+        BOOST_CHECK_EQUAL(st({T(1.), T(2.), T(3.)}).size(), 2u);
+        for (auto mut = 0u; mut < 5u; ++mut) {
+            std::vector<std::vector<T>> points, labels;
+            for (auto k = 0u; k < 100u; ++k) {
+                points.push_back({dist(rng), dist(rng), dist(rng)});
+                labels.push_back({dist(rng), dist(rng)});
+            }
+            for (const auto &point : points) {
+                auto v1 = st(point);
+                auto v2 = ex(point);
+                BOOST_CHECK(same(v1[0], v2[0]) && same(v1[1], v2[1]));
+            }
+            std::vector<T> flat, out1(200), out2(200);
+            for (const auto &point : points) {
+                flat.insert(flat.end(), point.begin(), point.end());
+            }
+            typename expression<T>::workspace ws;
+            st.evaluate_batch(flat.data(), out1.data(), 100u, ws);
+            ex.evaluate_batch(flat.data(), out2.data(), 100u, ws);
+            for (auto i = 0u; i < out1.size(); ++i) {
+                BOOST_CHECK(same(out1[i], out2[i]));
+            }
+            BOOST_CHECK(same(st.loss(points, labels, "MSE"), ex.loss(points, labels, "MSE")));
+            st.mutate_active(2);
+            ex.set(st.get());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(construction)
+{
+    expression_static<double, sum_kernel, mul_kernel, sig_kernel> ex(2, 1, 2, 3, 4, 2, 1u, 23u);
+    BOOST_CHECK_EQUAL(ex.get_f().size(), 3u);
+    BOOST_CHECK_EQUAL(ex.get_f()[0].get_name(), "sum");
+    BOOST_CHECK_EQUAL(ex.get_f()[1].get_name(), "mul");
+    BOOST_CHECK_EQUAL(ex.get_f()[2].get_name(), "sig");
+    BOOST_CHECK_EQUAL(ex.get_eph_val().size(), 1u);
+    BOOST_CHECK_THROW(ex({1.}), std::invalid_argument);
+    // The symbolic evaluation is inherited
+    BOOST_CHECK_EQUAL(ex({"x", "y"}).size(), 1u);
+    static_kernel_set<double, sum_kernel, diff_kernel> ks;
+    BOOST_CHECK_EQUAL(ks().size(), 2u);
+    BOOST_CHECK_EQUAL((static_kernel_set<double, sum_kernel, diff_kernel>::size()), 2u);
+    double in[] = {3., 2.};
+    auto row = [&in](unsigned j) { return in[j]; };
+    BOOST_CHECK_EQUAL(ks.call(0u, row, 2u), 5.);
+    BOOST_CHECK_EQUAL(ks.call(1u, row, 2u), 1.);
+    // The default arity is accepted by all the kernels
+    BOOST_CHECK((expression_static<double, sum_kernel, mul_kernel>().get_arity() == std::vector<unsigned>{1u}));
+    BOOST_CHECK((expression_static<double, sum_kernel, pdiv_kernel>().get_arity() == std::vector<unsigned>{2u}));
+}
+
+BOOST_AUTO_TEST_CASE(same_values)
+{
+    check_same_values<double, sum_kernel, diff_kernel, mul_kernel, div_kernel>({"sum", "diff", "mul", "div"}, 2u,
+                                                                               0u);
+    check_same_values<double, sum_kernel, diff_kernel, mul_kernel, div_kernel, pdiv_kernel, sig_kernel, tanh_kernel,
+                      relu_kernel, elu_kernel, isru_kernel, sin_kernel, cos_kernel, log_kernel, exp_kernel,
+                      gaussian_kernel, sqrt_kernel>({"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU",
+                                                     "ISRU", "sin", "cos", "log", "exp", "gaussian", "sqrt"},
+                                                    3u, 2u);
+    check_same_values<float, sum_kernel, mul_kernel, pdiv_kernel, sig_kernel, sin_kernel>(
+        {"sum", "mul", "pdiv", "sig", "sin"}, 2u, 1u);
+    check_same_values<double, sum_kernel, mul_kernel, sig_fast_kernel, tanh_fast_kernel, exp_fast_kernel,
+                      gaussian_fast_kernel>({"sum", "mul", "sig_fast", "tanh_fast", "exp_fast", "gaussian_fast"}, 2u,
+                                            1u);
+    check_same_values<float, sum_kernel, sig_fast_kernel, tanh_fast_kernel>({"sum", "sig_fast", "tanh_fast"}, 2u, 0u);
+}
@@ -5,11 +5,12 @@
 #include <vector>
 
 #include <dcgp/expression.hpp>
+#include <dcgp/expression_static.hpp>
 #include <dcgp/kernel_set.hpp>
 #include <dcgp/wrapped_functions.hpp>
 
 // We test the speed of evauating sig(a+b) calling
-// the function directly, via an std::function or a minimal d-CGP expression
+// the function directly, via an std::function or a minimal d-CGP expression (with a dynamic or static kernel set)
 
 BOOST_AUTO_TEST_CASE(function_calls)
 {
@@ -47,14 +48,61 @@ BOOST_AUTO_TEST_CASE(function_calls)
         }
     }
 
-    std::cout << "Testing " << N << " std::function calls to the sigmoid function via dcgp::expression" << std::endl;
+    std::cout << "Testing " << N << " std::function calls to the sigmoid function decoding a dcgp::expression"
+              << std::endl;
     dcgp::kernel_set<double> only_one_sigmoid({"sig"});
     dcgp::expression<double> ex(2, 1, 1, 1, 1, 2, only_one_sigmoid(), 0u, 0u);
     ex.set({0, 0, 1, 2});
+    const auto &x = ex.get();
+    {
+        boost::timer::auto_cpu_timer t; // Sets up a timer
+        std::vector<double> node(3), function_in;
+        for (auto i = 0u; i < N; ++i) {
+            // We decode the chromosome at each call, as done before the introduction of the tape
+            node[0] = ab_vector[i][0];
+            node[1] = ab_vector[i][1];
+            function_in.resize(ex.get_arity(2u));
+            for (auto j = 0u; j < function_in.size(); ++j) {
+                function_in[j] = node[x[ex.get_gene_idx()[2u] + j + 1u]];
+            }
+            node[2] = ex.get_f()[x[ex.get_gene_idx()[2u]]](function_in);
+        }
+    }
+    std::cout << "Testing " << N << " calls to the sigmoid function via the dcgp::expression tape" << std::endl;
     {
         boost::timer::auto_cpu_timer t; // Sets up a timer
         for (auto i = 0u; i < N; ++i) {
             ex(ab_vector[i]);
         }
     }
+    std::cout << "Testing " << N << " static calls to the sigmoid function via the dcgp::expression_static tape"
+              << std::endl;
+    dcgp::expression_static<double, dcgp::sig_kernel> ex_static(2, 1, 1, 1, 1, 2, 0u, 0u);
+    ex_static.set({0, 0, 1, 2});
+    {
+        boost::timer::auto_cpu_timer t; // Sets up a timer
+        for (auto i = 0u; i < N; ++i) {
+            ex_static(ab_vector[i]);
+        }
+    }
+    // An arithmetic only kernel set, where the cost of the kernel calls dominates
+    dcgp::kernel_set<double> arithmetic({"sum", "diff", "mul", "div"});
+    dcgp::expression<double> ex2(2, 1, 1, 100, 101, 2, arithmetic(), 0u, 0u);
+    dcgp::expression_static<double, dcgp::sum_kernel, dcgp::diff_kernel, dcgp::mul_kernel, dcgp::div_kernel> ex2_static(
+        2, 1, 1, 100, 101, 2, 0u, 0u);
+    std::cout << "Testing " << N << " evaluations of an arithmetic dcgp::expression with "
+              << ex2.get_active_nodes().size() << " active nodes" << std::endl;
+    {
+        boost::timer::auto_cpu_timer t; // Sets up a timer
+        for (auto i = 0u; i < N; ++i) {
+            ex2(ab_vector[i]);
+        }
+    }
+    std::cout << "Testing " << N << " evaluations of the same dcgp::expression_static" << std::endl;
+    {
+        boost::timer::auto_cpu_timer t; // Sets up a timer
+        for (auto i = 0u; i < N; ++i) {
+            ex2_static(ab_vector[i]);
+        }
+    }
 }
@@ -10,6 +10,8 @@
 #include <dcgp/gym.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 
+#include "checkpoint.hpp"
+
 using namespace dcgp;
 
 BOOST_AUTO_TEST_CASE(construction_test)
@@ -42,6 +44,15 @@ BOOST_AUTO_TEST_CASE(evolve_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(checkpoint_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    std::vector<std::vector<double>> points, labels;
+    gym::generate_koza_quintic(points, labels);
+    pagmo::problem prob{symbolic_regression(points, labels, 1, 16, 3, 2, basic_set(), 5u, 0u)};
+    check_checkpoint([]() { return gd4cgp{20u, 1., 1e-12}; }, prob, 4u, 1u);
+}
+
 BOOST_AUTO_TEST_CASE(trivial_methods_test)
 {
     gd4cgp uda(10u, 1u, 1e-4);
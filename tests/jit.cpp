@@ -0,0 +1,121 @@
+#define BOOST_TEST_MODULE dcgp_jit_test
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <dirent.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_weighted.hpp>
+#include <dcgp/jit.hpp>
+#include <dcgp/kernel_set.hpp>
+
+#include "temp_dir.hpp"
+
+using namespace dcgp;
+
+// Equality that also holds for two NaNs
+bool same(double a, double b)
+{
+    return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// The number of entries of a directory (other than . and ..)
+unsigned n_entries(const std::string &dir)
+{
+    unsigned retval = 0u;
+    DIR *d = ::opendir(dir.c_str());
+    BOOST_REQUIRE(d);
+    while (auto entry = ::readdir(d)) {
+        retval += std::string(entry->d_name) != "." && std::string(entry->d_name) != "..";
+    }
+    ::closedir(d);
+    return retval;
+}
+
+BOOST_AUTO_TEST_CASE(jit_test)
+{
+    temp_dir tmp;
+    const std::string cache_dir = tmp.path() + "/cache";
+    kernel_set<double> all({"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU", "ISRU", "sin", "cos",
+                            "log", "exp", "gaussian", "sqrt"});
+    std::mt19937 rng(32u);
+    std::uniform_real_distribution<double> dist(-3., 3.);
+    for (auto seed = 0u; seed < 20u; ++seed) {
+        // With and without ephemeral constants
+        expression<double> ex(3, 2, 3, 10, 11, 2 + seed % 2u, all(), seed % 3u, seed);
+        jit_expression jit(ex, cache_dir);
+        std::vector<double> out(2);
+        for (auto k = 0u; k < 100u; ++k) {
+            std::vector<double> point = {dist(rng), dist(rng), dist(rng)};
+            auto expected = ex(point);
+            auto res = jit(point);
+            jit.evaluate(point.data(), out.data());
+            for (auto i = 0u; i < 2u; ++i) {
+                BOOST_CHECK(same(res[i], expected[i]));
+                BOOST_CHECK(same(out[i], expected[i]));
+            }
+        }
+        BOOST_CHECK_THROW(jit({1., 2.}), std::invalid_argument);
+        // A second compilation of the same phenotype hits the cache
+        jit_expression again(ex, cache_dir);
+        BOOST_CHECK(again.cached());
+        BOOST_CHECK_EQUAL(again.get_library(), jit.get_library());
+        std::vector<double> point = {0.1, 0.2, 0.3};
+        BOOST_CHECK(same(again(point)[0], ex(point)[0]));
+        // So does a compilation after a change of the ephemeral constants
+        if (ex.get_eph_val().size() > 0u) {
+            auto eph_val = ex.get_eph_val();
+            eph_val[0] += 0.5;
+            ex.set_eph_val(eph_val);
+            jit_expression new_constants(ex, cache_dir);
+            BOOST_CHECK(new_constants.cached());
+            BOOST_CHECK_EQUAL(new_constants.get_library(), jit.get_library());
+            BOOST_CHECK(same(new_constants(point)[0], ex(point)[0]));
+        }
+    }
+    // Kernels other than those of the kernel_set cannot be compiled
+    {
+        kernel<double> custom([](const std::vector<double> &in) { return in[0]; },
+                              [](const std::vector<std::string> &in) { return in[0]; }, "custom");
+        expression<double> ex(1, 1, 1, 5, 6, 2, {custom}, 0u, 23u);
+        BOOST_CHECK_THROW(jit_expression(ex, cache_dir), std::invalid_argument);
+    }
+    // Nor can the approximate kernels
+    {
+        expression<double> ex(1, 1, 1, 5, 6, 2, kernel_set<double>({"sig_fast"})(), 0u, 23u);
+        BOOST_CHECK_THROW(jit_expression(ex, cache_dir), std::invalid_argument);
+    }
+    // Weighted expressions cannot be compiled either
+    {
+        expression_weighted<double> ex(2, 1, 1, 5, 6, 2, all(), 23u);
+        BOOST_CHECK_THROW(jit_expression::source(ex), std::invalid_argument);
+    }
+    // A failing compiler is reported, and its temporary files are removed
+    {
+        expression<double> ex(3, 2, 3, 10, 11, 2, all(), 0u, 123u);
+        BOOST_CHECK_THROW(jit_expression(ex, cache_dir + "_fail", "false"), std::runtime_error);
+        BOOST_CHECK_EQUAL(n_entries(cache_dir + "_fail"), 0u);
+        BOOST_CHECK_THROW(jit_expression(ex, cache_dir + "_fail", " "), std::invalid_argument);
+    }
+    // The cache directory is not interpreted by a shell
+    {
+        expression<double> ex(3, 2, 3, 10, 11, 2, all(), 0u, 123u);
+        jit_expression jit(ex, cache_dir + "_'quoted $dir'");
+        BOOST_CHECK(!jit.cached());
+        BOOST_CHECK_EQUAL(n_entries(cache_dir + "_'quoted $dir'"), 2u);
+        std::vector<double> point = {0.1, 0.2, 0.3};
+        BOOST_CHECK(same(jit(point)[0], ex(point)[0]));
+    }
+    // A cache directory writable by the others is refused
+    {
+        expression<double> ex(3, 2, 3, 10, 11, 2, all(), 0u, 123u);
+        const std::string shared_dir = cache_dir + "_shared";
+        BOOST_REQUIRE_EQUAL(::mkdir(shared_dir.c_str(), 0700), 0);
+        BOOST_REQUIRE_EQUAL(::chmod(shared_dir.c_str(), 0777), 0);
+        BOOST_CHECK_THROW(jit_expression(ex, shared_dir), std::runtime_error);
+    }
+}
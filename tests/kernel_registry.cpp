@@ -0,0 +1,125 @@
+#define BOOST_TEST_MODULE dcgp_kernel_registry_test
+#include <algorithm>
+#include <atomic>
+#include <audi/gdual.hpp>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/kernel_registry.hpp>
+#include <dcgp/kernel_set.hpp>
+
+using namespace dcgp;
+
+// Checks whether name is among the registered kernels of type T
+template <typename T>
+bool listed(const std::string &name)
+{
+    auto names = kernel_registry<T>::instance().names();
+    return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+BOOST_AUTO_TEST_CASE(builtin_kernels)
+{
+    auto &reg = kernel_registry<double>::instance();
+    for (const std::string name : {"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU", "ISRU", "sin",
+                                   "cos", "log", "exp", "gaussian", "sqrt", "sig_fast", "tanh_fast", "exp_fast",
+                                   "gaussian_fast"}) {
+        BOOST_CHECK(reg.contains(name));
+        BOOST_CHECK(listed<double>(name));
+        BOOST_CHECK_EQUAL(reg.get(name).k.get_name(), name);
+    }
+    auto names = reg.names();
+    BOOST_CHECK(std::is_sorted(names.begin(), names.end()));
+    // The metadata
+    BOOST_CHECK_EQUAL(reg.get("pdiv").differentiable, "div");
+    BOOST_CHECK_EQUAL(reg.get("pdiv").min_arity, 2u);
+    BOOST_CHECK_EQUAL(reg.get("sig_fast").differentiable, "sig");
+    BOOST_CHECK_EQUAL(reg.get("sum").differentiable, "sum");
+    BOOST_CHECK_EQUAL(reg.get("sum").min_arity, 1u);
+    BOOST_CHECK(reg.get("pdiv").k.get_opcode() == kernel_opcode::pdiv);
+    BOOST_CHECK_THROW(reg.get("cube"), std::invalid_argument);
+    // pdiv and the approximate kernels are only registered for floating point types
+    BOOST_CHECK(kernel_registry<float>::instance().contains("pdiv"));
+    BOOST_CHECK(kernel_registry<audi::gdual_d>::instance().contains("div"));
+    BOOST_CHECK(!kernel_registry<audi::gdual_d>::instance().contains("pdiv"));
+    BOOST_CHECK(!kernel_registry<audi::gdual_d>::instance().contains("sig_fast"));
+}
+
+BOOST_AUTO_TEST_CASE(user_kernels)
+{
+    auto &reg = kernel_registry<double>::instance();
+    kernel<double> cube([](const std::vector<double> &in) { return in[0] * in[0] * in[0]; },
+                        [](const std::vector<std::string> &in) { return "(" + in[0] + ")^3"; }, "cube");
+    BOOST_CHECK_THROW(kernel_set<double>({"sum", "cube"}), std::invalid_argument);
+    reg.add(cube, "mul");
+    BOOST_CHECK(reg.contains("cube"));
+    BOOST_CHECK_EQUAL(reg.get("cube").differentiable, "mul");
+    // Registered kernels are constructed by name
+    kernel_set<double> ks({"sum", "cube"});
+    BOOST_CHECK_EQUAL(ks().size(), 2u);
+    BOOST_CHECK_EQUAL(ks[1].get_name(), "cube");
+    BOOST_CHECK_EQUAL(ks[1](std::vector<double>{2.}), 8.);
+    expression<double> ex(1, 1, 1, 1, 1, 1, ks(), 0u, 23u);
+    ex.set({1, 0, 1});
+    BOOST_CHECK_EQUAL(ex({3.})[0], 27.);
+    BOOST_CHECK_EQUAL(ex({"x"})[0], "(x)^3");
+    // Only for the type they were registered for
+    BOOST_CHECK_THROW(kernel_set<float>({"cube"}), std::invalid_argument);
+    // Names cannot be registered twice, built-in ones included
+    BOOST_CHECK_THROW(reg.add(cube), std::invalid_argument);
+    kernel<double> sum(my_sum<double>, print_my_sum, "sum");
+    BOOST_CHECK_THROW(reg.add(sum), std::invalid_argument);
+    kernel<double> nullary([](const std::vector<double> &) { return 1.; },
+                           [](const std::vector<std::string> &) { return "1"; }, "one");
+    BOOST_CHECK_THROW(reg.add(nullary, "", 0u), std::invalid_argument);
+    BOOST_CHECK(!reg.contains("one"));
+    // The kernels resolved from the registry carry their minimum arity, other user kernels do not, even when they
+    // share the name of a registered one
+    kernel<double> square([](const std::vector<double> &in) { return in[0] * in[1]; },
+                          [](const std::vector<std::string> &in) { return in[0] + "*" + in[1]; }, "square2");
+    reg.add(square, "", 2u);
+    BOOST_CHECK_EQUAL(square.get_min_arity(), 1u);
+    BOOST_CHECK_EQUAL(kernel_set<double>({"square2"})[0].get_min_arity(), 2u);
+    BOOST_CHECK_THROW(expression<double>(1, 1, 1, 3, 4, 1, kernel_set<double>({"square2"})(), 0u, 23u),
+                      std::invalid_argument);
+    kernel<double> unary_pdiv([](const std::vector<double> &in) { return 1. / in[0]; },
+                              [](const std::vector<std::string> &in) { return "1/" + in[0]; }, "pdiv");
+    BOOST_CHECK_NO_THROW(expression<double>(1, 1, 1, 3, 4, 1, {unary_pdiv}, 0u, 23u));
+    // The built-in protected division always needs two inputs
+    BOOST_CHECK_EQUAL(pdiv_kernel::get<double>().get_min_arity(), 2u);
+    // Unregistered kernels are no longer constructed by name, but those already constructed still work
+    reg.remove("cube");
+    BOOST_CHECK(!reg.contains("cube"));
+    BOOST_CHECK_THROW(kernel_set<double>({"cube"}), std::invalid_argument);
+    BOOST_CHECK_EQUAL(ks[1](std::vector<double>{2.}), 8.);
+    BOOST_CHECK_THROW(reg.remove("cube"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(thread_safety)
+{
+    // Kernels are registered and looked up concurrently (Boost.Test assertions are not thread-safe, so the failures
+    // are counted and checked afterwards)
+    std::atomic<unsigned> failures(0u);
+    std::vector<std::thread> threads;
+    for (auto t = 0u; t < 8u; ++t) {
+        threads.emplace_back([t, &failures]() {
+            for (auto i = 0u; i < 50u; ++i) {
+                std::string name = "k" + std::to_string(t) + "_" + std::to_string(i);
+                kernel_registry<double>::instance().add(kernel<double>(my_sum<double>, print_my_sum, name));
+                kernel_set<double> ks({"sum", "pdiv", name});
+                if (ks[2].get_name() != name) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(failures.load(), 0u);
+    BOOST_CHECK(listed<double>("k7_49"));
+}
@@ -28,9 +28,31 @@ void evaluate_loss(unsigned int in, unsigned int out, unsigned int rows, unsigne
 
     std::cout << "Performing " << N << " evaluations, in:" << in << " out:" << out << " rows:" << rows
               << " columns:" << columns << std::endl;
+    double parent_loss;
     {
         boost::timer::auto_cpu_timer t;
-        ex.loss(points, labels, "MSE", parallel);
+        parent_loss = ex.loss(points, labels, "MSE", parallel);
+    }
+    if (!parallel) {
+        // Ten mutants, as generated by an evolutionary strategy, bounded by the loss of their parent
+        std::vector<dcgp::expression<double>> mutants(10u, ex);
+        for (auto &mutant : mutants) {
+            mutant.mutate_active(2u);
+        }
+        std::cout << "Ten mutants, full loss: ";
+        {
+            boost::timer::auto_cpu_timer t;
+            for (const auto &mutant : mutants) {
+                mutant.loss(points, labels, "MSE");
+            }
+        }
+        std::cout << "Ten mutants, bounded loss: ";
+        {
+            boost::timer::auto_cpu_timer t;
+            for (const auto &mutant : mutants) {
+                mutant.bounded_loss(points, labels, "MSE", parent_loss, 97u);
+            }
+        }
     }
 }
 
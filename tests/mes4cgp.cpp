@@ -9,6 +9,8 @@
 #include <dcgp/algorithms/mes4cgp.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 
+#include "checkpoint.hpp"
+
 using namespace dcgp;
 
 BOOST_AUTO_TEST_CASE(construction_test)
@@ -62,6 +64,12 @@ BOOST_AUTO_TEST_CASE(evolve_test)
     BOOST_CHECK(uda1.get_log() == uda2.get_log());
 }
 
+BOOST_AUTO_TEST_CASE(checkpoint_test)
+{
+    pagmo::problem prob{symbolic_regression({{1., 2.}, {0.3, -0.32}}, {{3. / 2.}, {0.02 / 0.32}})};
+    check_checkpoint([]() { return mes4cgp{20u, 1u, 0., 23u}; }, prob, 5u, 7u);
+}
+
 BOOST_AUTO_TEST_CASE(trivial_methods_test)
 {
     mes4cgp uda{10u, 1u, 1e-4, 23u};
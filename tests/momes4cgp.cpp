@@ -10,6 +10,8 @@
 #include <dcgp/gym.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 
+#include "checkpoint.hpp"
+
 using namespace dcgp;
 
 BOOST_AUTO_TEST_CASE(construction_test)
@@ -65,6 +67,15 @@ BOOST_AUTO_TEST_CASE(evolve_test)
     BOOST_CHECK(uda1.get_log() == uda2.get_log());
 }
 
+BOOST_AUTO_TEST_CASE(checkpoint_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    std::vector<std::vector<double>> points, labels;
+    gym::generate_koza_quintic(points, labels);
+    pagmo::problem prob{symbolic_regression(points, labels, 1, 20, 21, 2, basic_set(), 1u, true, 0u)};
+    check_checkpoint([]() { return momes4cgp{20u, 1u, 23u}; }, prob, 5u, 7u);
+}
+
 BOOST_AUTO_TEST_CASE(trivial_methods_test)
 {
     momes4cgp uda{10u, 1u, 23u};
@@ -34,4 +34,5 @@ BOOST_AUTO_TEST_CASE(mutate_active_speed)
     perform_active_mutations(1, 1, 2, 100, 101, 2, 100000, basic_set());
     perform_active_mutations(1, 1, 3, 100, 101, 2, 100000, basic_set());
     perform_active_mutations(1, 1, 100, 100, 101, 2, 100000, basic_set());
+    perform_active_mutations(1, 1, 2, 1000, 1001, 2, 100000, basic_set());
 }
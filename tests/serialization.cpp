@@ -0,0 +1,143 @@
+#define BOOST_TEST_MODULE dcgp_serialization_test
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <dcgp/expression.hpp>
+#include <dcgp/expression_ann.hpp>
+#include <dcgp/expression_static.hpp>
+#include <dcgp/expression_weighted.hpp>
+#include <dcgp/kernel_registry.hpp>
+#include <dcgp/kernel_set.hpp>
+
+using namespace dcgp;
+
+// Saves from into an archive and restores it into to
+template <typename OArchive, typename IArchive, typename E1, typename E2>
+void round_trip(const E1 &from, E2 &to)
+{
+    std::stringstream ss;
+    {
+        OArchive oa(ss);
+        oa << from;
+    }
+    IArchive ia(ss);
+    ia >> to;
+}
+
+// Checks that two expressions are equal and that they mutate in the same way (i.e. that the random engine state was
+// restored)
+template <typename E>
+void check_equal(E &ex1, E &ex2)
+{
+    BOOST_CHECK(ex1.get() == ex2.get());
+    BOOST_CHECK(ex1.get_eph_val() == ex2.get_eph_val());
+    BOOST_CHECK(ex1.get_eph_symb() == ex2.get_eph_symb());
+    BOOST_CHECK(ex1.get_arity() == ex2.get_arity());
+    BOOST_CHECK(ex1.get_lb() == ex2.get_lb());
+    BOOST_CHECK(ex1.get_ub() == ex2.get_ub());
+    BOOST_CHECK(ex1.get_active_nodes() == ex2.get_active_nodes());
+    BOOST_CHECK_EQUAL(ex1.get_f().size(), ex2.get_f().size());
+    for (auto i = 0u; i < ex1.get_f().size(); ++i) {
+        BOOST_CHECK_EQUAL(ex1.get_f()[i].get_name(), ex2.get_f()[i].get_name());
+    }
+    std::vector<double> point(ex1.get_n() - ex1.get_eph_val().size(), 0.3);
+    std::vector<std::string> symbols(point.size(), "x");
+    BOOST_CHECK(ex1(point) == ex2(point));
+    BOOST_CHECK(ex1(symbols) == ex2(symbols));
+    for (auto i = 0u; i < 10u; ++i) {
+        ex1.mutate_active();
+        ex2.mutate_active();
+        BOOST_CHECK(ex1.get() == ex2.get());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expression_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "pdiv", "sin", "exp_fast"});
+    kernel_set<double> other_set({"sum"});
+    expression<double> ex(3, 2, 3, 10, 4, 2, basic_set(), 2u, 32u);
+    ex.set_eph_val({0.5, -1.25});
+    ex.set_eph_symb({"a", "b"});
+    ex.mutate_active(20);
+    {
+        expression<double> ex2(1, 1, 1, 1, 1, 1, other_set(), 0u, 0u);
+        expression<double> ex1(ex);
+        round_trip<boost::archive::binary_oarchive, boost::archive::binary_iarchive>(ex1, ex2);
+        check_equal(ex1, ex2);
+    }
+    {
+        expression<double> ex2;
+        expression<double> ex1(ex);
+        round_trip<boost::archive::text_oarchive, boost::archive::text_iarchive>(ex1, ex2);
+        check_equal(ex1, ex2);
+    }
+    // Kernels that are not registered cannot be restored
+    kernel<double> unregistered(my_sum<double>, print_my_sum, "my_unregistered_sum");
+    expression<double> ex3(2, 1, 2, 2, 3, 2, {unregistered}, 0u, 32u);
+    expression<double> ex4;
+    BOOST_CHECK_THROW((round_trip<boost::archive::text_oarchive, boost::archive::text_iarchive>(ex3, ex4)),
+                      std::invalid_argument);
+    kernel_registry<double>::instance().add(unregistered);
+    round_trip<boost::archive::text_oarchive, boost::archive::text_iarchive>(ex3, ex4);
+    check_equal(ex3, ex4);
+}
+
+BOOST_AUTO_TEST_CASE(expression_static_test)
+{
+    using static_ex = expression_static<double, sum_kernel, diff_kernel, mul_kernel, pdiv_kernel>;
+    static_ex ex1(2, 1, 3, 10, 11, 2, 1u, 32u);
+    static_ex ex2;
+    round_trip<boost::archive::binary_oarchive, boost::archive::binary_iarchive>(ex1, ex2);
+    check_equal(ex1, ex2);
+    // The kernels must be those of the static expression
+    expression_static<double, sum_kernel, diff_kernel, mul_kernel, div_kernel> ex3(2, 1, 3, 10, 11, 2, 1u, 32u);
+    auto x = ex2.get();
+    BOOST_CHECK_THROW((round_trip<boost::archive::binary_oarchive, boost::archive::binary_iarchive>(ex3, ex2)),
+                      std::invalid_argument);
+    BOOST_CHECK(ex2.get() == x);
+}
+
+BOOST_AUTO_TEST_CASE(expression_weighted_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    expression_weighted<double> ex1(2, 2, 3, 4, 5, 2, basic_set(), 32u);
+    std::vector<double> weights(ex1.get_weights().size());
+    for (auto i = 0u; i < weights.size(); ++i) {
+        weights[i] = 0.1 * i - 0.5;
+    }
+    ex1.set_weights(weights);
+    expression_weighted<double> ex2(1, 1, 1, 1, 1, 1, basic_set(), 0u);
+    round_trip<boost::archive::binary_oarchive, boost::archive::binary_iarchive>(ex1, ex2);
+    BOOST_CHECK(ex1.get_weights() == ex2.get_weights());
+    check_equal(ex1, ex2);
+}
+
+BOOST_AUTO_TEST_CASE(expression_ann_test)
+{
+    kernel_set<double> ann_set({"sig", "tanh", "ReLu", "sum"});
+    expression_ann<double> ex1(3, 2, 4, 3, 1, {3, 4, 4}, ann_set(), 32u);
+    ex1.randomise_weights(0., 1., 32u);
+    ex1.randomise_biases(0., 1., 32u);
+    ex1.mutate_active(10);
+    kernel_set<double> other_set({"tanh"});
+    expression_ann<double> ex2(1, 1, 1, 1, 1, 1, other_set(), 0u);
+    round_trip<boost::archive::text_oarchive, boost::archive::text_iarchive>(ex1, ex2);
+    BOOST_CHECK(ex1.get_weights() == ex2.get_weights());
+    BOOST_CHECK(ex1.get_biases() == ex2.get_biases());
+    // Backpropagation uses the rebuilt kernel map and connections
+    std::vector<std::vector<double>> points(5, std::vector<double>(3, 0.2)), labels(5, std::vector<double>(2, 0.1));
+    auto d1 = ex1.d_loss(points, labels, expression<double>::loss_type::MSE);
+    auto d2 = ex2.d_loss(points, labels, expression<double>::loss_type::MSE);
+    BOOST_CHECK(std::get<0>(d1) == std::get<0>(d2));
+    BOOST_CHECK(std::get<1>(d1) == std::get<1>(d2));
+    BOOST_CHECK(std::get<2>(d1) == std::get<2>(d2));
+    check_equal(ex1, ex2);
+}
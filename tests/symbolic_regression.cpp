@@ -1,5 +1,7 @@
 #define BOOST_TEST_MODULE dcgp_symbolic_regression_test
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <cmath>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/gaco.hpp>
 #include <pagmo/algorithms/sga.hpp>
@@ -8,6 +10,7 @@
 #include <pagmo/problem.hpp>
 
 #include <dcgp/gym.hpp>
+#include <dcgp/phenotype_cache.hpp>
 #include <dcgp/problems/symbolic_regression.hpp>
 
 using namespace dcgp;
@@ -100,6 +103,31 @@ BOOST_AUTO_TEST_CASE(fitness_test_single_obj)
         BOOST_CHECK_EQUAL(udp.fitness(test_xeph)[0], 2.5);
     }
 }
+BOOST_AUTO_TEST_CASE(float_loss_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "pdiv"});
+    std::vector<std::vector<double>> points, labels;
+    gym::generate_koza_quintic(points, labels);
+    symbolic_regression udp(points, labels, 2, 10, 11, 2, basic_set(), 2u, false, 0u);
+    pagmo::population pop(udp, 20u, 32u);
+    for (decltype(pop.size()) i = 0u; i < pop.size(); ++i) {
+        auto x = pop.get_x()[i];
+        BOOST_CHECK_CLOSE(udp.float_loss(x), udp.fitness(x)[0], 1e-1);
+    }
+    // Copies made afterwards share the single precision data
+    symbolic_regression udp2(udp);
+    BOOST_CHECK_EQUAL(udp2.float_loss(pop.get_x()[0]), udp.float_loss(pop.get_x()[0]));
+    // Kernels not registered for float are fine as long as single precision is not used
+    kernel_registry<double>::instance().add(kernel<double>(my_sum<double>, print_my_sum, "sr_double_only_sum"));
+    kernel_registry<audi::gdual_d>::instance().add(
+        kernel<audi::gdual_d>(my_sum<audi::gdual_d>, print_my_sum, "sr_double_only_sum"));
+    symbolic_regression udp3(points, labels, 2, 10, 11, 2, kernel_set<double>({"sr_double_only_sum", "mul"})(), 0u,
+                             false, 0u);
+    pagmo::population pop3(udp3, 1u, 32u);
+    BOOST_CHECK_NO_THROW(udp3.fitness(pop3.get_x()[0]));
+    BOOST_CHECK_THROW(udp3.float_loss(pop3.get_x()[0]), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_CASE(fitness_test_two_obj)
 {
     kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
@@ -115,6 +143,20 @@ BOOST_AUTO_TEST_CASE(fitness_test_two_obj)
     }
 }
 
+BOOST_AUTO_TEST_CASE(fitness_test_two_obj_deep)
+{
+    // On deep graphs the complexity is computed without building the (exponentially long) formula
+    kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
+    symbolic_regression udp{{{1.}, {2.}}, {{1.}, {2.}}, 1, 100, 2, 2, basic_set(), 0u, true, 0u};
+    pagmo::vector_double x;
+    for (auto i = 0u; i < 100u; ++i) {
+        x.insert(x.end(), {0., static_cast<double>(i), static_cast<double>(i)});
+    }
+    x.push_back(100.);
+    BOOST_CHECK_CLOSE(udp.fitness(x)[1], 4. * std::pow(2., 100.) - 3., 1e-10);
+    BOOST_CHECK(udp.pretty_dag(x).find("t100 = (t99+t99); y0 = t100") != std::string::npos);
+}
+
 BOOST_AUTO_TEST_CASE(get_bounds_test)
 {
     kernel_set<double> basic_set({"sum", "diff", "mul", "div"});
@@ -135,6 +177,7 @@ BOOST_AUTO_TEST_CASE(trivial_methods_test)
     pagmo::vector_double test_x = {0, 1, 1, 0, 0, 0, 2, 0, 2, 2, 0, 2, 4, 3};
     BOOST_CHECK(udp.pretty(test_x).find("[(x0*(x1+x1)), (x0+x0)]") != std::string::npos);
     BOOST_CHECK(udp.prettier(test_x).find("[2*x0*x1, 2*x0]") != std::string::npos);
+    BOOST_CHECK_EQUAL(udp.pretty_dag(test_x), "t2 = (x1+x1); t3 = (x0+x0); t4 = (x0*t2); y0 = t4; y1 = t3");
     BOOST_CHECK_NO_THROW(udp.get_cgp());
 }
 
@@ -222,4 +265,87 @@ BOOST_AUTO_TEST_CASE(cache_test)
         BOOST_CHECK_CLOSE(f1[0], f2[0], 1e-12);
         BOOST_CHECK(g1 == g2);
     }
+    // case 3: chromosomes differing only in inactive genes share the cache entry
+    {
+        auto x = pop.get_x()[0];
+        auto f1 = udp.fitness(x);
+        auto g1 = udp.gradient(x);
+        const auto &active_genes = udp.get_cgp().get_active_genes();
+        auto bounds = udp.get_bounds();
+        for (auto i = 0u; i < udp.get_cgp().get().size(); ++i) {
+            if (std::find(active_genes.begin(), active_genes.end(), i) == active_genes.end()) {
+                x[5u + i] = bounds.first[5u + i];
+            }
+        }
+        BOOST_CHECK(udp.fitness(x) == f1);
+        BOOST_CHECK(udp.gradient(x) == g1);
+    }
+    // case 4: the loss computed by gradient and hessians (pdiv -> div) does not overwrite the fitness
+    {
+        // pdiv(x, x) is 1 also in x = 0, where div(x, x) is not defined
+        symbolic_regression udp2({{0.}, {1.}}, {{1.}, {1.}}, 1, 1, 1, 2, kernel_set<double>({"pdiv"})(), 0u, false);
+        pagmo::vector_double x = {0, 0, 0, 1};
+        auto f1 = udp2.fitness(x);
+        BOOST_CHECK_EQUAL(f1[0], 0.);
+        udp2.gradient(x);
+        udp2.hessians(x);
+        BOOST_CHECK(udp2.fitness(x) == f1);
+        // Also when the gradient is computed first
+        symbolic_regression udp3({{0.}, {1.}}, {{1.}, {1.}}, 1, 1, 1, 2, kernel_set<double>({"pdiv"})(), 0u, false);
+        udp3.gradient(x);
+        BOOST_CHECK(udp3.fitness(x) == f1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(incremental_test)
+{
+    kernel_set<double> basic_set({"sum", "diff", "mul", "pdiv", "sin"});
+    std::vector<std::vector<double>> points, labels;
+    gym::generate_koza_quintic(points, labels);
+    symbolic_regression udp(points, labels, 2, 10, 11, 2, basic_set(), 2u, false, 0u, true);
+    pagmo::population pop(udp, 1u, 32u);
+    auto x = pop.get_x()[0];
+    udp.fitness(x);
+    // A copy starts with an empty node cache
+    symbolic_regression udp2(udp);
+    // A sequence of mutants (and of ephemeral constants) is evaluated exactly as by expression::loss, alternating
+    // between the problem and its copy
+    auto ex = udp.get_cgp();
+    for (auto i = 0u; i < 100u; ++i) {
+        ex.mutate_active(2u);
+        if (i % 10u == 0u) {
+            x[0] += 0.1;
+        }
+        std::copy(ex.get().begin(), ex.get().end(), x.begin() + 2);
+        const auto &prob = (i % 3u == 0u) ? udp2 : udp;
+        auto f = prob.fitness(x);
+        BOOST_CHECK_EQUAL(f[0], prob.get_cgp().loss(points, labels, "MSE"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(phenotype_cache_test)
+{
+    phenotype_cache<double> cache(2u);
+    double value = 0.;
+    cache.insert(1u, {1u}, {}, 1.);
+    cache.insert(2u, {2u}, {0.5}, 2.);
+    BOOST_CHECK(cache.find(1u, {1u}, {}, value));
+    BOOST_CHECK_EQUAL(value, 1.);
+    // A hash collision is detected
+    BOOST_CHECK(!cache.find(2u, {2u}, {0.3}, value));
+    BOOST_CHECK(!cache.find(2u, {3u}, {0.5}, value));
+    BOOST_CHECK_EQUAL(value, 1.);
+    // The least recently used entry is evicted
+    cache.insert(3u, {3u}, {}, 3.);
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK(!cache.find(2u, {2u}, {0.5}, value));
+    BOOST_CHECK(cache.find(1u, {1u}, {}, value));
+    BOOST_CHECK(cache.find(3u, {3u}, {}, value));
+    BOOST_CHECK_EQUAL(value, 3.);
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    // A zero capacity disables the cache
+    phenotype_cache<double> no_cache(0u);
+    no_cache.insert(1u, {1u}, {}, 1.);
+    BOOST_CHECK(!no_cache.find(1u, {1u}, {}, value));
 }
\ No newline at end of file
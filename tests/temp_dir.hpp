@@ -0,0 +1,47 @@
+#ifndef DCGP_TEMP_DIR_H
+#define DCGP_TEMP_DIR_H
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+
+// NOTE: POSIX only, to be included by the tests built on UNIX systems.
+
+namespace dcgp
+{
+
+// A unique directory in the temporary directory, created (accessible by the current user only) on construction. The
+// directory and everything in it are removed when going out of scope.
+class temp_dir
+{
+public:
+    temp_dir()
+    {
+        const char *dir = std::getenv("TMPDIR");
+        m_path = std::string(dir ? dir : "/tmp") + "/dcgp_test_" + std::to_string(std::random_device()());
+        BOOST_REQUIRE_EQUAL(::mkdir(m_path.c_str(), S_IRWXU), 0);
+    }
+    ~temp_dir()
+    {
+        ::nftw(
+            m_path.c_str(), [](const char *path, const struct stat *, int, struct FTW *) { return std::remove(path); },
+            16, FTW_DEPTH | FTW_PHYS);
+    }
+    temp_dir(const temp_dir &) = delete;
+    temp_dir &operator=(const temp_dir &) = delete;
+    const std::string &path() const
+    {
+        return m_path;
+    }
+
+private:
+    std::string m_path;
+};
+
+} // end of namespace dcgp
+
+#endif
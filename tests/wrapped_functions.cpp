@@ -1,6 +1,10 @@
 #define BOOST_TEST_MODULE dcgp_wrapped_functions_test
 #include <boost/test/unit_test.hpp>
 #include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <dcgp/kernel_set.hpp>
 #include <dcgp/wrapped_functions.hpp>
 
 using namespace dcgp;
@@ -103,3 +107,89 @@ BOOST_AUTO_TEST_CASE(my_gaussian_test)
         BOOST_CHECK_CLOSE(my_gaussian(v), 0.98272692007, 1e-4);
     }
 }
+
+// Checks that the fixed-arity entry points return the same values as the kernel functions
+template <typename T>
+void check_fixed_arity(const std::vector<std::string> &names, const std::vector<std::vector<T>> &points)
+{
+    for (const auto &f : kernel_set<T>(names)()) {
+        for (const auto &v : points) {
+            auto expected = f(v);
+            if (f.has_unary()) {
+                auto res = f(v[0]);
+                auto unary = f(std::vector<T>{v[0]});
+                BOOST_CHECK(res == unary || (std::isnan(res) && std::isnan(unary)));
+            }
+            auto res = f(v[0], v[1]);
+            BOOST_CHECK(res == expected || (std::isnan(res) && std::isnan(expected)));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fixed_arity_test)
+{
+    const std::vector<std::string> names = {"sum", "diff", "mul", "div", "pdiv", "sig", "tanh", "ReLu", "ELU", "ISRU",
+                                            "sin", "cos", "log", "exp", "gaussian", "sqrt", "exp_fast", "gaussian_fast",
+                                            "sig_fast", "tanh_fast"};
+    check_fixed_arity<double>(names, {{0.4, 0.5}, {-1.3, 0.2}, {0.4, 0.}, {0., 0.}, {-2., -3.}});
+    check_fixed_arity<float>(names, {{0.4f, 0.5f}, {-1.3f, 0.2f}, {0.4f, 0.f}, {0.f, 0.f}, {-2.f, -3.f}});
+    // pdiv has no unary entry point
+    kernel_set<double> pdiv({"pdiv"});
+    BOOST_CHECK(!pdiv()[0].has_unary());
+    BOOST_CHECK(pdiv()[0].has_binary());
+}
+
+// Checks the relative error of an approximate function on random points in [a, b]
+template <typename T, typename F, typename G>
+void check_approximation(F approx, G exact, T a, T b, double tol)
+{
+    std::mt19937 rng(32u);
+    std::uniform_real_distribution<T> dist(a, b);
+    for (auto i = 0u; i < 10000u; ++i) {
+        T x = dist(rng);
+        double expected = exact(static_cast<double>(x));
+        BOOST_CHECK_SMALL((static_cast<double>(approx(x)) - expected) / expected, tol);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fast_functions_test)
+{
+    auto exp_d = [](double x) { return std::exp(x); };
+    auto gaussian_d = [](double x) { return std::exp(-x * x); };
+    auto sig_d = [](double x) { return 1. / (1. + std::exp(-x)); };
+    auto tanh_d = [](double x) { return std::tanh(x); };
+    check_approximation<double>(my_exp_fast_unary<double>, exp_d, -700., 700., 1e-8);
+    check_approximation<double>(my_exp_fast_unary<double>, exp_d, -1., 1., 1e-8);
+    check_approximation<double>(my_gaussian_fast_unary<double>, gaussian_d, -20., 20., 1e-8);
+    check_approximation<double>(my_sig_fast_unary<double>, sig_d, -30., 30., 1e-8);
+    check_approximation<double>(my_tanh_fast_unary<double>, tanh_d, -20., 20., 3e-8);
+    check_approximation<double>(my_tanh_fast_unary<double>, tanh_d, -0.2, 0.2, 3e-8);
+    // In single precision the error is that of the rounding to float
+    check_approximation<float>(my_exp_fast_unary<float>, exp_d, -80.f, 80.f, 1e-7);
+    check_approximation<float>(my_sig_fast_unary<float>, sig_d, -10.f, 10.f, 1e-7);
+    check_approximation<float>(my_tanh_fast_unary<float>, tanh_d, -5.f, 5.f, 1e-7);
+    // Special values
+    const double inf = std::numeric_limits<double>::infinity();
+    BOOST_CHECK_EQUAL(my_exp_fast_unary(0.), 1.);
+    BOOST_CHECK_EQUAL(my_exp_fast_unary(1000.), inf);
+    BOOST_CHECK_EQUAL(my_exp_fast_unary(-1000.), 0.);
+    BOOST_CHECK_EQUAL(my_exp_fast_unary(inf), inf);
+    BOOST_CHECK_EQUAL(my_exp_fast_unary(-inf), 0.);
+    BOOST_CHECK(std::isnan(my_exp_fast_unary(std::numeric_limits<double>::quiet_NaN())));
+    BOOST_CHECK_CLOSE(my_exp_fast_unary(-740.), std::exp(-740.), 1e-4);
+    BOOST_CHECK_EQUAL(my_tanh_fast_unary(0.), 0.);
+    BOOST_CHECK_EQUAL(my_tanh_fast_unary(inf), 1.);
+    BOOST_CHECK_EQUAL(my_tanh_fast_unary(-inf), -1.);
+    BOOST_CHECK_EQUAL(my_tanh_fast_unary(1e200), 1.);
+    BOOST_CHECK_EQUAL(my_sig_fast_unary(-inf), 0.);
+    BOOST_CHECK_EQUAL(my_sig_fast_unary(inf), 1.);
+    BOOST_CHECK_EQUAL(my_gaussian_fast_unary(inf), 0.);
+    // The kernels sum their inputs as the exact ones
+    BOOST_CHECK_CLOSE(my_sig_fast(std::vector<double>{0.2, 0.3, -0.1}), my_sig(std::vector<double>{0.2, 0.3, -0.1}),
+                      1e-6);
+    BOOST_CHECK_CLOSE(my_tanh_fast(std::vector<double>{0.2, 0.3, -0.1}), my_tanh(std::vector<double>{0.2, 0.3, -0.1}),
+                      1e-6);
+    // The approximate kernels are only available for floating point types
+    BOOST_CHECK_THROW(kernel_set<audi::gdual_d>({"sig_fast"}), std::invalid_argument);
+    BOOST_CHECK_THROW(kernel_set<audi::gdual_d>({"exp_fast"}), std::invalid_argument);
+}